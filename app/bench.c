@@ -0,0 +1,486 @@
+#include "bench.h"
+#include "mem.h"
+#include "tls_pqc.h"
+#include "wd.h"
+#include <wolfssl/wolfcrypt/settings.h>
+#include <wolfssl/wolfcrypt/aes.h>
+#include <wolfssl/wolfcrypt/asn.h>
+#include <wolfssl/wolfcrypt/dilithium.h>
+#include <wolfssl/wolfcrypt/ecc.h>
+#include <wolfssl/wolfcrypt/error-crypt.h>
+#include <wolfssl/wolfcrypt/hash.h>
+#include <wolfssl/wolfcrypt/hmac.h>
+#include <wolfssl/wolfcrypt/mlkem.h>
+#include <wolfssl/wolfcrypt/random.h>
+#include <wolfssl/wolfcrypt/sha256.h>
+#include <wolfssl/wolfcrypt/sha3.h>
+#include <wolfssl/wolfcrypt/sha512.h>
+
+// Keys, inputs and outputs of the running entry are allocated in setup
+// (heap, freed after the run), so nothing of it stays in .bss. Keys are
+// generated on the device except ML-DSA: the client has no ML-DSA key
+// generation (WOLFSSL_DILITHIUM_NO_MAKE_KEY), sign uses the TLS client key
+// and verify the alternative public key of the client certificate.
+
+#define BENCH_RNG_SIZE      (32)
+
+#ifdef BENCH_HOST
+// host build (bench/): nanoseconds or instructions instead of cycles
+u32 bench_host_clock(void);
+  #define _BENCH_CLOCK()    bench_host_clock()
+#else
+  #define _BENCH_CLOCK()    (DWT->CYCCNT)
+#endif
+#define BENCH_MSG_SIZE      (32)
+
+typedef struct {
+    const char *name;
+    u32 bytes;              // data per operation, 0 == key operation
+    int (*setup)(void);     // not measured
+    int (*op)(void);
+    void (*cleanup)(void);  // NULL when free of context is enough
+} bench_entry_t;
+
+typedef struct {
+    MlKemKey key;
+    u8 ct[WC_ML_KEM_768_CIPHER_TEXT_SIZE];
+    u8 ss[WC_ML_KEM_SS_SZ];
+} bench_mlkem_t;
+
+typedef struct {
+    dilithium_key key;
+    u8 msg[BENCH_MSG_SIZE];
+    u8 sig[DILITHIUM_LEVEL3_SIG_SIZE];
+    word32 sig_len;
+} bench_mldsa_t;
+
+typedef struct {
+    ecc_key key;
+    u8 hash[WC_SHA384_DIGEST_SIZE];
+    word32 hash_len;
+    u8 sig[ECC_MAX_SIG_SIZE];
+    word32 sig_len;
+} bench_ecdsa_t;
+
+typedef struct {
+    Aes aes;
+    u8 data[BENCH_DATA_SIZE];
+    u8 out[BENCH_DATA_SIZE];
+    u8 tag[AES_BLOCK_SIZE];
+} bench_data_t;
+
+int custom_wc_GenerateSeed(OS_Seed* os, byte* output, word32 sz);
+
+static WC_RNG _rng;
+static bool _rng_ready = false;
+static void *_ctx = NULL;
+
+static void *_bench_alloc(u32 size)
+{   // zeroed, wolfCrypt free functions accept never initialized objects
+    _ctx = calloc(1, size);
+    return (_ctx);
+}
+
+// --- ML-KEM-768 ---
+
+static int _mlkem_setup(void)
+{   // key pair and one ciphertext for decapsulation
+    bench_mlkem_t *m = _bench_alloc(sizeof(bench_mlkem_t));
+    int ret;
+
+    if (m == NULL)
+        return (MEMORY_E);
+    ret = wc_MlKemKey_Init(&m->key, WC_ML_KEM_768, NULL, INVALID_DEVID);
+    if (ret == 0)
+        ret = wc_MlKemKey_MakeKey(&m->key, &_rng);
+    if (ret == 0)
+        ret = wc_MlKemKey_Encapsulate(&m->key, m->ct, m->ss, &_rng);
+    return (ret);
+}
+
+static int _mlkem_keygen(void)
+{
+    bench_mlkem_t *m = _ctx;
+
+    return (wc_MlKemKey_MakeKey(&m->key, &_rng));
+}
+
+static int _mlkem_encaps(void)
+{
+    bench_mlkem_t *m = _ctx;
+
+    return (wc_MlKemKey_Encapsulate(&m->key, m->ct, m->ss, &_rng));
+}
+
+static int _mlkem_decaps(void)
+{
+    bench_mlkem_t *m = _ctx;
+
+    return (wc_MlKemKey_Decapsulate(&m->key, m->ss, m->ct, sizeof(m->ct)));
+}
+
+static void _mlkem_cleanup(void)
+{
+    bench_mlkem_t *m = _ctx;
+
+    wc_MlKemKey_Free(&m->key);
+}
+
+// --- ML-DSA-65 ---
+
+static int _mldsa_public(dilithium_key *key)
+{   // alternative (ML-DSA) public key of the dual algorithm client certificate
+    const u8 *cert_der, *key_der;
+    u32 cert_len, key_len;
+    DecodedCert *cert;
+    word32 idx = 0;
+    int ret;
+
+    tls_pqc_client_credentials(&cert_der, &cert_len, &key_der, &key_len);
+    if ((cert = malloc(sizeof(DecodedCert))) == NULL)
+        return (MEMORY_E);
+
+    wc_InitDecodedCert(cert, cert_der, cert_len, NULL);
+    ret = wc_ParseCert(cert, CERT_TYPE, NO_VERIFY, NULL);
+    if ((ret == 0) && (cert->sapkiDer == NULL))
+        ret = ASN_PARSE_E;
+    if (ret == 0)
+        ret = wc_Dilithium_PublicKeyDecode(cert->sapkiDer, &idx, key, cert->sapkiLen);
+    wc_FreeDecodedCert(cert);
+    free(cert);
+    return (ret);
+}
+
+static int _mldsa_sign(void)
+{
+    bench_mldsa_t *m = _ctx;
+
+    m->sig_len = sizeof(m->sig);
+    return (wc_dilithium_sign_msg(m->msg, sizeof(m->msg), m->sig, &m->sig_len, &m->key, &_rng));
+}
+
+static int _mldsa_sign_setup(void)
+{   // TLS client private key
+    bench_mldsa_t *m = _bench_alloc(sizeof(bench_mldsa_t));
+    const u8 *cert_der, *key_der;
+    u32 cert_len, key_len;
+    word32 idx = 0;
+    int ret;
+
+    if (m == NULL)
+        return (MEMORY_E);
+    tls_pqc_client_credentials(&cert_der, &cert_len, &key_der, &key_len);
+    memset(m->msg, 0x5A, sizeof(m->msg));
+
+    ret = wc_dilithium_init(&m->key);
+    if (ret == 0)
+        ret = wc_dilithium_set_level(&m->key, WC_ML_DSA_65);
+    if (ret == 0)
+        ret = wc_Dilithium_PrivateKeyDecode(key_der, &idx, &m->key, key_len);
+    return (ret);
+}
+
+static int _mldsa_verify_setup(void)
+{   // one signature of the private key, public key from the certificate
+    bench_mldsa_t *m;
+    int ret;
+
+    ret = _mldsa_sign_setup();
+    if (ret == 0)
+        ret = _mldsa_sign();
+    m = _ctx;
+    if ((ret == 0) && (m != NULL))
+        ret = _mldsa_public(&m->key);
+    return (ret);
+}
+
+static int _mldsa_verify(void)
+{
+    bench_mldsa_t *m = _ctx;
+    int res = 0;
+    int ret;
+
+    ret = wc_dilithium_verify_msg(m->sig, m->sig_len, m->msg, sizeof(m->msg), &res, &m->key);
+    if ((ret == 0) && (res != 1))
+        ret = SIG_VERIFY_E;
+    return (ret);
+}
+
+static void _mldsa_cleanup(void)
+{
+    bench_mldsa_t *m = _ctx;
+
+    wc_dilithium_free(&m->key);
+}
+
+// --- ECDSA P-256, P-384 ---
+
+static int _ecdsa_setup(int curve, word32 size)
+{   // key pair and one signature of a hash of the curve size
+    bench_ecdsa_t *m = _bench_alloc(sizeof(bench_ecdsa_t));
+    int ret;
+
+    if (m == NULL)
+        return (MEMORY_E);
+    m->hash_len = size;
+    memset(m->hash, 0xA5, sizeof(m->hash));
+
+    ret = wc_ecc_init(&m->key);
+    if (ret == 0)
+        ret = wc_ecc_make_key_ex(&_rng, size, &m->key, curve);
+    if (ret == 0)
+    {
+        m->sig_len = sizeof(m->sig);
+        ret = wc_ecc_sign_hash(m->hash, m->hash_len, m->sig, &m->sig_len, &_rng, &m->key);
+    }
+    return (ret);
+}
+
+static int _ecdsa256_setup(void)
+{
+    return (_ecdsa_setup(ECC_SECP256R1, 32));
+}
+
+static int _ecdsa384_setup(void)
+{
+    return (_ecdsa_setup(ECC_SECP384R1, 48));
+}
+
+static int _ecdsa_sign(void)
+{
+    bench_ecdsa_t *m = _ctx;
+
+    m->sig_len = sizeof(m->sig);
+    return (wc_ecc_sign_hash(m->hash, m->hash_len, m->sig, &m->sig_len, &_rng, &m->key));
+}
+
+static int _ecdsa_verify(void)
+{
+    bench_ecdsa_t *m = _ctx;
+    int res = 0;
+    int ret;
+
+    ret = wc_ecc_verify_hash(m->sig, m->sig_len, m->hash, m->hash_len, &res, &m->key);
+    if ((ret == 0) && (res != 1))
+        ret = SIG_VERIFY_E;
+    return (ret);
+}
+
+static void _ecdsa_cleanup(void)
+{
+    bench_ecdsa_t *m = _ctx;
+
+    wc_ecc_free(&m->key);
+}
+
+// --- hashes, AES-GCM, HKDF, RNG on BENCH_DATA_SIZE of data ---
+
+static int _data_setup(void)
+{
+    bench_data_t *m = _bench_alloc(sizeof(bench_data_t));
+    u32 i;
+
+    if (m == NULL)
+        return (MEMORY_E);
+    for (i = 0; i < sizeof(m->data); i++)
+        m->data[i] = (u8)i;
+    return (0);
+}
+
+static int _sha256(void)
+{
+    bench_data_t *m = _ctx;
+
+    return (wc_Sha256Hash(m->data, sizeof(m->data), m->out));
+}
+
+static int _sha384(void)
+{
+    bench_data_t *m = _ctx;
+
+    return (wc_Sha384Hash(m->data, sizeof(m->data), m->out));
+}
+
+static int _sha3_256(void)
+{
+    bench_data_t *m = _ctx;
+
+    return (wc_Sha3_256Hash(m->data, sizeof(m->data), m->out));
+}
+
+static int _shake256(void)
+{   // 64 bytes of output
+    bench_data_t *m = _ctx;
+
+    return (wc_Shake256Hash(m->data, sizeof(m->data), m->out, 64));
+}
+
+static int _aesgcm_setup(void)
+{   // 256 bit key from the data pattern
+    bench_data_t *m;
+    int ret;
+
+    ret = _data_setup();
+    m = _ctx;
+    if (ret == 0)
+        ret = wc_AesInit(&m->aes, NULL, INVALID_DEVID);
+    if (ret == 0)
+        ret = wc_AesGcmSetKey(&m->aes, m->data, AES_256_KEY_SIZE);
+    return (ret);
+}
+
+static int _aesgcm(void)
+{   // 12 byte IV and 16 byte tag as in TLS 1.3, no AAD
+    bench_data_t *m = _ctx;
+
+    return (wc_AesGcmEncrypt(&m->aes, m->out, m->data, sizeof(m->data),
+                             &m->data[32], GCM_NONCE_MID_SZ, m->tag, sizeof(m->tag), NULL, 0));
+}
+
+static void _aesgcm_cleanup(void)
+{
+    bench_data_t *m = _ctx;
+
+    wc_AesFree(&m->aes);
+}
+
+static int _hkdf(void)
+{   // 32 byte IKM, salt and key, 16 byte info: one TLS 1.3 key derivation
+    bench_data_t *m = _ctx;
+
+    return (wc_HKDF(WC_SHA256, m->data, 32, &m->data[32], 32, &m->data[64], 16,
+                    m->out, WC_SHA256_DIGEST_SIZE));
+}
+
+static int _rng_hw(void)
+{   // STM32 RNG peripheral, seed source of the DRBG
+    bench_data_t *m = _ctx;
+
+    return (custom_wc_GenerateSeed(NULL, m->out, BENCH_RNG_SIZE));
+}
+
+static int _rng_drbg(void)
+{
+    bench_data_t *m = _ctx;
+
+    return (wc_RNG_GenerateBlock(&_rng, m->out, BENCH_RNG_SIZE));
+}
+
+static const bench_entry_t _BENCH[] = {
+    {"MLKEM768_KEYGEN", 0,               _mlkem_setup,        _mlkem_keygen,  _mlkem_cleanup},
+    {"MLKEM768_ENCAPS", 0,               _mlkem_setup,        _mlkem_encaps,  _mlkem_cleanup},
+    {"MLKEM768_DECAPS", 0,               _mlkem_setup,        _mlkem_decaps,  _mlkem_cleanup},
+    {"MLDSA65_SIGN",    0,               _mldsa_sign_setup,   _mldsa_sign,    _mldsa_cleanup},
+    {"MLDSA65_VERIFY",  0,               _mldsa_verify_setup, _mldsa_verify,  _mldsa_cleanup},
+    {"ECDSA256_SIGN",   0,               _ecdsa256_setup,     _ecdsa_sign,    _ecdsa_cleanup},
+    {"ECDSA256_VERIFY", 0,               _ecdsa256_setup,     _ecdsa_verify,  _ecdsa_cleanup},
+    {"ECDSA384_SIGN",   0,               _ecdsa384_setup,     _ecdsa_sign,    _ecdsa_cleanup},
+    {"ECDSA384_VERIFY", 0,               _ecdsa384_setup,     _ecdsa_verify,  _ecdsa_cleanup},
+    {"SHA256",          BENCH_DATA_SIZE, _data_setup,         _sha256,        NULL},
+    {"SHA384",          BENCH_DATA_SIZE, _data_setup,         _sha384,        NULL},
+    {"SHA3_256",        BENCH_DATA_SIZE, _data_setup,         _sha3_256,      NULL},
+    {"SHAKE256",        BENCH_DATA_SIZE, _data_setup,         _shake256,      NULL},
+    {"AES256GCM",       BENCH_DATA_SIZE, _aesgcm_setup,       _aesgcm,        _aesgcm_cleanup},
+    {"HKDF_SHA256",     0,               _data_setup,         _hkdf,          NULL},
+    {"RNG_HW",          BENCH_RNG_SIZE,  _data_setup,         _rng_hw,        NULL},
+    {"RNG_DRBG",        BENCH_RNG_SIZE,  _data_setup,         _rng_drbg,      NULL},
+};
+
+#define BENCH_COUNT     (sizeof(_BENCH) / sizeof(_BENCH[0]))
+
+u32 bench_cycles(void)
+{   // counter started by prof_cycles_init() at init
+    return (_BENCH_CLOCK());
+}
+
+u32 bench_count(void)
+{
+    return (BENCH_COUNT);
+}
+
+const char *bench_name(u32 index)
+{
+    return ((index < BENCH_COUNT) ? _BENCH[index].name : "?");
+}
+
+u32 bench_bytes(u32 index)
+{
+    return ((index < BENCH_COUNT) ? _BENCH[index].bytes : 0);
+}
+
+bool bench_find(const char *name, u32 len, u32 *index)
+{
+    u32 i;
+
+    for (i = 0; i < BENCH_COUNT; i++)
+    {
+        if ((strlen(_BENCH[i].name) == len) && (strncasecmp(_BENCH[i].name, name, len) == 0))
+        {
+            *index = i;
+            return (true);
+        }
+    }
+    return (false);
+}
+
+bool bench_run(u32 index, u32 iterations, bench_result_t *result)
+{
+    const bench_entry_t *entry;
+    mem_peak_t peak;
+    u32 start, cycles;
+    int ret = 0;
+
+    memset(result, 0, sizeof(*result));
+    if (index >= BENCH_COUNT)
+    {
+        result->error = BAD_FUNC_ARG;
+        return (false);
+    }
+    entry = &_BENCH[index];
+    result->bytes = entry->bytes;
+    result->min = (u32)-1;
+
+    if (! _rng_ready)
+    {
+        ret = wc_InitRng(&_rng);
+        _rng_ready = (ret == 0);
+    }
+    if (ret == 0)
+        ret = entry->setup();
+
+    if (ret == 0)
+    {   // only the operations count, setup allocations are the base
+        mem_mark();
+        while (result->iterations < iterations)
+        {
+            start = _BENCH_CLOCK();
+            ret = entry->op();
+            cycles = _BENCH_CLOCK() - start;
+            if (ret != 0)
+                break;
+
+            result->iterations++;
+            result->cycles += cycles;
+            if (cycles < result->min)
+                result->min = cycles;
+            if (cycles > result->max)
+                result->max = cycles;
+            wd_feed();
+        }
+        mem_since_mark(&peak);
+        result->stack = peak.stack;
+        result->heap = peak.heap;
+    }
+
+    if (_ctx != NULL)
+    {
+        if (entry->cleanup != NULL)
+            entry->cleanup();
+        free(_ctx);
+        _ctx = NULL;
+    }
+    if (result->iterations == 0)
+        result->min = 0;
+    result->error = ret;
+    return (ret == 0);
+}
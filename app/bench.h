@@ -0,0 +1,37 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include "common.h"
+
+// Crypto micro-benchmark of the primitives the firmware uses. Each entry
+// prepares keys and inputs once, then runs its operation the requested
+// number of times; cycles come from DWT CYCCNT and only the operations
+// are counted. Hash, AEAD and RNG entries process BENCH_DATA_SIZE bytes
+// (or 32 B for RNG) per operation.
+
+#define BENCH_DATA_SIZE         (1024)
+#define BENCH_ITERATIONS_MAX    (100000UL)
+
+typedef struct {
+    u32 iterations;     // operations done
+    u32 bytes;          // per operation, 0 == key operation
+    u64 cycles;         // all operations together
+    u32 min;            // cycles of fastest and slowest operation
+    u32 max;
+    u32 stack;          // deepest stack use from _estack during operations
+    u32 heap;           // heap peak above heap in use after setup
+    int error;          // wolfCrypt error of setup or first failed operation
+} bench_result_t;
+
+u32 bench_count(void);
+const char *bench_name(u32 index);
+// data per operation, 0 == key operation
+u32 bench_bytes(u32 index);
+// case insensitive, false when not found
+bool bench_find(const char *name, u32 len, u32 *index);
+// false on error, result->error tells which
+bool bench_run(u32 index, u32 iterations, bench_result_t *result);
+// cycle counter of the entries, also for REPLAY (host: ns or instructions)
+u32 bench_cycles(void);
+
+#endif // ! BENCH_H
@@ -1,14 +1,27 @@
 #include "common.h"
 #include "cmd.h"
+#include "arena.h"
+#include "bench.h"
 #include "hardware.h"
 #include "gpreg.h"
 #include "gpio.h"
+#include "l2.h"
+#include "l3.h"
 #include "wd.h"
 #include "main.h"
+#include "mem.h"
+#include "pairing.h"
+#include "prof.h"
 #include "spi.h"
+#include "spi_script.h"
+#include "spi_stream.h"
+#include "stats.h"
+#include "sys.h"
 #include "time.h"
 #include "tls_pqc.h"
+#include "tty.h"
 #include "usb_device.h"
+#include "usb_bench.h"
 
 #include "version.h"
 
@@ -21,6 +34,20 @@ typedef struct _cmd_t {
 
 static const cmd_t _CMD_TABLE[];
 
+// peaks of each command run through cmd_parse(), index in _CMD_TABLE
+#define CMD_MEM_MAX     (40)
+
+typedef struct {
+    u32 runs;
+    u32 stack;      // deepest stack use from _estack
+    u32 heap;       // heap peak above heap in use before the command
+} cmd_mem_t;
+
+static cmd_mem_t _cmd_mem[CMD_MEM_MAX];
+
+// runs of each command since power on or STATS=0, index in _CMD_TABLE
+static u32 _cmd_runs[CMD_MEM_MAX];
+
 static const char *ERR_INVALID_PARAMETER = "invalid parameter";
 static const char *ERR_MISSING_PARAMETER = "missing parameter";
 static const char *ERR_ILLEGAL_PARAMETER = "illegal parameter";
@@ -141,7 +168,7 @@ static bool _cmd_help(const cmd_t *cmd)
     int i;
 
     OS_PRINTF("Tropicsquare USB/SPI interface" NL);
-    OS_PRINTF("STM32 accepts named commands only; raw hex pass-through is disabled" NL);
+    OS_PRINTF("HEX line (e.g. 010202002b98) is sent to SPI, trailing x or \\ keeps CS low" NL);
     OS_PRINTF("Supported commands:" NL);
 
     for (i = 0; ; i++)
@@ -163,9 +190,9 @@ static bool _cmd_help(const cmd_t *cmd)
 
 static bool _cmd_tls(const cmd_t *cmd)
 {
-	/* Don't print help message - it would be forwarded by USB bridge and corrupt TLS stream */
+	/* TLS records use own CDC data interface (or MUX TLS channel), console text doesn't corrupt them */
 	/* Use "TLS=" or "TLS " to start handshake */
-	/* OS_PRINTF("%s: perform TLS 1.3 handshake over USB (ML-KEM-768)\n", cmd->text); */
+	OS_PRINTF("%s: perform TLS 1.3 handshake over USB (ML-KEM-768)" NL, cmd->text);
 	return (true);
 }
 
@@ -173,6 +200,7 @@ static bool _cmd_tls_set(const struct _cmd_t *cmd, const char **pptext)
 {
 	(void)cmd;
 	const char* data_to_send = NULL;
+	bool ok;
 	
 	/* If there's text after "TLS", use it as application data to send */
 	if (pptext != NULL && *pptext != NULL && **pptext != '\0') {
@@ -187,8 +215,10 @@ static bool _cmd_tls_set(const struct _cmd_t *cmd, const char **pptext)
 	}
 	
 	/* tls_pqc_handshake_with_data() will print the status message itself */
-	/* Don't print here to avoid interfering with TLS data stream */
-	return tls_pqc_handshake_with_data(data_to_send);
+	main_clock_boost(true);
+	ok = tls_pqc_handshake_with_data(data_to_send);
+	main_clock_boost(false);
+	return ok;
 }
 
 
@@ -242,6 +272,203 @@ err:
     return (false);
 }
 
+static bool _cmd_autopoll(const cmd_t *cmd)
+{
+    _cmd_basic_reply(cmd);
+    OS_PRINTF("%lu" NL, (unsigned long)main_spi_poll_ms);
+    return (true);
+}
+
+static bool _cmd_autopoll_set(const struct _cmd_t *cmd, const char **pptext)
+{
+    s32 value;
+
+    if ((! _cmd_fetch_num(&value, pptext)) || (value < 1) || (value > 10000))
+    {
+        _cmd_error(ERR_INVALID_PARAMETER);
+        return (false);
+    }
+
+    main_spi_poll_ms = value;
+    return (true);
+}
+
+static bool _cmd_autostat(const cmd_t *cmd)
+{   // <GPO reads>, <polled reads>, <min us>, <avg us>, <max us>
+    main_auto_stats_t *st = &main_auto_stats;
+
+    _cmd_basic_reply(cmd);
+    if (st->count == 0)
+    {
+        OS_PRINTF("0, %lu, 0, 0, 0" NL, (unsigned long)st->polled);
+        return (true);
+    }
+    OS_PRINTF("%lu, %lu, %lu, %lu, %lu" NL, (unsigned long)st->count, (unsigned long)st->polled,
+              (unsigned long)st->min_us, (unsigned long)(st->sum_us / st->count),
+              (unsigned long)st->max_us);
+    return (true);
+}
+
+static bool _cmd_autostat_set(const struct _cmd_t *cmd, const char **pptext)
+{
+    bool state;
+
+    if ((! _cmd_fetch_bool(&state, pptext)) || state)
+    {
+        _cmd_error(ERR_INVALID_PARAMETER);
+        return (false);
+    }
+
+    main_auto_stats_reset();
+    return (true);
+}
+
+static bool _cmd_bench(const cmd_t *cmd)
+{   // <entries>, then <name>, <bytes per operation>
+    u32 i;
+
+    _cmd_basic_reply(cmd);
+    OS_PRINTF("%lu" NL, (unsigned long)bench_count());
+    for (i = 0; i < bench_count(); i++)
+        OS_PRINTF("%s, %lu" NL, bench_name(i), (unsigned long)bench_bytes(i));
+    return (true);
+}
+
+static bool _cmd_bench_set(const struct _cmd_t *cmd, const char **pptext)
+{   // BENCH=<iterations>[,<name>], all entries without name
+    bench_result_t result;
+    u32 first = 0;
+    u32 last = bench_count();
+    u32 i, avg, ops;
+    bool ok = true;
+    s32 iterations;
+
+    if ((! _cmd_fetch_num(&iterations, pptext)) || (iterations <= 0) ||
+        ((u32)iterations > BENCH_ITERATIONS_MAX))
+    {
+        _cmd_error(ERR_INVALID_PARAMETER);
+        return (false);
+    }
+    if (_cmd_fetch_next(pptext))
+    {
+        if (! bench_find(*pptext, strcspn(*pptext, " \t\r\n"), &first))
+        {
+            _cmd_error(ERR_INVALID_PARAMETER);
+            return (false);
+        }
+        last = first + 1;
+    }
+
+    // <system clock Hz>, then per entry:
+    // <name>, <iterations>, <bytes>, <avg>, <min>, <max> cycles, <ops/s>, <stack>, <heap>
+    _cmd_basic_reply(cmd);
+    OS_PRINTF("%lu" NL, (unsigned long)sys_get_hclk());
+    for (i = first; i < last; i++)
+    {
+        if (! bench_run(i, (u32)iterations, &result))
+        {
+            OS_PRINTF("%s, ERROR %d" NL, bench_name(i), result.error);
+            ok = false;
+        }
+        else
+        {
+            avg = (u32)(result.cycles / result.iterations);
+            ops = (u32)(((u64)sys_get_hclk() * result.iterations) / result.cycles);
+            OS_PRINTF("%s, %lu, %lu, %lu, %lu, %lu, %lu, %lu, %lu" NL, bench_name(i),
+                      (unsigned long)result.iterations, (unsigned long)result.bytes,
+                      (unsigned long)avg, (unsigned long)result.min, (unsigned long)result.max,
+                      (unsigned long)ops, (unsigned long)result.stack, (unsigned long)result.heap);
+        }
+        OS_FLUSH();
+    }
+    if (! ok)
+    {
+        _cmd_error("benchmark failed");
+        return (false);
+    }
+    return (true);
+}
+
+#if TEST_ENABLE
+static bool _cmd_replay(const cmd_t *cmd)
+{   // <flight bytes>, <seed> of the compiled in flight
+    u32 seed;
+    u32 size = tls_pqc_replay_flight(&seed);
+
+    _cmd_basic_reply(cmd);
+    OS_PRINTF("%lu, %lu" NL, (unsigned long)size, (unsigned long)seed);
+    return (true);
+}
+
+static bool _cmd_replay_set(const struct _cmd_t *cmd, const char **pptext)
+{   // REPLAY=<iterations>[,<bytes per ms>], flight at once without rate
+    tls_pqc_replay_t result;
+    s32 iterations;
+    s32 rate = 0;
+    u32 seed;
+    bool ok;
+
+    if ((! _cmd_fetch_num(&iterations, pptext)) || (iterations <= 0) ||
+        (iterations > TLS_PQC_REPLAY_MAX))
+    {
+        _cmd_error(ERR_INVALID_PARAMETER);
+        return (false);
+    }
+    if (_cmd_fetch_next(pptext) && ((! _cmd_fetch_num(&rate, pptext)) || (rate < 0)))
+    {
+        _cmd_error(ERR_INVALID_PARAMETER);
+        return (false);
+    }
+    if (tls_pqc_replay_flight(&seed) == 0)
+    {
+        _cmd_error("no flight compiled in, see tls_usb_test/replay_flight.py");
+        return (false);
+    }
+
+    main_clock_boost(true);
+    ok = tls_pqc_replay((u32)iterations, (u32)rate, &result);
+    main_clock_boost(false);
+    if (! ok)
+    {
+        OS_PRINTF("%s: ERROR %d, %lu done" NL, cmd->text, result.error, (unsigned long)result.iterations);
+        _cmd_error("replay failed");
+        return (false);
+    }
+
+    // <system clock Hz>, <handshakes>, <flight bytes>, <client bytes>, <client CRC16>,
+    // <avg>, <min>, <max> cycles, <avg us>, <stack>, <heap>
+    _cmd_basic_reply(cmd);
+    OS_PRINTF("%lu, %lu, %lu, %lu, %04X, %lu, %lu, %lu, %lu, %lu, %lu" NL,
+              (unsigned long)sys_get_hclk(), (unsigned long)result.iterations,
+              (unsigned long)result.flight, (unsigned long)result.sent, result.crc,
+              (unsigned long)(result.cycles / result.iterations),
+              (unsigned long)result.min, (unsigned long)result.max,
+              (unsigned long)(result.time_us / result.iterations),
+              (unsigned long)result.stack, (unsigned long)result.heap);
+    return (true);
+}
+
+static bool _cmd_seed(const cmd_t *cmd)
+{
+    _cmd_basic_reply(cmd);
+    OS_PRINTF("%lu" NL, (unsigned long)main_seed);
+    return (true);
+}
+
+static bool _cmd_seed_set(const struct _cmd_t *cmd, const char **pptext)
+{   // test only: next handshakes repeat their RNG output, 0 == RNG peripheral
+    s32 value;
+
+    if ((! _cmd_fetch_num(&value, pptext)) || (value < 0))
+    {
+        _cmd_error(ERR_INVALID_PARAMETER);
+        return (false);
+    }
+    main_seed_set((u32)value);
+    return (true);
+}
+#endif // TEST_ENABLE
+
 #ifdef HW_BUTTON_PRESSED
 static bool _cmd_button(const cmd_t *cmd)
 {
@@ -280,7 +507,7 @@ static bool _cmd_cs_set(const struct _cmd_t *cmd, const char **pptext)
 static bool _cmd_clkdiv(const cmd_t *cmd)
 {
     _cmd_basic_reply(cmd);
-    OS_PRINTF("%lu" NL, spi1_get_prescaler());
+    OS_PRINTF("%lu" NL, (unsigned long)spi1_get_prescaler());
     return (true);
 }
 
@@ -301,6 +528,588 @@ err:
     return (false);
 }
 
+static bool _cmd_clock(const cmd_t *cmd)
+{
+    _cmd_basic_reply(cmd);
+    OS_PRINTF("%u, %lu" NL, main_clock_mode, (unsigned long)sys_get_hclk());
+    return (true);
+}
+
+static bool _cmd_clock_set(const struct _cmd_t *cmd, const char **pptext)
+{
+    s32 mode;
+
+    if (! _cmd_fetch_num(&mode, pptext))
+    {
+        _cmd_error(ERR_INVALID_PARAMETER);
+        return (false);
+    }
+    if ((mode < 0) || (! main_clock_set((u8)mode)))
+    {
+        _cmd_error(ERR_ILLEGAL_PARAMETER);
+        return (false);
+    }
+    return (true);
+}
+
+static bool _cmd_mux(const cmd_t *cmd)
+{
+    _cmd_basic_reply(cmd);
+    OS_PRINTF("%d, %lu" NL, tty_mux_enabled() ? 1 : 0, (unsigned long)tty_mux_errors());
+    return (true);
+}
+
+static bool _cmd_mux_set(const struct _cmd_t *cmd, const char **pptext)
+{
+    bool state;
+
+    if (! _cmd_fetch_bool(&state, pptext))
+    {
+        _cmd_error(ERR_INVALID_PARAMETER);
+        return (false);
+    }
+
+    tty_mux_request(state); // "OK" is still sent in current mode
+    return (true);
+}
+
+static bool _cmd_usbbench(const cmd_t *cmd)
+{
+    _cmd_basic_reply(cmd);
+    OS_PRINTF("USBBENCH=<mode>,<bytes> on CDC data port, mode 0 = source, 1 = sink, 2 = echo" NL);
+    return (true);
+}
+
+static bool _cmd_usbbench_set(const struct _cmd_t *cmd, const char **pptext)
+{
+    usb_bench_result_t result;
+    s32 mode;
+    s32 len;
+    bool ok;
+
+    if ((! _cmd_fetch_num(&mode, pptext)) || (! _cmd_fetch_next(pptext)) ||
+        (! _cmd_fetch_num(&len, pptext)) || (len <= 0))
+    {
+        _cmd_error(ERR_INVALID_PARAMETER);
+        return (false);
+    }
+    if ((mode < 0) || (mode >= USB_BENCH_MODES))
+    {
+        _cmd_error(ERR_ILLEGAL_PARAMETER);
+        return (false);
+    }
+
+    if (! usb_bench_start((usb_bench_mode_e)mode))
+    {
+        _cmd_error("data port not open or in use");
+        return (false);
+    }
+    if (mode != USB_BENCH_SOURCE)
+    {   // host starts sending after this line
+        _cmd_basic_reply(cmd);
+        OS_PRINTF("READY" NL);
+        OS_FLUSH();
+    }
+
+    ok = usb_bench_run((usb_bench_mode_e)mode, (u32)len, &result);
+
+    // <bytes>, <us>, <KB/s>, <retries>, <rx calls>, <drops>, <crc>
+    _cmd_basic_reply(cmd);
+    OS_PRINTF("%lu, %lu, %lu, %lu, %lu, %lu, %04X" NL,
+              (unsigned long)result.bytes, (unsigned long)result.time_us,
+              (result.time_us > 0) ? (unsigned long)(((u64)result.bytes * 1000) / result.time_us) : 0UL,
+              (unsigned long)result.retries, (unsigned long)result.rx_calls,
+              (unsigned long)result.drops, result.crc);
+    if (! ok)
+    {
+        _cmd_error("timeout");
+        return (false);
+    }
+    return (true);
+}
+
+static void _cmd_print_hex(const u8 *data, u32 len)
+{   // up to L3_DATA_MAX bytes, L2 frames are shorter
+    static char text[2*L3_DATA_MAX + sizeof(NL)];
+
+    len = bin_to_hex(text, data, len);
+    memcpy(&text[len], NL, sizeof(NL));
+    OS_PUTTEXT(text);
+}
+
+static bool _cmd_l2(const cmd_t *cmd)
+{
+    _cmd_basic_reply(cmd);
+    OS_PRINTF("%lu requests, %lu polls, %lu CRC retries, %lu timeouts" NL,
+              (unsigned long)l2_stats.requests, (unsigned long)l2_stats.polls,
+              (unsigned long)l2_stats.crc_retries, (unsigned long)l2_stats.timeouts);
+    return (true);
+}
+
+static bool _cmd_l2_set(const struct _cmd_t *cmd, const char **pptext)
+{   // L2=<ID LEN DATA in HEX>[,<timeout ms>], CRC is added by device
+    static u8 req[L2_FRAME_MAX];
+    static u8 resp[L2_FRAME_MAX];
+    l2_result_e result;
+    s32 timeout = L2_TIMEOUT_MS;
+    int len;
+
+    len = hex_to_bin(req, *pptext, L2_FRAME_MAX - 2);
+    *pptext += 2*len;
+    if ((len < 2) || (req[1] != (len - 2)))
+    {
+        _cmd_error(l2_result_text(L2_ERR_PARAM));
+        return (false);
+    }
+    if (_cmd_fetch_next(pptext) && ((! _cmd_fetch_num(&timeout, pptext)) || (timeout <= 0)))
+    {
+        _cmd_error(ERR_INVALID_PARAMETER);
+        return (false);
+    }
+
+    PROF_BEGIN(PROF_L2);
+    result = l2_transfer(req, resp, timeout);
+    PROF_END(PROF_L2);
+    while (result == L2_OK)
+    {   // every response frame on own line: STATUS LEN DATA CRC
+        _cmd_basic_reply(cmd);
+        _cmd_print_hex(resp, 2 + resp[1] + 2);
+        if (resp[0] != L2_STATUS_RES_CONT)
+            return (true);
+        result = l2_response(resp, timeout);
+    }
+
+    _cmd_error(l2_result_text(result));
+    return (false);
+}
+
+#if L3_ENABLE
+static bool _cmd_l3_error(l3_result_e result)
+{
+    if (result == L3_ERR_STATUS)
+        OS_PRINTF("ERROR: %s %02X" NL, l3_result_text(result), l3_l2_status);
+    else
+        _cmd_error(l3_result_text(result));
+    return (false);
+}
+
+static bool _cmd_l3(const cmd_t *cmd)
+{
+    _cmd_basic_reply(cmd);
+    OS_PRINTF("%u, %lu sessions, %lu commands, %lu auth errors, %lu us handshake, %lu us command" NL,
+              l3_session_active() ? 1 : 0, (unsigned long)l3_stats.sessions,
+              (unsigned long)l3_stats.commands, (unsigned long)l3_stats.auth_errors,
+              (unsigned long)l3_stats.last_handshake_us, (unsigned long)l3_stats.last_command_us);
+    return (true);
+}
+
+static bool _cmd_l3_set(const struct _cmd_t *cmd, const char **pptext)
+{   // L3=<CMD_ID DATA in HEX>[,<timeout ms>], encrypted and chunked by device
+    static u8 req[L3_DATA_MAX];
+    static u8 res[L3_DATA_MAX];
+    l3_result_e result;
+    s32 timeout = L2_TIMEOUT_MS;
+    u32 res_len = sizeof(res);
+    int len;
+
+    len = hex_to_bin(req, *pptext, sizeof(req));
+    *pptext += 2*len;
+    if (len < 1)
+    {
+        _cmd_error(l3_result_text(L3_ERR_PARAM));
+        return (false);
+    }
+    if (_cmd_fetch_next(pptext) && ((! _cmd_fetch_num(&timeout, pptext)) || (timeout <= 0)))
+    {
+        _cmd_error(ERR_INVALID_PARAMETER);
+        return (false);
+    }
+
+    PROF_BEGIN(PROF_L3);
+    result = l3_command(req, len, res, &res_len, timeout);
+    PROF_END(PROF_L3);
+    if (result != L3_OK)
+        return (_cmd_l3_error(result));
+
+    // RESULT DATA
+    _cmd_basic_reply(cmd);
+    _cmd_print_hex(res, res_len);
+    return (true);
+}
+
+static bool _cmd_l3session(const cmd_t *cmd)
+{
+    _cmd_basic_reply(cmd);
+    OS_PRINTF("%u" NL, l3_session_active() ? 1 : 0);
+    return (true);
+}
+
+static bool _cmd_l3session_set(const struct _cmd_t *cmd, const char **pptext)
+{   // L3SESSION=<pkey index>[,<timeout ms>], L3SESSION=-1 aborts
+    // keys come from the pairing flash page, private keys never go over USB
+    u8 sh_priv[L3_KEY_SIZE];
+    u8 st_pub[L3_KEY_SIZE];
+    l3_result_e result;
+    s32 index, timeout = L2_TIMEOUT_MS;
+
+    if (! _cmd_fetch_num(&index, pptext))
+    {
+        _cmd_error(ERR_INVALID_PARAMETER);
+        return (false);
+    }
+    if (index < 0)
+    {
+        l3_session_abort(timeout);
+        return (true);
+    }
+    if (index > L3_PKEY_INDEX_MAX)
+    {
+        _cmd_error(ERR_ILLEGAL_PARAMETER);
+        return (false);
+    }
+
+    if (_cmd_fetch_next(pptext) && ((! _cmd_fetch_num(&timeout, pptext)) || (timeout <= 0)))
+    {
+        _cmd_error(ERR_INVALID_PARAMETER);
+        return (false);
+    }
+    if (! pairing_get(index, sh_priv, st_pub))
+    {
+        _cmd_error("pairing key not provisioned");
+        return (false);
+    }
+
+    main_clock_boost(true);
+    PROF_BEGIN(PROF_L3_SESSION);
+    result = l3_session_start(index, sh_priv, st_pub, timeout);
+    PROF_END(PROF_L3_SESSION);
+    main_clock_boost(false);
+    memset(sh_priv, 0, sizeof(sh_priv));
+    if (result != L3_OK)
+        return (_cmd_l3_error(result));
+    return (true);
+}
+#endif // L3_ENABLE
+
+static bool _cmd_spiscript_set(const struct _cmd_t *cmd, const char **pptext)
+{   // SPISCRIPT=<operations>, see spi_script.h
+    static spi_script_reply_t reply SRAM4_BSS; // captures are DMA targets
+    static char text[3*SPI_SCRIPT_DATA_MAX + sizeof(NL)];
+    spi_script_result_e result;
+    u32 i, pos, len;
+
+    result = spi_script_parse(*pptext, &reply);
+    if (result != SPI_SCRIPT_OK)
+    {
+        OS_PRINTF("ERROR: %s, operation %lu" NL, spi_script_result_text(result), (unsigned long)(reply.ops + 1));
+        return (false);
+    }
+
+    result = spi_script_run(&reply);
+
+    // SPISCRIPT: <ops>, <us>, <polls>, <captured responses separated by space>
+    _cmd_basic_reply(cmd);
+    OS_PRINTF("%lu, %lu, %lu,", (unsigned long)reply.ops, (unsigned long)reply.time_us,
+              (unsigned long)reply.polls);
+    len = 0;
+    for (i = 0, pos = 0; i < reply.captures; pos += reply.len[i++])
+    {
+        text[len++] = ' ';
+        len += bin_to_hex(&text[len], &reply.data[pos], reply.len[i]);
+    }
+    memcpy(&text[len], NL, sizeof(NL));
+    OS_PUTTEXT(text);
+
+    if (result != SPI_SCRIPT_OK)
+    {
+        OS_PRINTF("ERROR: %s, operation %lu" NL, spi_script_result_text(result), (unsigned long)reply.ops);
+        return (false);
+    }
+    return (true);
+}
+
+static u32 _cmd_rate(u32 bytes, u32 time_us)
+{   // [MB/s * 100]
+    return ((time_us > 0) ? (u32)(((u64)bytes * 100) / time_us) : 0UL);
+}
+
+static bool _cmd_spistream_set(const struct _cmd_t *cmd, const char **pptext)
+{   // SPISTREAM=<R|W>,<bytes>[,<hex prefix>]
+    u8 prefix[SPI_STREAM_PREFIX_MAX];
+    spi_stream_result_t result;
+    spi_stream_mode_e mode;
+    s32 len, prefix_len = 0;
+    u32 rate;
+    bool ok;
+
+    switch (toupper((unsigned char)**pptext))
+    {
+    case 'R': mode = SPI_STREAM_READ;  break;
+    case 'W': mode = SPI_STREAM_WRITE; break;
+    default:
+        _cmd_error(ERR_INVALID_PARAMETER);
+        return (false);
+    }
+    (*pptext)++;
+    if ((! _cmd_fetch_next(pptext)) || (! _cmd_fetch_num(&len, pptext)) ||
+        (len <= 0) || ((u32)len > SPI_STREAM_LEN_MAX))
+    {
+        _cmd_error(ERR_INVALID_PARAMETER);
+        return (false);
+    }
+    if (_cmd_fetch_next(pptext))
+    {
+        prefix_len = hex_to_bin(prefix, *pptext, sizeof(prefix));
+        if ((prefix_len <= 0) || is_hex(*(*pptext + 2*prefix_len)))
+        {
+            _cmd_error(ERR_INVALID_PARAMETER);
+            return (false);
+        }
+    }
+
+    if (! spi_stream_start(mode))
+    {
+        _cmd_error("data port not open or in use");
+        return (false);
+    }
+    if (mode == SPI_STREAM_WRITE)
+    {   // host starts sending after this line
+        _cmd_basic_reply(cmd);
+        OS_PRINTF("READY" NL);
+        OS_FLUSH();
+    }
+
+    ok = spi_stream_run(mode, prefix, prefix_len, (u32)len, &result);
+
+    // <bytes>, <us>, <MB/s>, <SPI blocks>, <SPI waits>, <USB waits>
+    rate = _cmd_rate(result.bytes, result.time_us);
+    _cmd_basic_reply(cmd);
+    OS_PRINTF("%lu, %lu, %lu.%02lu, %lu, %lu, %lu" NL,
+              (unsigned long)result.bytes, (unsigned long)result.time_us,
+              (unsigned long)(rate / 100), (unsigned long)(rate % 100),
+              (unsigned long)result.blocks, (unsigned long)result.spi_waits,
+              (unsigned long)result.usb_waits);
+    if (! ok)
+    {
+        _cmd_error("timeout");
+        return (false);
+    }
+    return (true);
+}
+
+static bool _cmd_spibench_set(const struct _cmd_t *cmd, const char **pptext)
+{   // SPIBENCH=<bytes>, SPI only, byte mode and packed mode
+    spi_stream_result_t bytes, packed;
+    u32 rate_bytes, rate_packed;
+    s32 len;
+
+    if ((! _cmd_fetch_num(&len, pptext)) || (len < 4) || ((u32)len > SPI_STREAM_LEN_MAX))
+    {
+        _cmd_error(ERR_INVALID_PARAMETER);
+        return (false);
+    }
+    if ((! spi_stream_bench(false, (u32)len, &bytes)) || (! spi_stream_bench(true, (u32)len, &packed)))
+    {
+        _cmd_error("SPI busy");
+        return (false);
+    }
+
+    // <SCK Hz>, <bytes>, <byte mode us>, <MB/s>, <packed us>, <MB/s>
+    rate_bytes = _cmd_rate(bytes.bytes, bytes.time_us);
+    rate_packed = _cmd_rate(packed.bytes, packed.time_us);
+    _cmd_basic_reply(cmd);
+    OS_PRINTF("%lu, %lu, %lu, %lu.%02lu, %lu, %lu.%02lu" NL,
+              (unsigned long)spi1_get_frequency(), (unsigned long)bytes.bytes,
+              (unsigned long)bytes.time_us,
+              (unsigned long)(rate_bytes / 100), (unsigned long)(rate_bytes % 100),
+              (unsigned long)packed.time_us,
+              (unsigned long)(rate_packed / 100), (unsigned long)(rate_packed % 100));
+    return (true);
+}
+
+static bool _cmd_spitrace(const cmd_t *cmd)
+{   // stops recording, ring stays until SPITRACE=1
+    static const char *SOURCE[SPI_SOURCES] = {"RAW", "AUTO", "CMD", "L2"};
+    spi_trace_t entry;
+    u32 i;
+
+    spi1_trace_enable(false);
+
+    // <entries>, <lost>, then per transfer oldest first:
+    // <start us>, <duration us>, <source>, <flags>, <len>, <prescaler>, <MOSI first last>, <MISO first last>
+    _cmd_basic_reply(cmd);
+    OS_PRINTF("%lu, %lu" NL, (unsigned long)spi1_trace_count(), (unsigned long)spi1_trace_lost());
+    for (i = 0; spi1_trace_get(i, &entry); i++)
+    {
+        OS_PRINTF("%lu, %lu, %s, %X, %u, %u, %02X%02X, %02X%02X" NL,
+                  (unsigned long)entry.start_us, (unsigned long)(entry.end_us - entry.start_us),
+                  (entry.source < SPI_SOURCES) ? SOURCE[entry.source] : "?",
+                  entry.flags, entry.len, entry.prescaler,
+                  entry.tx[0], entry.tx[1], entry.rx[0], entry.rx[1]);
+        wd_feed();
+    }
+    return (true);
+}
+
+static bool _cmd_spitrace_set(const struct _cmd_t *cmd, const char **pptext)
+{
+    bool enable;
+
+    if (! _cmd_fetch_bool(&enable, pptext))
+    {
+        _cmd_error(ERR_INVALID_PARAMETER);
+        return (false);
+    }
+    spi1_trace_enable(enable);
+    return (true);
+}
+
+#if PROF_ENABLE
+static bool _cmd_prof(const cmd_t *cmd)
+{   // cycles, average in us at current system clock
+    const prof_zone_t *zone;
+    u32 avg;
+    int i;
+
+    // <system clock Hz>, then per zone with calls:
+    // <zone>, <calls>, <min>, <avg>, <max> cycles, <avg us>
+    _cmd_basic_reply(cmd);
+    OS_PRINTF("%lu" NL, (unsigned long)sys_get_hclk());
+    for (i = 0; i < PROF_ZONES; i++)
+    {
+        zone = &prof_zone[i];
+        if (zone->calls == 0)
+            continue;
+        avg = (u32)(zone->sum / zone->calls);
+        OS_PRINTF("%s, %lu, %lu, %lu, %lu, %lu" NL, prof_name(i), (unsigned long)zone->calls,
+                  (unsigned long)zone->min, (unsigned long)avg, (unsigned long)zone->max,
+                  (unsigned long)(avg / (sys_get_hclk() / 1000000)));
+    }
+    return (true);
+}
+
+static bool _cmd_prof_set(const struct _cmd_t *cmd, const char **pptext)
+{
+    s32 value;
+
+    if ((! _cmd_fetch_num(&value, pptext)) || (value != 0))
+    {
+        _cmd_error(ERR_INVALID_PARAMETER);
+        return (false);
+    }
+    prof_reset();
+    return (true);
+}
+#endif // PROF_ENABLE
+
+static bool _cmd_mem_show(const cmd_t *cmd)
+{   // static sections, heap and stack figures [B], then commands that ran
+    const cmd_mem_t *m;
+    mem_info_t info;
+    int i;
+
+    mem_get_info(&info);
+    _cmd_basic_reply(cmd);
+    // <flash>, <ramfunc>, <data>, <bss>, <sram4>, <heap>, <heap peak>, <heap arena>, <blocks>, <fails>,
+    // <stack>, <stack peak>, <RAM arena>, <RAM arena peak>
+    OS_PRINTF("%lu, %lu, %lu, %lu, %lu, %lu, %lu, %lu, %lu, %lu, %lu, %lu, %lu, %lu" NL,
+              (unsigned long)info.flash, (unsigned long)info.ramfunc, (unsigned long)info.data,
+              (unsigned long)info.bss, (unsigned long)info.sram4,
+              (unsigned long)info.heap, (unsigned long)info.heap_peak, (unsigned long)info.heap_arena,
+              (unsigned long)info.heap_blocks, (unsigned long)info.heap_fails,
+              (unsigned long)info.stack, (unsigned long)info.stack_peak,
+              (unsigned long)ARENA_SIZE, (unsigned long)arena_peak());
+    // <command>, <runs>, <stack peak>, <heap peak>
+    for (i = 0; (i < CMD_MEM_MAX) && (_CMD_TABLE[i].text != NULL); i++)
+    {
+        m = &_cmd_mem[i];
+        if (m->runs > 0)
+            OS_PRINTF("%s, %lu, %lu, %lu" NL, _CMD_TABLE[i].text, (unsigned long)m->runs,
+                      (unsigned long)m->stack, (unsigned long)m->heap);
+    }
+    return (true);
+}
+
+static bool _cmd_mem_set(const struct _cmd_t *cmd, const char **pptext)
+{
+    bool state;
+
+    if ((! _cmd_fetch_bool(&state, pptext)) || state)
+    {
+        _cmd_error(ERR_INVALID_PARAMETER);
+        return (false);
+    }
+    memset(_cmd_mem, 0, sizeof(_cmd_mem));
+    mem_reset();
+    return (true);
+}
+
+static void _cmd_mem_record(const cmd_t *cmd)
+{
+    u32 i = cmd - _CMD_TABLE;
+    cmd_mem_t *m;
+    mem_peak_t peak;
+
+    if (i >= CMD_MEM_MAX)
+        return;
+    mem_since_mark(&peak);
+    m = &_cmd_mem[i];
+    m->runs++;
+    if (peak.stack > m->stack)
+        m->stack = peak.stack;
+    if (peak.heap > m->heap)
+        m->heap = peak.heap;
+}
+
+static bool _cmd_stats(const cmd_t *cmd)
+{   // human readable: reset cause, counters one per line, commands that ran
+    const u32 *c = stats_counter;
+    int i;
+
+    _cmd_basic_reply(cmd);
+    OS_PRINTF("reset %s, %lu ms since clear" NL, main_reset_name(), (unsigned long)stats_ms());
+    for (i = 0; i < STATS_COUNTERS; i++)
+        OS_PRINTF("%-16s %lu" NL, stats_name(i), (unsigned long)c[i]);
+    OS_PRINTF("%-16s %lu" NL, "TLS_AVG_MS",
+              (c[STATS_TLS_OK] > 0) ? (unsigned long)(c[STATS_TLS_MS] / c[STATS_TLS_OK]) : 0UL);
+    for (i = 0; (i < CMD_MEM_MAX) && (_CMD_TABLE[i].text != NULL); i++)
+    {
+        if (_cmd_runs[i] > 0)
+            OS_PRINTF("CMD %-12s %lu" NL, _CMD_TABLE[i].text, (unsigned long)_cmd_runs[i]);
+    }
+    return (true);
+}
+
+static bool _cmd_stats_set(const struct _cmd_t *cmd, const char **pptext)
+{   // =1 one line for monitoring: RESET=<cause>, MS=<ms since clear>, <counter>=<value>...[, CMD_<command>=<runs>...]
+    bool state;
+    int i;
+
+    if (! _cmd_fetch_bool(&state, pptext))
+    {
+        _cmd_error(ERR_INVALID_PARAMETER);
+        return (false);
+    }
+    if (! state)
+    {
+        stats_reset();
+        memset(_cmd_runs, 0, sizeof(_cmd_runs));
+        return (true);
+    }
+
+    _cmd_basic_reply(cmd);
+    OS_PRINTF("RESET=%s, MS=%lu", main_reset_name(), (unsigned long)stats_ms());
+    for (i = 0; i < STATS_COUNTERS; i++)
+        OS_PRINTF(", %s=%lu", stats_name(i), (unsigned long)stats_counter[i]);
+    for (i = 0; (i < CMD_MEM_MAX) && (_CMD_TABLE[i].text != NULL); i++)
+    {
+        if (_cmd_runs[i] > 0)
+            OS_PRINTF(", CMD_%s=%lu", _CMD_TABLE[i].text, (unsigned long)_cmd_runs[i]);
+    }
+    OS_PRINTF(NL);
+    return (true);
+}
+
 static bool _cmd_id(const cmd_t *cmd)
 {
     _cmd_basic_reply(cmd);
@@ -434,6 +1243,7 @@ static bool _process_cmd(const cmd_t *cmd, const char **pptext)
 void cmd_parse(const char *ptext)
 {
     const cmd_t *cmd;
+    bool ok;
 
     if (*ptext == '#')
         return; // quietly skip remarks
@@ -441,32 +1251,63 @@ void cmd_parse(const char *ptext)
     if ((cmd = _find_cmd(_CMD_TABLE, &ptext)) == NULL)
     {
         _cmd_error(ERR_UNKNOWN_COMMAND);
+        STATS_INC(STATS_CMD_ERRORS);
         return;
     }
     
-    if (! _process_cmd(cmd, &ptext))
+    mem_mark();
+    ok = _process_cmd(cmd, &ptext);
+    _cmd_mem_record(cmd);
+    if ((cmd - _CMD_TABLE) < CMD_MEM_MAX)
+        _cmd_runs[cmd - _CMD_TABLE]++;
+    if (! ok)
     {
+        STATS_INC(STATS_CMD_ERRORS);
         return;
     }
-    if (strnicmp(cmd->text, "TLS", 3) != 0) {
-        OS_PRINTF("OK" NL);
-    }
+    OS_PRINTF("OK" NL);
 }
 
 static const cmd_t _CMD_TABLE[] = {
     {"AUTO",      _cmd_auto,    _cmd_auto_set,  "Automatic response reading get/set"},
+    {"AUTOPOLL",  _cmd_autopoll, _cmd_autopoll_set, "AUTO fallback poll period [ms] get/set"},
+    {"AUTOSTAT",  _cmd_autostat, _cmd_autostat_set, "AUTO GPO latency statistics, =0 clears"},
+    {"BENCH",     _cmd_bench,   _cmd_bench_set, "Crypto micro-benchmark, =<iterations>[,<name>]"},
 #ifdef HW_BUTTON_PRESSED
     {"BUTTON",    _cmd_button,  NULL,           "Get button state"},
 #endif // defined HW_BUTTON_PRESSED
     {"CLKDIV",    _cmd_clkdiv,  _cmd_clkdiv_set,"Clock divisor get/set"},
+    {"CLOCK",     _cmd_clock,   _cmd_clock_set, "System clock profile get/set (48/160 MHz, auto)"},
     {"CS",        _cmd_cs,      _cmd_cs_set,    "SPI chip select direct control"},
     {"GPO",       _cmd_gpo,     NULL,           "Show GPO state"},
     {"HELP",      _cmd_help,    NULL,           "This help text"},
     {"ID",        _cmd_id,      NULL,           "Request product id"},
+    {"L2",        _cmd_l2,      _cmd_l2_set,    "TROPIC01 L2 transaction (CRC, polling, retries on device)"},
+#if L3_ENABLE
+    {"L3",        _cmd_l3,      _cmd_l3_set,    "TROPIC01 L3 command in device owned secure session"},
+    {"L3SESSION", _cmd_l3session, _cmd_l3session_set, "TROPIC01 L3 secure session start with provisioned key slot (-1 aborts)"},
+#endif // L3_ENABLE
+    {"MEM",       _cmd_mem_show, _cmd_mem_set,  "RAM use: sections, heap, stack and peaks per command, =0 clears"},
+    {"MUX",       _cmd_mux,     _cmd_mux_set,   "Binary framed multiplexed mode get/set"},
+#if PROF_ENABLE
+    {"PROF",      _cmd_prof,    _cmd_prof_set,  "Cycle profile of code zones, =0 clears"},
+#endif // PROF_ENABLE
     {"PWR",       _cmd_pwr,     _cmd_pwr_set,   "Get/set target power"},
+#if TEST_ENABLE
+    {"REPLAY",    _cmd_replay,  _cmd_replay_set, "TLS handshake on recorded server flight, =<iterations>[,<bytes/ms>]"},
+#endif // TEST_ENABLE
     {"RESET",     _cmd_reset,   NULL,           "Instant reset"},
+#if TEST_ENABLE
+    {"SEED",      _cmd_seed,    _cmd_seed_set,  "Fixed RNG seed of TLS for recording REPLAY flights, 0 = RNG peripheral"},
+#endif // TEST_ENABLE
 	{"TLS",       _cmd_tls,     _cmd_tls_set,    "TLS 1.3 handshake over USB (ML-KEM-768)"},
+    {"SPIBENCH",  NULL,         _cmd_spibench_set, "SPI throughput, byte mode and packed mode"},
+    {"SPISCRIPT", NULL,         _cmd_spiscript_set, "Batched SPI operations (C,T,W,R,D,P,B) in one reply"},
+    {"SPISTREAM", NULL,         _cmd_spistream_set, "Bulk SPI read/write through CDC data port"},
+    {"SPITRACE",  _cmd_spitrace, _cmd_spitrace_set, "SPI transaction trace dump, =1 starts, =0 stops"},
     {"SN",        _cmd_sn,      NULL,           "Request product serial number"},
+    {"STATS",     _cmd_stats,   _cmd_stats_set, "Runtime counters, =1 one line for monitoring, =0 clears"},
+    {"USBBENCH",  _cmd_usbbench, _cmd_usbbench_set, "USB data port benchmark (source/sink/echo)"},
     {"VER",       _cmd_ver,     NULL,           "Request version information"},
 
     {NULL, NULL, 0, NULL} // command list termination
@@ -0,0 +1,189 @@
+#include "l2.h"
+#include "hardware.h"
+#include "crc16.h"
+#include "spi.h"
+#include "time.h"
+#include "wd.h"
+
+// TROPIC01 L2 request/response on the device: one host round trip per
+// L2 transaction instead of request + GET_RESP polls over USB
+
+#define L2_POLL_US          (50)  // GET_RESP period when GPO is not signaling
+
+l2_stats_t l2_stats;
+
+static u8 _tx[L2_FRAME_MAX] SRAM4_BSS;
+static u8 _rx[1 + L2_FRAME_MAX] SRAM4_BSS; // chip status byte first
+
+static bool _l2_spi(u8 *rx, u8 *tx, u32 len)
+{   // blocking transfer, traced as L2 engine
+    u8 source = spi1_trace_source(SPI_SOURCE_L2);
+    bool ok;
+
+    ok = spi1_data_transfer(rx, tx, len);
+    spi1_trace_source(source);
+    return (ok);
+}
+
+static bool _l2_wait(os_timer_t deadline)
+{   // until GPO signals response ready or poll period elapsed, false on timeout
+    os_timer_t now = timer_get_time();
+    os_timer_t poll = now + L2_POLL_US*TIMER_US;
+
+    while ((now < poll) && (! HW_GPO_IN))
+    {
+        now = timer_get_time();
+    }
+    wd_feed();
+    return ((now < deadline) ? true : false);
+}
+
+static l2_result_e _l2_send(const u8 *frame, u32 len, os_timer_t deadline)
+{   // whole frame is one DMA transfer, repeated until chip is ready
+    bool ok;
+
+    while (1)
+    {
+        memcpy(_tx, frame, len);
+        spi1_cs(true);
+        ok = _l2_spi(_rx, _tx, len);
+        spi1_cs(false);
+
+        if (! ok)
+            return (L2_ERR_SPI);
+        if (_rx[0] & L2_CHIP_READY)
+            return (L2_OK);
+        if (! _l2_wait(deadline))
+            return (L2_ERR_TIMEOUT);
+    }
+}
+
+static l2_result_e _l2_read(u8 *resp, os_timer_t deadline)
+{   // GET_RESP until there is a response: _rx [0] chip status, [1] status, [2] len
+    u32 len;
+
+    while (1)
+    {
+        spi1_cs(true);
+        _tx[0] = L2_REQ_GET_RESP;
+        _tx[1] = 0;
+        _tx[2] = 0;
+        if (! _l2_spi(_rx, _tx, 3))
+        {
+            spi1_cs(false);
+            return (L2_ERR_SPI);
+        }
+
+        if ((_rx[0] & L2_CHIP_READY) && (_rx[1] != L2_STATUS_NO_RESP))
+            break;
+
+        spi1_cs(false);
+        l2_stats.polls++;
+        if (! _l2_wait(deadline))
+            return (L2_ERR_TIMEOUT);
+    }
+
+    // data and CRC in one burst
+    len = _rx[2] + 2;
+    memset(_tx, 0, len);
+    if (! _l2_spi(&_rx[3], _tx, len))
+    {
+        spi1_cs(false);
+        return (L2_ERR_SPI);
+    }
+    spi1_cs(false);
+
+    memcpy(resp, &_rx[1], 2 + len);
+    return (L2_OK);
+}
+
+static bool _l2_crc_ok(const u8 *frame)
+{
+    u32 len = 2 + frame[1];
+    u16 crc = frame[len] | (frame[len + 1] << 8);
+
+    return ((crc16(frame, len) == crc) ? true : false);
+}
+
+static void _l2_crc_add(u8 *frame)
+{
+    u32 len = 2 + frame[1];
+    u16 crc = crc16(frame, len);
+
+    frame[len] = crc & 0xFF;
+    frame[len + 1] = crc >> 8;
+}
+
+l2_result_e l2_response(u8 *resp, u32 timeout_ms)
+{
+    static u8 resend[4] = {L2_REQ_RESEND, 0};
+    os_timer_t deadline = timer_get_time() + timeout_ms*TIMER_MS;
+    l2_result_e result;
+    int retry;
+
+    for (retry = 0; ; retry++)
+    {
+        if ((result = _l2_read(resp, deadline)) != L2_OK)
+        {
+            if (result == L2_ERR_TIMEOUT)
+                l2_stats.timeouts++;
+            return (result);
+        }
+        if (_l2_crc_ok(resp))
+            return (L2_OK);
+
+        if (retry >= L2_RETRIES)
+            return (L2_ERR_CRC);
+
+        // response damaged on the way, ask for it again
+        l2_stats.crc_retries++;
+        _l2_crc_add(resend);
+        if ((result = _l2_send(resend, sizeof(resend), deadline)) != L2_OK)
+            return (result);
+    }
+}
+
+l2_result_e l2_transfer(const u8 *req, u8 *resp, u32 timeout_ms)
+{
+    static u8 frame[L2_FRAME_MAX];
+    os_timer_t deadline = timer_get_time() + timeout_ms*TIMER_MS;
+    l2_result_e result;
+    u32 len = 2 + req[1] + 2;
+    int retry;
+
+    memcpy(frame, req, 2 + req[1]);
+    _l2_crc_add(frame);
+    l2_stats.requests++;
+
+    for (retry = 0; ; retry++)
+    {
+        if ((result = _l2_send(frame, len, deadline)) != L2_OK)
+        {
+            if (result == L2_ERR_TIMEOUT)
+                l2_stats.timeouts++;
+            return (result);
+        }
+
+        result = l2_response(resp, timeout_ms);
+        if ((result != L2_OK) || (resp[0] != L2_STATUS_CRC_ERR) || (retry >= L2_RETRIES))
+            return (result);
+
+        // request damaged on the way, send it again
+        l2_stats.crc_retries++;
+    }
+}
+
+const char *l2_result_text(l2_result_e result)
+{
+    switch (result)
+    {
+    case L2_OK:          return ("OK");
+    case L2_ERR_PARAM:   return ("invalid L2 frame");
+    case L2_ERR_TIMEOUT: return ("L2 timeout");
+    case L2_ERR_CRC:     return ("L2 response CRC");
+    case L2_ERR_SPI:     return ("SPI transfer failed");
+    default:
+        break;
+    }
+    return ("L2 error");
+}
@@ -0,0 +1,55 @@
+#ifndef L2_H
+#define L2_H
+
+#include "common.h"
+
+// TROPIC01 L2 frame: ID/STATUS, LEN, DATA[LEN], CRC16 (LSB first)
+#define L2_DATA_MAX         (255)
+#define L2_FRAME_MAX        (2 + L2_DATA_MAX + 2)
+
+#define L2_REQ_GET_RESP     (0xAA) // read response
+#define L2_REQ_RESEND       (0x10) // chip sends last response again
+#define L2_REQ_HANDSHAKE    (0x02) // L3 secure session start
+#define L2_REQ_ENC_CMD      (0x04) // chunk of encrypted L3 command
+#define L2_REQ_SESSION_ABT  (0x08) // L3 secure session abort
+
+#define L2_CHIP_READY       (0x01) // chip status bit, first MISO byte
+
+#define L2_STATUS_REQ_OK    (0x01)
+#define L2_STATUS_RES_OK    (0x02)
+#define L2_STATUS_REQ_CONT  (0x03)
+#define L2_STATUS_RES_CONT  (0x04) // more response frames follow
+#define L2_STATUS_CRC_ERR   (0x7D) // chip received request with wrong CRC
+#define L2_STATUS_UNKNOWN   (0x7E) // unknown request ID
+#define L2_STATUS_NO_RESP   (0xFF)
+
+#define L2_CHUNK_MAX        (252)  // data of one L2_REQ_ENC_CMD chunk
+
+#define L2_TIMEOUT_MS       (2000) // default response timeout
+#define L2_RETRIES          (3)    // resend on CRC error in either direction
+
+typedef enum {
+    L2_OK = 0,
+    L2_ERR_PARAM,
+    L2_ERR_TIMEOUT, // chip not ready or no response
+    L2_ERR_CRC,     // response CRC still wrong after retries
+    L2_ERR_SPI,     // transfer rejected by SPI driver or DMA failed
+} l2_result_e;
+
+typedef struct {
+    u32 requests;
+    u32 polls;       // GET_RESP reads without response yet
+    u32 crc_retries; // resend in either direction
+    u32 timeouts;
+} l2_stats_t;
+
+extern l2_stats_t l2_stats;
+
+// req: ID, LEN, DATA (CRC is added), resp: STATUS, LEN, DATA, CRC
+l2_result_e l2_transfer(const u8 *req, u8 *resp, u32 timeout_ms);
+// next response frame, e.g. after L2_STATUS_RES_CONT
+l2_result_e l2_response(u8 *resp, u32 timeout_ms);
+
+const char *l2_result_text(l2_result_e result);
+
+#endif // ! L2_H
@@ -0,0 +1,404 @@
+#include "l3.h"
+#include "l2.h"
+#include <wolfssl/wolfcrypt/settings.h>
+#include <wolfssl/wolfcrypt/aes.h>
+#include <wolfssl/wolfcrypt/curve25519.h>
+#include <wolfssl/wolfcrypt/error-crypt.h>
+#include <wolfssl/wolfcrypt/hmac.h>
+#include <wolfssl/wolfcrypt/random.h>
+#include <wolfssl/wolfcrypt/sha256.h>
+
+// TROPIC01 L3 secure session on the device, host sends plaintext L3
+// commands and gets plaintext results, encrypted packets stay on SPI.
+//
+// Handshake (Noise KK1, same as libtropic):
+//   h  = SHA256(protocol), then h = SHA256(h || x) for
+//        SHPUB, STPUB, EHPUB, PKEY_INDEX, ETPUB
+//   ck = protocol
+//   ck        = HKDF(ck, X25519(EHPRIV, ETPUB))
+//   ck        = HKDF(ck, X25519(SHPRIV, ETPUB))
+//   ck, KAUTH = HKDF(ck, X25519(EHPRIV, STPUB))
+//   KCMD, KRES = HKDF(ck, "")
+//   chip proves the keys with AES-GCM tag (KAUTH, IV 0, AAD h, no data)
+// Commands are encrypted with KCMD, results with KRES, both with the same
+// IV: 32 bit counter (LSB first) incremented after every result.
+
+#define _MIN(a, b)            (((a) < (b)) ? (a) : (b))
+
+typedef struct {
+    bool active;
+    u32 nonce;
+    u8 kcmd[L3_KEY_SIZE];
+    u8 kres[L3_KEY_SIZE];
+} l3_session_t;
+
+static const u8 _PROTOCOL_NAME[32] = "Noise_KK1_25519_AESGCM_SHA256\0\0\0";
+
+l3_stats_t l3_stats;
+u8 l3_l2_status;
+u8 l3_l2_result;
+
+static l3_session_t _session;
+static WC_RNG _rng;
+static bool _rng_ready;
+static Aes _aes;
+static u8 _packet[L3_PACKET_MAX];
+static u8 _req[L2_FRAME_MAX];
+static u8 _resp[L2_FRAME_MAX];
+
+static void _l3_clear(void)
+{
+    memset(&_session, 0, sizeof(_session));
+}
+
+static l3_result_e _l3_status(l2_result_e result, u8 status1, u8 status2)
+{   // L2 transaction done and chip answered with one of expected statuses
+    if (result != L2_OK)
+    {
+        l3_l2_result = result;
+        return (L3_ERR_L2);
+    }
+    if ((_resp[0] != status1) && (_resp[0] != status2))
+    {
+        l3_l2_status = _resp[0];
+        return (L3_ERR_STATUS);
+    }
+    return (L3_OK);
+}
+
+static void _l3_iv(u8 *iv, u32 nonce)
+{
+    memset(iv, 0, L3_IV_SIZE);
+    iv[0] = nonce & 0xFF;
+    iv[1] = (nonce >> 8) & 0xFF;
+    iv[2] = (nonce >> 16) & 0xFF;
+    iv[3] = nonce >> 24;
+}
+
+static int _l3_hash(u8 *h, const u8 *data, u32 len)
+{   // h = SHA256(h || data)
+    wc_Sha256 sha;
+    int ret;
+
+    ret = wc_InitSha256(&sha);
+    if (ret == 0)
+        ret = wc_Sha256Update(&sha, h, WC_SHA256_DIGEST_SIZE);
+    if (ret == 0)
+        ret = wc_Sha256Update(&sha, data, len);
+    if (ret == 0)
+        ret = wc_Sha256Final(&sha, h);
+    wc_Sha256Free(&sha);
+    return (ret);
+}
+
+static int _l3_hkdf(const u8 *ck, const u8 *input, u32 len, u8 *out1, u8 *out2)
+{   // out1, out2 = HKDF(salt ck, input), out1 may be ck, out2 optional
+    u8 okm[2*L3_KEY_SIZE];
+    int ret;
+
+    ret = wc_HKDF(WC_SHA256, input, len, ck, L3_KEY_SIZE, NULL, 0, okm, sizeof(okm));
+    if (ret == 0)
+    {
+        memcpy(out1, okm, L3_KEY_SIZE);
+        if (out2 != NULL)
+            memcpy(out2, &okm[L3_KEY_SIZE], L3_KEY_SIZE);
+    }
+    memset(okm, 0, sizeof(okm));
+    return (ret);
+}
+
+static int _l3_x25519(curve25519_key *priv, const u8 *pub, u8 *secret)
+{
+    curve25519_key peer;
+    word32 len = L3_KEY_SIZE;
+    int ret;
+
+    ret = wc_curve25519_init(&peer);
+    if (ret != 0)
+        return (ret);
+    ret = wc_curve25519_import_public_ex(pub, L3_KEY_SIZE, &peer, EC25519_LITTLE_ENDIAN);
+    if (ret == 0)
+        ret = wc_curve25519_shared_secret_ex(priv, &peer, secret, &len, EC25519_LITTLE_ENDIAN);
+    wc_curve25519_free(&peer);
+    return (ret);
+}
+
+static int _l3_gcm(bool encrypt, const u8 *key, u32 nonce, const u8 *aad, u32 aad_len,
+                   const u8 *in, u8 *out, u32 len, u8 *tag)
+{
+    u8 iv[L3_IV_SIZE];
+    int ret;
+
+    _l3_iv(iv, nonce);
+    ret = wc_AesInit(&_aes, NULL, INVALID_DEVID);
+    if (ret != 0)
+        return (ret);
+    ret = wc_AesGcmSetKey(&_aes, key, L3_KEY_SIZE);
+    if (ret == 0)
+    {
+        if (encrypt)
+            ret = wc_AesGcmEncrypt(&_aes, out, in, len, iv, L3_IV_SIZE, tag, L3_TAG_SIZE, aad, aad_len);
+        else
+            ret = wc_AesGcmDecrypt(&_aes, out, in, len, iv, L3_IV_SIZE, tag, L3_TAG_SIZE, aad, aad_len);
+    }
+    wc_AesFree(&_aes);
+    return (ret);
+}
+
+static int _l3_key_init(curve25519_key *key)
+{
+    int ret;
+
+    ret = wc_curve25519_init(key);
+#ifdef WOLFSSL_CURVE25519_BLINDING
+    if (ret == 0)
+        ret = wc_curve25519_set_rng(key, &_rng);
+#endif
+    return (ret);
+}
+
+l3_result_e l3_session_start(u8 pkey_index, const u8 *sh_priv, const u8 *st_pub, u32 timeout_ms)
+{
+    os_timer_t start = timer_get_time();
+    curve25519_key eh, sh;
+    u8 eh_pub[L3_KEY_SIZE], sh_pub[L3_KEY_SIZE], priv[L3_KEY_SIZE];
+    u8 h[WC_SHA256_DIGEST_SIZE], ck[L3_KEY_SIZE], kauth[L3_KEY_SIZE], secret[L3_KEY_SIZE];
+    const u8 *et_pub, *tauth;
+    l3_result_e result = L3_ERR_CRYPTO;
+    word32 len = L3_KEY_SIZE;
+    int ret;
+
+    _l3_clear();
+    if (pkey_index > L3_PKEY_INDEX_MAX)
+        return (L3_ERR_PARAM);
+
+    if (! _rng_ready)
+    {
+        if (wc_InitRng(&_rng) != 0)
+            return (L3_ERR_CRYPTO);
+        _rng_ready = true;
+    }
+    if (_l3_key_init(&eh) != 0)
+        return (L3_ERR_CRYPTO);
+    if (_l3_key_init(&sh) != 0)
+    {
+        wc_curve25519_free(&eh);
+        return (L3_ERR_CRYPTO);
+    }
+
+    // pairing key as X25519 scalar, public part derived from it
+    memcpy(priv, sh_priv, L3_KEY_SIZE);
+    priv[0] &= 248;
+    priv[31] &= 127;
+    priv[31] |= 64;
+    ret = wc_curve25519_import_private_ex(priv, L3_KEY_SIZE, &sh, EC25519_LITTLE_ENDIAN);
+    if (ret == 0)
+        ret = wc_curve25519_make_pub(L3_KEY_SIZE, sh_pub, L3_KEY_SIZE, priv);
+    if (ret == 0)
+        ret = wc_curve25519_make_key(&_rng, L3_KEY_SIZE, &eh);
+    if (ret == 0)
+        ret = wc_curve25519_export_public_ex(&eh, eh_pub, &len, EC25519_LITTLE_ENDIAN);
+    if (ret != 0)
+        goto cleanup;
+
+    // Handshake_Req: EHPUB, PKEY_INDEX; response: ETPUB, TAUTH
+    _req[0] = L2_REQ_HANDSHAKE;
+    _req[1] = L3_KEY_SIZE + 1;
+    memcpy(&_req[2], eh_pub, L3_KEY_SIZE);
+    _req[2 + L3_KEY_SIZE] = pkey_index;
+    result = _l3_status(l2_transfer(_req, _resp, timeout_ms), L2_STATUS_REQ_OK, L2_STATUS_REQ_OK);
+    if (result != L3_OK)
+        goto cleanup;
+    if (_resp[1] != L3_KEY_SIZE + L3_TAG_SIZE)
+    {
+        l3_l2_status = _resp[0];
+        result = L3_ERR_STATUS;
+        goto cleanup;
+    }
+    et_pub = &_resp[2];
+    tauth = &_resp[2 + L3_KEY_SIZE];
+
+    result = L3_ERR_CRYPTO;
+    ret = wc_Sha256Hash(_PROTOCOL_NAME, sizeof(_PROTOCOL_NAME), h);
+    if (ret == 0)
+        ret = _l3_hash(h, sh_pub, L3_KEY_SIZE);
+    if (ret == 0)
+        ret = _l3_hash(h, st_pub, L3_KEY_SIZE);
+    if (ret == 0)
+        ret = _l3_hash(h, eh_pub, L3_KEY_SIZE);
+    if (ret == 0)
+        ret = _l3_hash(h, &pkey_index, 1);
+    if (ret == 0)
+        ret = _l3_hash(h, et_pub, L3_KEY_SIZE);
+
+    memcpy(ck, _PROTOCOL_NAME, L3_KEY_SIZE);
+    if (ret == 0)
+        ret = _l3_x25519(&eh, et_pub, secret);
+    if (ret == 0)
+        ret = _l3_hkdf(ck, secret, L3_KEY_SIZE, ck, NULL);
+    if (ret == 0)
+        ret = _l3_x25519(&sh, et_pub, secret);
+    if (ret == 0)
+        ret = _l3_hkdf(ck, secret, L3_KEY_SIZE, ck, NULL);
+    if (ret == 0)
+        ret = _l3_x25519(&eh, st_pub, secret);
+    if (ret == 0)
+        ret = _l3_hkdf(ck, secret, L3_KEY_SIZE, ck, kauth);
+    if (ret == 0)
+        ret = _l3_hkdf(ck, secret, 0, _session.kcmd, _session.kres);
+    if (ret != 0)
+        goto cleanup;
+
+    ret = _l3_gcm(false, kauth, 0, h, sizeof(h), NULL, NULL, 0, (u8 *)tauth);
+    if (ret == AES_GCM_AUTH_E)
+    {
+        l3_stats.auth_errors++;
+        result = L3_ERR_AUTH;
+    }
+    else if (ret == 0)
+    {
+        _session.active = true;
+        _session.nonce = 0;
+        l3_stats.sessions++;
+        l3_stats.last_handshake_us = (u32)(timer_get_time() - start);
+        result = L3_OK;
+    }
+
+cleanup:
+    if (result != L3_OK)
+        _l3_clear();
+    memset(priv, 0, sizeof(priv));
+    memset(ck, 0, sizeof(ck));
+    memset(kauth, 0, sizeof(kauth));
+    memset(secret, 0, sizeof(secret));
+    wc_curve25519_free(&eh);
+    wc_curve25519_free(&sh);
+    return (result);
+}
+
+void l3_session_abort(u32 timeout_ms)
+{
+    if (_session.active)
+    {
+        _req[0] = L2_REQ_SESSION_ABT;
+        _req[1] = 0;
+        l2_transfer(_req, _resp, timeout_ms);
+    }
+    _l3_clear();
+}
+
+bool l3_session_active(void)
+{
+    return (_session.active);
+}
+
+static l3_result_e _l3_send(u32 len, u32 timeout_ms)
+{   // _packet in chunks, chip answers REQ_CONT to all of them but the last
+    l3_result_e result;
+    u32 pos, chunk;
+
+    for (pos = 0; pos < len; pos += chunk)
+    {
+        chunk = _MIN(len - pos, L2_CHUNK_MAX);
+        _req[0] = L2_REQ_ENC_CMD;
+        _req[1] = chunk;
+        memcpy(&_req[2], &_packet[pos], chunk);
+        result = _l3_status(l2_transfer(_req, _resp, timeout_ms),
+                            (pos + chunk < len) ? L2_STATUS_REQ_CONT : L2_STATUS_REQ_OK,
+                            L2_STATUS_REQ_OK);
+        if (result != L3_OK)
+            return (result);
+    }
+    return (L3_OK);
+}
+
+static l3_result_e _l3_receive(u32 *len, u32 timeout_ms)
+{   // result packet to _packet, RES_CONT frames until RES_OK
+    l3_result_e result;
+
+    *len = 0;
+    while (1)
+    {
+        result = _l3_status(l2_response(_resp, timeout_ms), L2_STATUS_RES_CONT, L2_STATUS_RES_OK);
+        if (result != L3_OK)
+            return (result);
+        if (*len + _resp[1] > sizeof(_packet))
+        {
+            l3_l2_status = _resp[0];
+            return (L3_ERR_STATUS);
+        }
+        memcpy(&_packet[*len], &_resp[2], _resp[1]);
+        *len += _resp[1];
+        if (_resp[0] == L2_STATUS_RES_OK)
+            return (L3_OK);
+    }
+}
+
+l3_result_e l3_command(const u8 *cmd, u32 cmd_len, u8 *res, u32 *res_len, u32 timeout_ms)
+{
+    os_timer_t start = timer_get_time();
+    l3_result_e result;
+    u32 len, size;
+    int ret;
+
+    if (! _session.active)
+        return (L3_ERR_NO_SESSION);
+    if ((cmd_len == 0) || (cmd_len > L3_DATA_MAX))
+        return (L3_ERR_PARAM);
+
+    _packet[0] = cmd_len & 0xFF;
+    _packet[1] = cmd_len >> 8;
+    ret = _l3_gcm(true, _session.kcmd, _session.nonce, NULL, 0,
+                  cmd, &_packet[2], cmd_len, &_packet[2 + cmd_len]);
+    if (ret != 0)
+        return (L3_ERR_CRYPTO);
+
+    result = _l3_send(2 + cmd_len + L3_TAG_SIZE, timeout_ms);
+    if (result == L3_OK)
+        result = _l3_receive(&len, timeout_ms);
+    if (result != L3_OK)
+    {   // chip and device IV may differ now, new handshake is needed
+        _l3_clear();
+        return (result);
+    }
+
+    size = _packet[0] | (_packet[1] << 8);
+    if ((len != 2 + size + L3_TAG_SIZE) || (size > *res_len))
+    {
+        _l3_clear();
+        return (L3_ERR_PARAM);
+    }
+
+    ret = _l3_gcm(false, _session.kres, _session.nonce, NULL, 0,
+                  &_packet[2], res, size, &_packet[2 + size]);
+    if (ret != 0)
+    {
+        if (ret == AES_GCM_AUTH_E)
+            l3_stats.auth_errors++;
+        _l3_clear();
+        return ((ret == AES_GCM_AUTH_E) ? L3_ERR_AUTH : L3_ERR_CRYPTO);
+    }
+
+    _session.nonce++;
+    *res_len = size;
+    l3_stats.commands++;
+    l3_stats.last_command_us = (u32)(timer_get_time() - start);
+    return (L3_OK);
+}
+
+const char *l3_result_text(l3_result_e result)
+{
+    switch (result)
+    {
+    case L3_OK:             return ("OK");
+    case L3_ERR_PARAM:      return ("invalid L3 packet");
+    case L3_ERR_NO_SESSION: return ("no L3 session");
+    case L3_ERR_L2:         return (l2_result_text((l2_result_e)l3_l2_result));
+    case L3_ERR_STATUS:     return ("unexpected L2 status");
+    case L3_ERR_AUTH:       return ("L3 authentication failed");
+    case L3_ERR_CRYPTO:     return ("L3 crypto error");
+    default:
+        break;
+    }
+    return ("L3 error");
+}
@@ -0,0 +1,60 @@
+#ifndef L3_H
+#define L3_H
+
+#include "common.h"
+
+// TROPIC01 L3 secure session owned by the device: handshake (Noise KK1,
+// X25519, SHA256, AES-GCM), command encryption and chunking over L2.
+// L3 packet: SIZE (2, LSB first), CIPHERTEXT[SIZE], TAG (16)
+
+// make L3=1 builds the L3/L3SESSION commands. The console is not
+// authenticated, any process with the CDC port would use the pairing keys
+// of the device, so they stay out of release images until L3 commands are
+// bound to an authenticated channel.
+#ifndef L3_ENABLE
+  #define L3_ENABLE 0
+#endif
+
+#define L3_KEY_SIZE         (32)
+#define L3_TAG_SIZE         (16)
+#define L3_IV_SIZE          (12)
+#define L3_DATA_MAX         (1024) // plaintext command or result
+#define L3_PACKET_MAX       (2 + L3_DATA_MAX + L3_TAG_SIZE)
+#define L3_PKEY_INDEX_MAX   (3)    // pairing key slots SH0 .. SH3
+
+#define L3_RESULT_OK        (0xC3) // first byte of decrypted result
+
+typedef enum {
+    L3_OK = 0,
+    L3_ERR_PARAM,
+    L3_ERR_NO_SESSION,
+    L3_ERR_L2,       // L2 timeout or CRC, see l3_l2_result
+    L3_ERR_STATUS,   // unexpected L2 status, see l3_l2_status
+    L3_ERR_AUTH,     // handshake tag or result tag does not match
+    L3_ERR_CRYPTO,
+} l3_result_e;
+
+typedef struct {
+    u32 sessions;
+    u32 commands;
+    u32 auth_errors;
+    u32 last_handshake_us;
+    u32 last_command_us;
+} l3_stats_t;
+
+extern l3_stats_t l3_stats;
+extern u8 l3_l2_status;  // L2 status of the failed frame with L3_ERR_STATUS
+extern u8 l3_l2_result;  // l2_result_e with L3_ERR_L2
+
+// sh_priv: host pairing private key (X25519), st_pub: chip X25519 public key
+l3_result_e l3_session_start(u8 pkey_index, const u8 *sh_priv, const u8 *st_pub, u32 timeout_ms);
+// aborts on the chip as well, keys are cleared either way
+void l3_session_abort(u32 timeout_ms);
+bool l3_session_active(void);
+
+// cmd: CMD_ID, DATA; res: RESULT, DATA; res_len in: size of res, out: length
+l3_result_e l3_command(const u8 *cmd, u32 cmd_len, u8 *res, u32 *res_len, u32 timeout_ms);
+
+const char *l3_result_text(l3_result_e result);
+
+#endif // ! L3_H
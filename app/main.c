@@ -12,9 +12,17 @@
 #include "spi.h"
 #include "cmd.h"
 #include "log.h"
+#include "event.h"
+#include "irq.h"
+#include "tls_pqc.h"
+#include "mem.h"
+#include "prof.h"
+#include "util.h"
+#include "stats.h"
 #include "stm32u5xx_hal.h"
 #include "stm32u5xx_hal_rng.h"
 #include "stm32u5xx_ll_rcc.h"
+#include "stm32u5xx_ll_exti.h"
 /* Include wolfssl/options.h FIRST before any other wolfSSL headers */
 #include <wolfssl/options.h>
 #include <wolfssl/wolfcrypt/types.h>
@@ -25,6 +33,15 @@ LOG_DEF("main");
 bool main_spi_auto = false;
 u8 main_spi_get_resp = 0;
 u8 main_spi_no_resp = 0;
+u32 main_spi_poll_ms = 100; // AUTO fallback poll period, GPO edge reads at once
+main_auto_stats_t main_auto_stats;
+u8 main_clock_mode = MAIN_CLOCK_BASE;
+#if TEST_ENABLE
+u32 main_seed = 0;
+#endif
+
+static volatile os_timer_t _gpo_edge_time = 0;
+static os_timer_t _spi_poll_time = 0;
 
 /* RNG handle for hardware random number generator */
 RNG_HandleTypeDef hrng;
@@ -32,6 +49,18 @@ RNG_HandleTypeDef hrng;
 static bool _spi_cs_active = false;
 #define _SPI_BUF_SIZE (512)
 
+// SPI channel of framed (MUX) mode: first payload byte are flags, then MOSI data
+#define _SPI_FRAME_KEEP_CS  (0x01) // leave CS active after transfer
+static u8 _spi_frame_tx[TTY_FRAME_MAX] SRAM4_BSS;
+static u8 _spi_frame_rx[TTY_FRAME_MAX] SRAM4_BSS;
+static spi_job_t _spi_frame_job;
+
+// raw HEX line pass-through and AUTO response reads: whole line (or response)
+// is one DMA transfer, reply is one USB write
+static u8 _spi_line_tx[_SPI_BUF_SIZE] SRAM4_BSS;
+static u8 _spi_line_rx[_SPI_BUF_SIZE] SRAM4_BSS;
+static char _spi_line_hex[2*_SPI_BUF_SIZE + sizeof(NL)];
+
 #define MAIN_LED_INIT  HW_LED1_INIT
 #define MAIN_LED_ON    HW_LED1_ON
 #define MAIN_LED_OFF   HW_LED1_OFF
@@ -64,6 +93,42 @@ static void main_gpio_init(void)
     HW_CHIP_PWR_ON;
 }
 
+void HW_GPO_EXTI_IRQHandler(void)
+{   // target signals response ready
+    if (LL_EXTI_IsActiveRisingFlag_0_31(HW_GPO_EXTI_LINE))
+    {
+        LL_EXTI_ClearRisingFlag_0_31(HW_GPO_EXTI_LINE);
+        _gpo_edge_time = timer_get_time();
+        event_set(EVENT_GPO);
+    }
+}
+
+static void _gpo_irq_init(void)
+{
+    LL_EXTI_SetEXTISource(HW_GPO_EXTI_PORT, HW_GPO_EXTI_SOURCE);
+    LL_EXTI_EnableRisingTrig_0_31(HW_GPO_EXTI_LINE);
+    LL_EXTI_EnableIT_0_31(HW_GPO_EXTI_LINE);
+    irq_enable(HW_GPO_EXTI_IRQn, GPO_ISR_PRIO);
+}
+
+const char *main_reset_name(void)
+{
+    switch (reset_type)
+    {
+    case RESET_POWER_ON: return ("POWER_ON");
+    case RESET_USER_RQ:  return ("USER_RQ");
+    case RESET_WDT:      return ("WDT");
+    case RESET_BOD:      return ("BOD");
+    default:             return ("UNKNOWN");
+    }
+}
+
+void main_auto_stats_reset(void)
+{
+    memset(&main_auto_stats, 0, sizeof(main_auto_stats));
+    main_auto_stats.min_us = (u32)-1;
+}
+
 void Error_Handler(void)
 {   // Referenced from STM32 HAL library
     // User can add his own implementation to report the HAL error return state
@@ -118,6 +183,25 @@ static void MX_RNG_WarmUp(void)
 	}
 }
 
+#if TEST_ENABLE
+static u32 _seed_state;
+
+void main_seed_set(u32 seed)
+{   // stream starts here and again at each handshake (TLS, REPLAY), so all
+    // handshakes after this get the same seeds
+    main_seed = seed;
+    _seed_state = seed;
+}
+
+static u8 _seed_next(void)
+{   // xorshift32, only has to repeat, the DRBG does the rest
+    _seed_state ^= _seed_state << 13;
+    _seed_state ^= _seed_state >> 17;
+    _seed_state ^= _seed_state << 5;
+    return ((u8)_seed_state);
+}
+#endif // TEST_ENABLE
+
 /* Custom wc_GenerateSeed implementation that uses the global RNG handle
  * This avoids conflicts from wolfSSL trying to init its own RNG handle
  */
@@ -131,6 +215,16 @@ int custom_wc_GenerateSeed(OS_Seed* os, byte* output, word32 sz)
 		return -1; /* BAD_FUNC_ARG equivalent */
 	}
 	
+#if TEST_ENABLE
+	/* Test hook (SEED, REPLAY): fixed seed makes handshakes reproducible */
+	if (main_seed != 0) {
+		for (i = 0; i < sz; i++) {
+			output[i] = _seed_next();
+		}
+		return 0;
+	}
+#endif
+	
 	/* Use the global RNG handle that's already initialized */
 	while (i < sz) {
 		/* If not aligned or there is odd/remainder */
@@ -158,6 +252,44 @@ int custom_wc_GenerateSeed(OS_Seed* os, byte* output, word32 sz)
 }
 
 
+static void _main_hclk(u32 hclk)
+{   // SYSCLK profile switch, timers and SPI follow; USB, RNG and LPUART
+    // have own clocks
+    if (hclk == sys_get_hclk())
+        return;
+    while (spi1_busy())
+        wd_feed(); // no job and no delay on TIM3 while prescalers change
+
+    sys_set_hclk(hclk);
+    timer_clock_update(hclk);
+    spi1_clock_update();
+}
+
+bool main_clock_set(u8 mode)
+{
+    if (mode >= MAIN_CLOCK_MODES)
+        return (false);
+
+    main_clock_mode = mode;
+    GPREG_WRITE(GPREG_CLOCK, GPREG_CLOCK_VALID | mode);
+    _main_hclk((mode == MAIN_CLOCK_PERF) ? SYS_HCLK_PERF : SYS_HCLK_BASE);
+    return (true);
+}
+
+void main_clock_boost(bool boost)
+{
+    if (main_clock_mode == MAIN_CLOCK_AUTO)
+        _main_hclk(boost ? SYS_HCLK_PERF : SYS_HCLK_BASE);
+}
+
+static void _main_clock_init(void)
+{   // after timers and SPI are running
+    u32 reg = GPREG_CLOCK;
+
+    if (((reg & GPREG_CLOCK_MASK) != GPREG_CLOCK_VALID) || (! main_clock_set(reg & 0xFF)))
+        main_clock_set(HW_CLOCK_PROFILE);
+}
+
 static void _led1_on (void)
 {
     MAIN_LED_ON;
@@ -180,42 +312,145 @@ static void _spi_cs_disable(void)
     _spi_cs_active = false;
 }
 
-static void _spi_auto_task(void)
-{   // automatic response reading task
-    char spi_buf[_SPI_BUF_SIZE];
-    int i, l;
+static bool _spi_auto_task(void)
+{   // automatic response reading task, true when a response was read
+    // _spi_line_rx: [0] chip status, [1] header, [2] length, [3..] payload and CRC
+    u8 *resp = &_spi_line_rx[1];
+    u8 source;
+    bool ok;
+    int len;
 
     spi1_flush();
+    source = spi1_trace_source(SPI_SOURCE_AUTO);
 
     _spi_cs_enable();
 
-    spi_buf[0] = spi1_transfer(main_spi_get_resp);
+    // request byte, header and length in one short transfer
+    _spi_line_tx[0] = main_spi_get_resp;
+    _spi_line_tx[1] = 0;
+    _spi_line_tx[2] = 0;
     // TODO: we can check busy bit here
-    spi_buf[0] = spi1_transfer(0); // header
 
-    if (spi_buf[0] == main_spi_no_resp)
-    {   // no response to read
+    if ((! spi1_data_transfer(_spi_line_rx, _spi_line_tx, 3)) || (resp[0] == main_spi_no_resp))
+    {   // no response to read (or transfer not done)
         _spi_cs_disable();
+        spi1_trace_source(source);
         // TODO: automatic read TS_L2_GET_LOG_REQ ?
-        return;
+        STATS_INC(STATS_AUTO_EMPTY);
+        return (false);
     }
 
-    l = spi1_transfer(0);
-    spi_buf[1] = l; // data length
+    // payload and CRC in one burst
+    len = resp[1] + 2;
+    memset(_spi_line_tx, 0, len);
+    ok = spi1_data_transfer(&_spi_line_rx[3], _spi_line_tx, len);
 
-    for (i=2; i<(2+l+2); i++)
-    {
-        spi_buf[i] = spi1_transfer(0);
-    }
-    
     _spi_cs_disable();
+    spi1_trace_source(source);
+    if (! ok)
+        return (false);
+
+    STATS_INC(STATS_AUTO_READS);
+
+    // print result: header, length, payload, CRC as one line
+    len = bin_to_hex(_spi_line_hex, resp, 2 + len);
+    memcpy(&_spi_line_hex[len], NL, sizeof(NL));
+    OS_PUTTEXT(_spi_line_hex);
+    return (true);
+}
+
+static void _spi_auto_gpo_task(void)
+{   // GPO edge, response is ready: read it now instead of at next poll
+    os_timer_t edge;
+    u32 latency;
 
-    // print result
-    for (i=0; i<(2+l+2); i++)
+    if ((! main_spi_auto) || _spi_cs_active)
+        return;
+
+    __disable_irq();
+    edge = _gpo_edge_time;
+    __enable_irq();
+
+    if (! _spi_auto_task())
+        return;
+
+    // GPO edge to response handed over to USB
+    latency = (u32)(timer_get_time() - edge);
+    main_auto_stats.count++;
+    main_auto_stats.sum_us += latency;
+    if (latency < main_auto_stats.min_us)
+        main_auto_stats.min_us = latency;
+    if (latency > main_auto_stats.max_us)
+        main_auto_stats.max_us = latency;
+
+    _spi_poll_time = timer_get_time() + main_spi_poll_ms*TIMER_MS;
+}
+
+static void _spi_frame_done(spi_job_t *job)
+{   // main loop, SPI job finished
+    _spi_cs_active = spi1_cs_state();
+    tty_put_frame(TTY_CH_SPI, job->rx, job->len);
+}
+
+static void _spi_frame_rx_handler(u8 *data, u32 len)
+{   // called from USB task, transfer runs in background, USB is served meanwhile
+    spi_job_t *job = &_spi_frame_job;
+    u8 source;
+
+    if ((len < 1) || job->busy)
+        return; // empty or previous transfer still pending (host waits for response)
+
+    memcpy(_spi_frame_tx, &data[1], len - 1);
+    job->tx = _spi_frame_tx;
+    job->rx = _spi_frame_rx;
+    job->len = len - 1; // 0 == CS control only
+    job->flags = SPI_JOB_CS_ASSERT;
+    if (! (data[0] & _SPI_FRAME_KEEP_CS))
+        job->flags |= SPI_JOB_CS_RELEASE;
+    job->done = _spi_frame_done;
+
+    _spi_cs_active = true;
+    source = spi1_trace_source(SPI_SOURCE_RAW);
+    spi1_submit(job);
+    spi1_trace_source(source);
+}
+
+static bool _spi_hex_line(const char *data)
+{   // "010202002b98" -> CS low, transfer, CS high, trailing 'x' or backslash leaves CS low
+    const char *p;
+    bool keep_cs = false;
+    int len;
+
+    len = hex_to_bin(_spi_line_tx, data, _SPI_BUF_SIZE);
+    if (len == 0)
+        return (false);
+
+    p = data + 2*len;
+    if ((*p == 'x') || (*p == '\\'))
     {
-        OS_PRINTF("%02X", spi_buf[i]);
+        keep_cs = true;
+        p++;
+    }
+    while (*p == ' ')
+        p++;
+    if (*p != '\0')
+        return (false); // not a HEX line, let command parser report it
+
+    STATS_INC(STATS_HEX_LINES);
+    _spi_cs_enable();
+    if (! spi1_data_transfer(_spi_line_rx, _spi_line_tx, len))
+    {   // e.g. packed mode and length not multiple of 4, MISO would be stale
+        _spi_cs_disable();
+        OS_PUTTEXT("ERROR: SPI transfer failed" NL);
+        return (true);
     }
-    OS_PRINTF(NL);
+    if (! keep_cs)
+        _spi_cs_disable();
+
+    len = bin_to_hex(_spi_line_hex, _spi_line_rx, len);
+    memcpy(&_spi_line_hex[len], NL, sizeof(NL));
+    OS_PUTTEXT(_spi_line_hex);
+    return (true);
 }
 
 static void _tty_rx_parser(char *data)
@@ -223,9 +458,15 @@ static void _tty_rx_parser(char *data)
     while (*data == ' ')
         data++; // skip spaces
 
-    // STM32 is the sole command handler: no raw hex pass-through
-    cmd_parse(data);
+    PROF_BEGIN(PROF_TTY_PARSER);
+    spi1_trace_source(SPI_SOURCE_RAW);
+    if (! _spi_hex_line(data))
+    {
+        spi1_trace_source(SPI_SOURCE_CMD);
+        cmd_parse(data);
+    }
     OS_FLUSH();
+    PROF_END(PROF_TTY_PARSER);
 }
 
 static void _usb_update_state(void)
@@ -247,14 +488,43 @@ static void _usb_update_state(void)
     {
         led_cyclic_sequence(&led1, _LED_MODE_IDLE);
         HW_SPI_OE_DISABLE;
+        tty_mux_reset(); // next host starts in text mode
     }
 
     prev_state = state;
 }
 
+static void _timer_task(os_timer_t now, os_timer_t *timer_100ms)
+{
+    if (main_spi_auto && (_spi_cs_active == false) && (now >= _spi_poll_time))
+    {   // fallback when GPO edge was missed (or GPO is not configured on target)
+        _spi_poll_time = now + main_spi_poll_ms*TIMER_MS;
+        if (_spi_auto_task())
+            main_auto_stats.polled++;
+    }
+
+    if (now < *timer_100ms)
+        return;
+
+    _usb_update_state();
+    *timer_100ms += 100*TIMER_MS;
+    led_tick(&led1);
+    wd_feed();
+}
+
+static void _timer_schedule(os_timer_t timer_100ms)
+{   // TIM2 compare wakes the loop at the nearest deadline, no periodic tick
+    os_timer_t next = timer_100ms;
+
+    if (main_spi_auto && (_spi_cs_active == false) && (_spi_poll_time < next))
+        next = _spi_poll_time;
+    timer_wake_at(next);
+}
+
 static void _main_task(void)
 {
-    os_timer_t now, timer_100ms = 0;
+    os_timer_t timer_100ms = 0;
+    u32 events;
 
     reset_clear();
     
@@ -265,35 +535,48 @@ static void _main_task(void)
    
     usb_device_init();
     spi1_init();
+    _main_clock_init();
 
     timer_100ms = timer_get_time();
 
+    // everything is pending after start
+    event_set(EVENT_USB | EVENT_TIMER | EVENT_UART);
+
     while (1)
     {
-        now = timer_get_time();
-        tty_rx_task();
-        usb_device_task();
+        events = event_take();
+        PROF_BEGIN(PROF_MAIN_LOOP);
 
-        if (now > timer_100ms)
+        if (events & EVENT_USB)
         {
-            _usb_update_state();
-            timer_100ms += 100*TIMER_MS;
-            led_tick(&led1);
-            wd_feed();
-            if (main_spi_auto)
-            {
-                if (_spi_cs_active == false)
-                {
-                    _spi_auto_task();
-                }
-            }
+            usb_device_task();
         }
-        __WFI(); // at least 1ms timer IRQ running
+        if (events & (EVENT_USB | EVENT_UART))
+        {
+            tty_rx_task();
+        }
+        if (events & EVENT_SPI)
+        {
+            spi1_task();
+        }
+        if (events & EVENT_GPO)
+        {
+            _spi_auto_gpo_task();
+        }
+        if (events & EVENT_TIMER)
+        {
+            _timer_task(timer_get_time(), &timer_100ms);
+        }
+
+        PROF_END(PROF_MAIN_LOOP);
+        _timer_schedule(timer_100ms);
+        event_wait(); // USB, DMA, UART and timer IRQs set pending events
     }
 }
 
 int main(void)
 {
+    mem_init(); // before anything deep runs on the stack
     sys_init();
     sys_clock_config();
     
@@ -302,16 +585,23 @@ int main(void)
 	MX_RNG_WarmUp();
     
     main_gpio_init();
+    main_auto_stats_reset();
+    _gpo_irq_init();
 
     wd_init();
     wd_run();
+    prof_cycles_init();
+    prof_init();
 
     reset_type = reset_get_type();
 
     timer_init();
+    stats_reset(); // time since clear counts from here
 
     OS_DELAY(10);
     tty_init(_tty_rx_parser);
+    tty_mux_set_rx_handler(TTY_CH_SPI, _spi_frame_rx_handler);
+    usb_cdc_data_rx_init(tls_pqc_usb_rx_handler); // second CDC interface carries TLS records
     OS_DELAY(10);
 
     OS_PUTTEXT(NL);
@@ -321,14 +611,7 @@ int main(void)
     OS_PUTTEXT("# BUILD DATE: " __DATE__ NL);
 
     OS_PUTTEXT("# RESET TYPE: ");
-    switch (reset_type)
-    {
-    case RESET_POWER_ON: OS_PUTTEXT("POWER_ON"); break;
-    case RESET_USER_RQ:  OS_PUTTEXT("USER_RQ");  break;
-    case RESET_WDT:      OS_PUTTEXT("WDT");      break;
-    case RESET_BOD:      OS_PUTTEXT("BOD");      break;
-    default:             OS_PUTTEXT("UNKNOWN");  break;
-    }
+    OS_PUTTEXT((char *)main_reset_name());
     OS_PUTTEXT(NL);
     OS_PUTTEXT(NL);
 
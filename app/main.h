@@ -10,6 +10,46 @@
 extern bool main_spi_auto;
 extern u8 main_spi_get_resp;
 extern u8 main_spi_no_resp;
+extern u32 main_spi_poll_ms;
+
+typedef struct {
+    u32 count;  // responses read on GPO edge
+    u32 polled; // responses found by fallback poll
+    u32 min_us; // GPO edge to response on USB
+    u32 max_us;
+    u64 sum_us;
+} main_auto_stats_t;
+
+extern main_auto_stats_t main_auto_stats;
+
+void main_auto_stats_reset(void);
+
+const char *main_reset_name(void); // cause of the last reset
+
+typedef enum {
+    MAIN_CLOCK_BASE = 0,    // 48 MHz
+    MAIN_CLOCK_PERF,        // 160 MHz
+    MAIN_CLOCK_AUTO,        // 48 MHz, 160 MHz during handshakes
+    MAIN_CLOCK_MODES
+} main_clock_e;
+
+extern u8 main_clock_mode;
+
+// make TEST=1 builds the test hooks (SEED, REPLAY), off in release images
+#ifndef TEST_ENABLE
+  #define TEST_ENABLE 0
+#endif
+
+#if TEST_ENABLE
+// fixed seed of custom_wc_GenerateSeed() for reproducible handshakes (test
+// only, not kept over reset), 0 == RNG peripheral
+extern u32 main_seed;
+
+void main_seed_set(u32 seed);
+#endif // TEST_ENABLE
+
+bool main_clock_set(u8 mode); // kept over reset, power on starts with HW_CLOCK_PROFILE
+void main_clock_boost(bool boost); // PQC heavy work begins / ends
 
 void Error_Handler(void);
 
@@ -0,0 +1,26 @@
+#include "pairing.h"
+#include "crc16.h"
+
+// linker script PAIRING region, one pairing_slot_t per L3 pairing key slot
+extern const pairing_slot_t _spairing[L3_PKEY_INDEX_MAX + 1];
+
+bool pairing_get(u8 slot, u8 *sh_priv, u8 *st_pub)
+{
+    const pairing_slot_t *p;
+    u16 crc;
+
+    if (slot > L3_PKEY_INDEX_MAX)
+        return (false);
+    p = &_spairing[slot];
+    if (p->magic != PAIRING_MAGIC)
+        return (false);
+
+    crc = crc16_update(CRC16_INIT, p->sh_priv, L3_KEY_SIZE);
+    crc = crc16_update(crc, p->st_pub, L3_KEY_SIZE);
+    if (crc != p->crc)
+        return (false);
+
+    memcpy(sh_priv, p->sh_priv, L3_KEY_SIZE);
+    memcpy(st_pub, p->st_pub, L3_KEY_SIZE);
+    return (true);
+}
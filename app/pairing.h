@@ -0,0 +1,25 @@
+#ifndef PAIRING_H
+#define PAIRING_H
+
+#include "common.h"
+#include "l3.h"
+
+// TROPIC01 pairing keys provisioned once into the last flash page (PAIRING
+// region of the linker script) by tls_usb_test/pairing_hex.py and st-flash,
+// never sent over USB. L3SESSION refers to them by slot. Write protect the
+// page (WRP option bytes) and set RDP level 1 after provisioning.
+
+#define PAIRING_MAGIC       (0x52494150UL) // "PAIR"
+
+typedef struct {
+    u32 magic;                  // PAIRING_MAGIC, erased flash == not provisioned
+    u8 sh_priv[L3_KEY_SIZE];    // host pairing private key (X25519)
+    u8 st_pub[L3_KEY_SIZE];     // chip X25519 public key
+    u16 crc;                    // CRC16 of both keys
+    u16 reserved;
+} pairing_slot_t;
+
+// copies keys of slot 0 .. L3_PKEY_INDEX_MAX, false when not provisioned
+bool pairing_get(u8 slot, u8 *sh_priv, u8 *st_pub);
+
+#endif // ! PAIRING_H
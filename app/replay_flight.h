@@ -0,0 +1,21 @@
+#ifndef REPLAY_FLIGHT_H
+#define REPLAY_FLIGHT_H
+
+/* Server flight of one recorded TLS handshake for REPLAY
+ *
+ * ServerHello up to server Finished of a handshake the device made with
+ * SEED=<REPLAY_FLIGHT_SEED>, compiled into the firmware.
+ * Generated automatically by tls_usb_test/replay_flight.py
+ * DO NOT EDIT MANUALLY - regenerate using the script instead.
+ *
+ * No flight recorded yet, REPLAY reports an error.
+ */
+
+#define REPLAY_FLIGHT_SEED  (0)
+#define REPLAY_FLIGHT_SIZE  (0)
+
+static const unsigned char replay_flight[] = {
+  0x00
+};
+
+#endif /* REPLAY_FLIGHT_H */
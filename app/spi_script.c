@@ -0,0 +1,289 @@
+#include "spi_script.h"
+#include "hardware.h"
+#include "spi.h"
+#include "time.h"
+#include "wd.h"
+
+// SPISCRIPT engine: text is compiled once to a program of fixed size
+// operations with MOSI data in one pool, then runs on the blocking DMA
+// transfers of spi1 and timer_get_time() for delays and poll timeouts.
+
+#define SPI_SCRIPT_POLL_US      (10) // between repeated poll transfers
+
+typedef enum {
+    _OP_CS = 0,
+    _OP_TRANSFER,   // T and R
+    _OP_WRITE,
+    _OP_DELAY,
+    _OP_POLL,
+    _OP_BRANCH,
+} spi_script_op_e;
+
+typedef struct {
+    u8 code;
+    u8 value;
+    u8 mask;
+    u16 index;      // poll/branch response byte
+    u16 offset;     // MOSI data in _tx
+    u16 len;
+    u32 arg;        // CS state, delay, poll timeout, branch skip
+} spi_script_op_t;
+
+static spi_script_op_t _ops[SPI_SCRIPT_OPS_MAX];
+static u32 _ops_count;
+static u8 _tx[SPI_SCRIPT_DATA_MAX] SRAM4_BSS;
+static u32 _tx_len;
+static u8 _scratch[SPI_SCRIPT_DATA_MAX] SRAM4_BSS; // responses not captured
+
+static bool _script_sep(char ch)
+{
+    return ((ch == ' ') || (ch == ';') || (ch == '\0') || (ch == '\r') || (ch == '\n'));
+}
+
+static bool _script_num(const char **pptext, u32 *dest, u32 max)
+{
+    char *end;
+    unsigned long num;
+
+    if ((**pptext < '0') || (**pptext > '9'))
+        return (false);
+    num = strtoul(*pptext, &end, 10);
+    if (num > max)
+        return (false);
+    *pptext = end;
+    *dest = num;
+    return (true);
+}
+
+static bool _script_byte(const char **pptext, u8 *dest)
+{
+    if (hex_to_bin(dest, *pptext, 1) != 1)
+        return (false);
+    *pptext += 2;
+    return (true);
+}
+
+static bool _script_comma(const char **pptext)
+{
+    if (**pptext != ',')
+        return (false);
+    (*pptext)++;
+    return (true);
+}
+
+static spi_script_result_e _script_data(const char **pptext, spi_script_op_t *op)
+{   // HEX MOSI bytes to the pool
+    int len;
+
+    len = hex_to_bin(&_tx[_tx_len], *pptext, SPI_SCRIPT_DATA_MAX - _tx_len);
+    if (len <= 0)
+        return (SPI_SCRIPT_ERR_SYNTAX);
+    if (is_hex(*(*pptext + 2*len)))
+    {   // odd number of digits or pool full
+        return ((_tx_len + len >= SPI_SCRIPT_DATA_MAX) ? SPI_SCRIPT_ERR_SIZE : SPI_SCRIPT_ERR_SYNTAX);
+    }
+    *pptext += 2*len;
+    op->offset = _tx_len;
+    op->len = len;
+    _tx_len += len;
+    return (SPI_SCRIPT_OK);
+}
+
+static spi_script_result_e _script_op(const char **pptext, spi_script_op_t *op)
+{
+    spi_script_result_e result = SPI_SCRIPT_OK;
+    u32 num;
+
+    memset(op, 0, sizeof(*op));
+    switch (toupper((unsigned char)*(*pptext)++))
+    {
+    case 'C':
+        op->code = _OP_CS;
+        if (! _script_num(pptext, &op->arg, 1))
+            return (SPI_SCRIPT_ERR_SYNTAX);
+        break;
+    case 'T':
+        op->code = _OP_TRANSFER;
+        result = _script_data(pptext, op);
+        break;
+    case 'W':
+        op->code = _OP_WRITE;
+        result = _script_data(pptext, op);
+        break;
+    case 'R':
+        op->code = _OP_TRANSFER;
+        if ((! _script_num(pptext, &num, SPI_SCRIPT_DATA_MAX)) || (num == 0))
+            return (SPI_SCRIPT_ERR_SYNTAX);
+        if (num > SPI_SCRIPT_DATA_MAX - _tx_len)
+            return (SPI_SCRIPT_ERR_SIZE);
+        memset(&_tx[_tx_len], 0, num);
+        op->offset = _tx_len;
+        op->len = num;
+        _tx_len += num;
+        break;
+    case 'D':
+        op->code = _OP_DELAY;
+        if (! _script_num(pptext, &op->arg, SPI_SCRIPT_DELAY_MAX))
+            return (SPI_SCRIPT_ERR_SYNTAX);
+        break;
+    case 'P':
+        op->code = _OP_POLL;
+        result = _script_data(pptext, op);
+        if (result != SPI_SCRIPT_OK)
+            return (result);
+        if ((! _script_comma(pptext)) || (! _script_num(pptext, &num, op->len - 1)) ||
+            (! _script_comma(pptext)) || (! _script_byte(pptext, &op->value)) ||
+            (! _script_comma(pptext)) || (! _script_num(pptext, &op->arg, SPI_SCRIPT_TIMEOUT_MAX)))
+            return (SPI_SCRIPT_ERR_SYNTAX);
+        op->index = num;
+        break;
+    case 'B':
+        op->code = _OP_BRANCH;
+        if ((! _script_num(pptext, &num, SPI_SCRIPT_DATA_MAX - 1)) ||
+            (! _script_comma(pptext)) || (! _script_byte(pptext, &op->mask)) ||
+            (! _script_comma(pptext)) || (! _script_byte(pptext, &op->value)) ||
+            (! _script_comma(pptext)) || (! _script_num(pptext, &op->arg, SPI_SCRIPT_OPS_MAX)))
+            return (SPI_SCRIPT_ERR_SYNTAX);
+        op->index = num;
+        break;
+    default:
+        return (SPI_SCRIPT_ERR_SYNTAX);
+    }
+
+    if ((result == SPI_SCRIPT_OK) && (! _script_sep(**pptext)))
+        return (SPI_SCRIPT_ERR_SYNTAX);
+    return (result);
+}
+
+spi_script_result_e spi_script_parse(const char *text, spi_script_reply_t *reply)
+{
+    spi_script_result_e result;
+
+    _ops_count = 0;
+    _tx_len = 0;
+    reply->ops = 0;
+
+    while (1)
+    {
+        while ((*text == ' ') || (*text == ';'))
+            text++;
+        if (_script_sep(*text))
+            break;
+
+        if (_ops_count >= SPI_SCRIPT_OPS_MAX)
+            return (SPI_SCRIPT_ERR_SIZE);
+        result = _script_op(&text, &_ops[_ops_count]);
+        if (result != SPI_SCRIPT_OK)
+        {
+            _ops_count = 0;
+            return (result);
+        }
+        reply->ops = ++_ops_count;
+    }
+    return ((_ops_count > 0) ? SPI_SCRIPT_OK : SPI_SCRIPT_ERR_SYNTAX);
+}
+
+static void _script_wait(os_timer_t until)
+{
+    while (timer_get_time() < until)
+        wd_feed();
+}
+
+static spi_script_result_e _script_poll(const spi_script_op_t *op, u8 *rx, spi_script_reply_t *reply)
+{
+    os_timer_t deadline = timer_get_time() + op->arg*TIMER_US;
+
+    while (1)
+    {
+        spi1_cs(true);
+        if (! spi1_data_transfer(rx, &_tx[op->offset], op->len))
+            return (SPI_SCRIPT_ERR_SPI); // CS released at end of script
+        if (rx[op->index] != op->value)
+            return (SPI_SCRIPT_OK);
+        spi1_cs(false);
+
+        if (timer_get_time() >= deadline)
+            return (SPI_SCRIPT_ERR_TIMEOUT);
+        reply->polls++;
+        _script_wait(timer_get_time() + SPI_SCRIPT_POLL_US*TIMER_US);
+    }
+}
+
+spi_script_result_e spi_script_run(spi_script_reply_t *reply)
+{
+    os_timer_t start = timer_get_time();
+    spi_script_result_e result = SPI_SCRIPT_OK;
+    const spi_script_op_t *op;
+    const u8 *last = NULL;
+    u32 last_len = 0, pos = 0, pc;
+    u8 *rx;
+
+    reply->ops = 0;
+    reply->polls = 0;
+    reply->captures = 0;
+
+    for (pc = 0; (pc < _ops_count) && (result == SPI_SCRIPT_OK); pc++)
+    {
+        op = &_ops[pc];
+        reply->ops++;
+        switch (op->code)
+        {
+        case _OP_CS:
+            spi1_cs(op->arg ? true : false);
+            break;
+
+        case _OP_TRANSFER:
+        case _OP_WRITE:
+        case _OP_POLL:
+            // captured responses follow each other, rest goes to scratch
+            rx = (op->code == _OP_WRITE) ? _scratch : &reply->data[pos];
+            if (op->code == _OP_POLL)
+                result = _script_poll(op, rx, reply);
+            else if (! spi1_data_transfer(rx, &_tx[op->offset], op->len))
+                result = SPI_SCRIPT_ERR_SPI;
+            last = rx;
+            last_len = op->len;
+            if (op->code != _OP_WRITE)
+            {
+                reply->len[reply->captures++] = op->len;
+                pos += op->len;
+            }
+            break;
+
+        case _OP_DELAY:
+            _script_wait(timer_get_time() + op->arg*TIMER_US);
+            break;
+
+        case _OP_BRANCH:
+            if ((last == NULL) || (op->index >= last_len))
+                result = SPI_SCRIPT_ERR_INDEX;
+            else if ((last[op->index] & op->mask) == op->value)
+                pc += op->arg;
+            break;
+
+        default:
+            break;
+        }
+    }
+
+    if (spi1_cs_state())
+        spi1_cs(false);
+    reply->time_us = (u32)(timer_get_time() - start);
+    return (result);
+}
+
+const char *spi_script_result_text(spi_script_result_e result)
+{
+    switch (result)
+    {
+    case SPI_SCRIPT_OK:          return ("OK");
+    case SPI_SCRIPT_ERR_SYNTAX:  return ("script syntax");
+    case SPI_SCRIPT_ERR_SIZE:    return ("script too long");
+    case SPI_SCRIPT_ERR_INDEX:   return ("byte index out of response");
+    case SPI_SCRIPT_ERR_TIMEOUT: return ("poll timeout");
+    case SPI_SCRIPT_ERR_SPI:     return ("SPI transfer failed");
+    default:
+        break;
+    }
+    return ("script error");
+}
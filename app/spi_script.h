@@ -0,0 +1,51 @@
+#ifndef SPI_SCRIPT_H
+#define SPI_SCRIPT_H
+
+#include "common.h"
+
+// Batched SPI operations, whole sequence runs on the device with one reply.
+// Operations, separated by space or ';':
+//   C0 / C1                       CS release / assert
+//   T<hex>                        transfer, response captured
+//   W<hex>                        transfer, response not captured
+//   R<n>                          read n bytes (MOSI 00), captured
+//   D<us>                         delay
+//   P<hex>,<i>,<val>,<timeout us> CS assert, transfer, until byte <i> of
+//                                 response differs from <val> CS release and
+//                                 repeat; CS stays asserted on success, last
+//                                 response captured
+//   B<i>,<mask>,<val>,<n>         skip next <n> operations when
+//                                 (byte <i> of last response & <mask>) == <val>
+// <hex>, <val>, <mask> in HEX, <i>, <n>, <us> decimal. CS is released at end.
+
+#define SPI_SCRIPT_OPS_MAX      (64)
+#define SPI_SCRIPT_DATA_MAX     (1024)  // all transferred bytes together
+#define SPI_SCRIPT_DELAY_MAX    (1000000UL)
+#define SPI_SCRIPT_TIMEOUT_MAX  (10000000UL)
+
+typedef enum {
+    SPI_SCRIPT_OK = 0,
+    SPI_SCRIPT_ERR_SYNTAX,
+    SPI_SCRIPT_ERR_SIZE,    // too many operations or bytes
+    SPI_SCRIPT_ERR_INDEX,   // branch or poll byte index behind response
+    SPI_SCRIPT_ERR_TIMEOUT, // poll condition not met
+    SPI_SCRIPT_ERR_SPI,     // transfer rejected by SPI driver or DMA failed
+} spi_script_result_e;
+
+typedef struct {
+    u32 ops;                // operations executed, or operation with error
+    u32 time_us;
+    u32 polls;              // repeated poll transfers
+    u32 captures;
+    u16 len[SPI_SCRIPT_OPS_MAX];
+    u8 data[SPI_SCRIPT_DATA_MAX];
+} spi_script_reply_t;
+
+// compiles text to the internal program, reply->ops is failing operation
+spi_script_result_e spi_script_parse(const char *text, spi_script_reply_t *reply);
+// runs the last parsed program, captured responses in reply
+spi_script_result_e spi_script_run(spi_script_reply_t *reply);
+
+const char *spi_script_result_text(spi_script_result_e result);
+
+#endif // ! SPI_SCRIPT_H
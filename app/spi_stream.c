@@ -0,0 +1,290 @@
+#include "spi_stream.h"
+#include "arena.h"
+#include "hardware.h"
+#include "spi.h"
+#include "time.h"
+#include "usb_device.h"
+#include "wd.h"
+
+// Read keeps one SPI job in flight while the previous block is written to
+// USB. Write receives into the fill block with usb_device_poll() only while
+// any read still fits (back pressure to the host by NAK), the full block
+// goes to SPI while the other one fills. Packed jobs need multiple of 4
+// bytes, 1 .. 3 bytes left over move to the start of the next block.
+
+#define SPI_STREAM_TIMEOUT      (OS_TIMER_SECOND) // no USB progress
+
+#define _MIN(a, b)              (((a) < (b)) ? (a) : (b))
+
+// RAM arena from spi_stream_start() or spi_stream_bench() to the end of run
+static u8 *_block[2];       // SPI_STREAM_BLOCK each
+static u8 *_idle;           // read: MOSI 00, write: MISO discarded
+static spi_job_t _job[2];
+static u8 *_fill;           // write: RX handler target, NULL drops data
+static u32 _fill_len;
+static u32 _fill_max;
+static usb_cdc_rx_pfunc_t _saved_rx_handler;
+
+static void _stream_rx_handler(u8 *data, u32 len)
+{   // called from usb_device_poll(), write loop checks room before
+    if (_fill == NULL)
+        return;
+    len = _MIN(len, _fill_max - _fill_len);
+    memcpy(&_fill[_fill_len], data, len);
+    _fill_len += len;
+}
+
+static void _stream_wait(spi_job_t *job, spi_stream_result_t *result)
+{
+    if (job->busy)
+        result->spi_waits++;
+    while (job->busy)
+        wd_feed();
+}
+
+static bool _stream_buffers(void)
+{   // blocks for one run, arena allocations are 8 byte aligned
+    if (! arena_enter(ARENA_SPI_STREAM))
+        return (false);
+    _block[0] = arena_alloc(ARENA_SPI_STREAM, SPI_STREAM_BLOCK);
+    _block[1] = arena_alloc(ARENA_SPI_STREAM, SPI_STREAM_BLOCK);
+    _idle = arena_alloc(ARENA_SPI_STREAM, SPI_STREAM_BLOCK);
+    return (true);
+}
+
+static void _stream_idle(void)
+{   // nothing queued, prescaler and packing may change
+    while (spi1_busy())
+        wd_feed();
+}
+
+static void _stream_submit(spi_job_t *job, u8 *tx, u8 *rx, u32 len, u8 flags,
+                           spi_stream_result_t *result)
+{   // buffers are aligned, lengths multiple of 4 in packed mode
+    job->tx = tx;
+    job->rx = rx;
+    job->len = len;
+    job->flags = flags;
+    job->delay_us = 0;
+    job->done = NULL;
+    spi1_submit(job);
+    result->blocks++;
+}
+
+static bool _stream_usb_tx(u8 *data, u32 len, spi_stream_result_t *result)
+{   // buffer must stay untouched until stack accepts all of it
+    os_timer_t last = timer_get_time();
+
+    while (usb_cdc_data_tx(data, (u16)len) != USB_RESULT_OK)
+    {
+        result->usb_waits++;
+        if ((timer_get_time() - last) > SPI_STREAM_TIMEOUT)
+            return (false);
+        usb_device_task();
+        wd_feed();
+    }
+    return (true);
+}
+
+static bool _stream_read(u32 len, spi_stream_result_t *result)
+{
+    u32 packed_len = len & ~3UL;
+    u32 pos = 0;
+    u32 n[2] = {0, 0};
+    u32 cur = 0;
+    u32 next;
+    bool ok = true;
+
+    memset(_idle, 0, SPI_STREAM_BLOCK);
+    spi1_set_packed(true);
+
+    if (packed_len > 0)
+    {
+        n[0] = _MIN(packed_len, SPI_STREAM_BLOCK);
+        _stream_submit(&_job[0], _idle, _block[0], n[0], 0, result);
+        pos = n[0];
+    }
+    while (result->bytes < packed_len)
+    {
+        _stream_wait(&_job[cur], result);
+        if (pos < packed_len)
+        {   // next block is clocked while this one goes to USB
+            next = cur ^ 1;
+            n[next] = _MIN(packed_len - pos, SPI_STREAM_BLOCK);
+            _stream_submit(&_job[next], _idle, _block[next], n[next], 0, result);
+            pos += n[next];
+        }
+        ok = _stream_usb_tx(_block[cur], n[cur], result);
+        if (! ok)
+            break;
+        result->bytes += n[cur];
+        cur ^= 1;
+    }
+
+    _stream_idle();
+    spi1_set_packed(false);
+    if (ok && (result->bytes < len))
+    {   // 1 .. 3 bytes
+        n[0] = len - result->bytes;
+        _stream_submit(&_job[0], _idle, _block[0], n[0], 0, result);
+        _stream_wait(&_job[0], result);
+        ok = _stream_usb_tx(_block[0], n[0], result);
+        if (ok)
+            result->bytes += n[0];
+    }
+    return (ok);
+}
+
+static bool _stream_write(u32 len, spi_stream_result_t *result)
+{
+    os_timer_t last, now;
+    u32 cur = 0;
+    u32 next;
+    u32 n, l;
+    bool ok = true;
+
+    spi1_set_packed(true);
+    _fill_len = 0;
+    _fill_max = _MIN(len, SPI_STREAM_BLOCK);
+    _fill = _block[0];
+
+    last = timer_get_time();
+    while (result->bytes < len)
+    {
+        if ((_fill_len < _fill_max) && ((SPI_STREAM_BLOCK - _fill_len) >= USB_DEVICE_POLL_MAX))
+        {   // any read fits, keep receiving
+            l = _fill_len;
+            usb_device_poll();
+            now = timer_get_time();
+            if (_fill_len != l)
+            {
+                last = now;
+            }
+            else
+            {
+                result->usb_waits++;
+                if ((now - last) > SPI_STREAM_TIMEOUT)
+                {
+                    ok = false;
+                    break;
+                }
+            }
+            wd_feed();
+            continue;
+        }
+
+        n = _fill_len & ~3UL;
+        if (n == 0)
+            break; // 1 .. 3 bytes of stream end, byte mode below
+
+        // other block must be on the bus before it fills again
+        next = cur ^ 1;
+        _stream_wait(&_job[next], result);
+        memcpy(_block[next], &_block[cur][n], _fill_len - n);
+        _stream_submit(&_job[cur], _block[cur], _idle, n, 0, result);
+        result->bytes += n;
+
+        _fill_len -= n;
+        _fill_max = _MIN(len - result->bytes, SPI_STREAM_BLOCK);
+        _fill = _block[next];
+        cur = next;
+    }
+
+    _stream_idle();
+    spi1_set_packed(false);
+    if (ok && (result->bytes < len))
+    {
+        n = len - result->bytes;
+        _stream_submit(&_job[cur], _block[cur], _idle, n, 0, result);
+        _stream_wait(&_job[cur], result);
+        result->bytes += n;
+    }
+    _fill = NULL;
+    return (ok);
+}
+
+bool spi_stream_start(spi_stream_mode_e mode)
+{
+    if (((mode != SPI_STREAM_READ) && (mode != SPI_STREAM_WRITE)) || (! usb_cdc_data_connected()))
+        return (false);
+
+    if (! _stream_buffers())
+        return (false);
+
+    // data arriving from now on belong to the stream, not to TLS
+    _fill = NULL;
+    _saved_rx_handler = usb_cdc_data_rx_handler();
+    usb_cdc_data_rx_init(_stream_rx_handler);
+    return (true);
+}
+
+bool spi_stream_run(spi_stream_mode_e mode, const u8 *prefix, u32 prefix_len,
+                    u32 len, spi_stream_result_t *result)
+{
+    static u8 cmd[SPI_STREAM_PREFIX_MAX] __attribute__((aligned(4)));
+    os_timer_t start;
+    bool ok;
+
+    memset(result, 0, sizeof(*result));
+    prefix_len = _MIN(prefix_len, SPI_STREAM_PREFIX_MAX);
+    memcpy(cmd, prefix, prefix_len);
+
+    _stream_idle();
+    start = timer_get_time();
+
+    // CS assert and command in byte mode, prefix response not kept
+    _stream_submit(&_job[0], cmd, _idle, prefix_len, SPI_JOB_CS_ASSERT, result);
+    _stream_wait(&_job[0], result);
+    result->blocks = 0;
+    result->spi_waits = 0;
+
+    if (mode == SPI_STREAM_READ)
+        ok = _stream_read(len, result);
+    else
+        ok = _stream_write(len, result);
+
+    spi1_cs(false);
+    result->time_us = (u32)(timer_get_time() - start);
+
+    usb_cdc_data_rx_init(_saved_rx_handler);
+    arena_leave(ARENA_SPI_STREAM);
+    return (ok);
+}
+
+bool spi_stream_bench(bool packed, u32 len, spi_stream_result_t *result)
+{   // packed length is rounded down to multiple of 4
+    os_timer_t start;
+    u32 cur = 0;
+    u32 n;
+
+    memset(result, 0, sizeof(*result));
+    if (packed)
+        len &= ~3UL;
+
+    _stream_idle();
+    if (! _stream_buffers())
+        return (false);
+    if (! spi1_set_packed(packed))
+    {
+        arena_leave(ARENA_SPI_STREAM);
+        return (false);
+    }
+    memset(_idle, 0, SPI_STREAM_BLOCK);
+
+    start = timer_get_time();
+    while (result->bytes < len)
+    {   // job of this block finished two submits ago
+        _stream_wait(&_job[cur], result);
+        n = _MIN(len - result->bytes, SPI_STREAM_BLOCK);
+        _stream_submit(&_job[cur], _idle, _block[cur], n, 0, result);
+        result->bytes += n;
+        cur ^= 1;
+        wd_feed();
+    }
+    _stream_idle();
+    result->time_us = (u32)(timer_get_time() - start);
+
+    spi1_set_packed(false);
+    arena_leave(ARENA_SPI_STREAM);
+    return (true);
+}
@@ -0,0 +1,39 @@
+#ifndef SPI_STREAM_H
+#define SPI_STREAM_H
+
+#include "common.h"
+
+// Bulk SPI transfers between the target and the CDC data port (second
+// /dev/ttyACM), e.g. memory dumps or target firmware update. Optional
+// command prefix is clocked in byte mode after CS assert, the data follow
+// in packed mode (4 frames per FIFO access and 32 bit DMA beat) in two
+// ping-pong blocks: SPI fills one while USB drains the other. Remaining
+// 1 .. 3 bytes are clocked in byte mode, CS is released at end.
+
+#define SPI_STREAM_BLOCK        (2048)  // bytes per SPI job, multiple of 4
+#define SPI_STREAM_PREFIX_MAX   (16)
+#define SPI_STREAM_LEN_MAX      (0x10000000UL)
+
+typedef enum {
+    SPI_STREAM_READ = 0,    // SPI (MOSI 00) to USB
+    SPI_STREAM_WRITE,       // USB to SPI, MISO discarded
+} spi_stream_mode_e;
+
+typedef struct {
+    u32 bytes;      // clocked on SPI after prefix
+    u32 time_us;
+    u32 blocks;     // SPI jobs
+    u32 spi_waits;  // USB side had to wait for SPI block
+    u32 usb_waits;  // read: TX busy, write: poll without data
+} spi_stream_result_t;
+
+// takes over data port RX from TLS and RAM arena for the blocks, true when
+// host has the port open and no other mode owns the arena
+bool spi_stream_start(spi_stream_mode_e mode);
+// runs until len bytes are done or 1 s without USB progress, gives RX back
+bool spi_stream_run(spi_stream_mode_e mode, const u8 *prefix, u32 prefix_len,
+                    u32 len, spi_stream_result_t *result);
+// SPI only throughput, ping-pong jobs with CS released, USB not involved
+bool spi_stream_bench(bool packed, u32 len, spi_stream_result_t *result);
+
+#endif // ! SPI_STREAM_H
@@ -3,7 +3,19 @@
 #include "type.h"
 #include "os.h"
 #include "usb_device.h"
+#include "tty.h"
 #include "wd.h"
+#include "event.h"
+#include "prof.h"
+#include "arena.h"
+#include "bench.h"
+#include "crc16.h"
+#include "main.h"
+#include "mem.h"
+#if TEST_ENABLE
+#include "replay_flight.h"
+#endif
+#include "stats.h"
 #include <wolfssl/ssl.h>
 #include <wolfssl/wolfcrypt/settings.h>
 #include <wolfssl/wolfcrypt/logging.h>
@@ -22,11 +34,12 @@
 /* * CRITICAL: With PQC (Kyber/Dilithium), handshake messages are HUGE.
  * If WolfSSL pauses to do math, this buffer must hold the ENTIRE 
  * incoming flight of data. If 16KB is too small, packets drop.
+ * The buffer is taken from the RAM arena for the session only.
  */
 #define RING_BUF_SIZE 32768  // Increased to 32KB to be safe for PQC
 
 typedef struct {
-    uint8_t buffer[RING_BUF_SIZE];
+    uint8_t *buffer;         // RING_BUF_SIZE, arena while tls_active
     volatile uint32_t head;
     volatile uint32_t tail;
     volatile uint32_t overflow_count; // Debugging counter
@@ -37,12 +50,18 @@ RingBuffer rxRing = {.head = 0, .tail = 0, .overflow_count = 0 };
 /* TLS active state tracking */
 static bool tls_active = false;
 
+#if TEST_ENABLE
+/* REPLAY running: no USB I/O, no debug output inside the measurement */
+static bool replay_active = false;
+#endif
+
 /* * Writes data to the ring buffer. 
  * CRITICAL FIX: Added overflow detection logging.
  */
 void RB_Write(RingBuffer* rb, const uint8_t* data, uint32_t len) {
     uint32_t bytes_written = 0;
     
+    PROF_BEGIN(PROF_RB_WRITE);
     for (uint32_t i = 0; i < len; i++) {
         uint32_t next_head = (rb->head + 1) % RING_BUF_SIZE;
         
@@ -57,6 +76,9 @@ void RB_Write(RingBuffer* rb, const uint8_t* data, uint32_t len) {
             rb->overflow_count++;
         }
     }
+    STATS_ADD(STATS_TLS_RX_OVERFLOW, len - bytes_written);
+    STATS_PEAK(STATS_TLS_RX_PEAK, (rb->head + RING_BUF_SIZE - rb->tail) % RING_BUF_SIZE);
+    PROF_END(PROF_RB_WRITE);
 }
 
 int RB_Read(RingBuffer* rb, char* data, int len) {
@@ -64,10 +86,12 @@ int RB_Read(RingBuffer* rb, char* data, int len) {
     
     // Optimization: Block copy if possible could be added here, 
     // but byte-copy is safe for ring wrapping.
+    PROF_BEGIN(PROF_RB_READ);
     while (bytes_read < len && rb->tail != rb->head) {
         data[bytes_read++] = rb->buffer[rb->tail];
         rb->tail = (rb->tail + 1) % RING_BUF_SIZE;
     }
+    PROF_END(PROF_RB_READ);
     return bytes_read;
 }
 
@@ -87,14 +111,21 @@ int RB_Available(RingBuffer* rb) {
 static void debug_printf(const char* format, ...)
 {
     char buffer[256];
+    int l;
     va_list args;
+
+#if TEST_ENABLE
+    if (replay_active) {
+        return;
+    }
+#endif
     va_start(args, format);
-    vsnprintf(buffer, sizeof(buffer), format, args);
+    l = snprintf(buffer, sizeof(buffer), "DEBUG: ");
+    vsnprintf(&buffer[l], sizeof(buffer) - l, format, args);
     va_end(args);
     
     OS_FLUSH(); /* Flush before printing */
-    OS_PRINTF("DEBUG: %s", buffer);
-    OS_FLUSH(); /* Flush after printing */
+    tty_put_log(buffer); /* Log channel in MUX mode, doesn't mix with TLS records */
 }
 
 /* -------------------------------------------------------------------------
@@ -144,9 +175,7 @@ static void wolfssl_debug_callback(const int logLevel, const char *const logMess
 {
     (void)logLevel; /* Unused, but kept for API compatibility */
     if (logMessage != NULL) {
-        OS_FLUSH(); /* Flush before printing */
-        OS_PRINTF("DEBUG: %s", logMessage);
-        OS_FLUSH(); /* Flush after printing */
+        debug_printf("%s", logMessage);
     }
 }
 #endif /* DEBUG_WOLFSSL */
@@ -156,6 +185,9 @@ static void wolfssl_debug_callback(const int logLevel, const char *const logMess
  * ------------------------------------------------------------------------- */
 
 void tls_pqc_usb_rx_handler(u8 *data, u32 len) {
+    if (!tls_active) {
+        return; /* no session, nothing would read it */
+    }
     RB_Write(&rxRing, data, len);
 }
 
@@ -164,7 +196,7 @@ int EmbedReceive(WOLFSSL* ssl, char* buf, int sz, void* ctx) {
     
     /* Debug Check: report overflows if they happened during the last slice */
     if (rb->overflow_count > 0) {
-        OS_PRINTF("DEBUG: [CRITICAL] RX BUFFER OVERFLOW! Lost %lu bytes", (unsigned long)rb->overflow_count);
+        debug_printf("[CRITICAL] RX BUFFER OVERFLOW! Lost %lu bytes", (unsigned long)rb->overflow_count);
 
         rb->overflow_count = 0; // Reset to avoid spam
     }
@@ -179,7 +211,7 @@ int EmbedReceive(WOLFSSL* ssl, char* buf, int sz, void* ctx) {
 int EmbedSend(WOLFSSL* ssl, char* buf, int sz, void* ctx) {
     (void)ssl; (void)ctx;
     
-    if (!usb_device_connected()) {
+    if (!(tty_mux_enabled() ? usb_device_connected() : usb_cdc_data_connected())) {
         return WOLFSSL_CBIO_ERR_CONN_RST;
     }
     
@@ -188,7 +220,14 @@ int EmbedSend(WOLFSSL* ssl, char* buf, int sz, void* ctx) {
      */
     usb_device_task();
     
-    usb_result_e result = usb_cdc_tx((u8*)buf, (u16)sz);
+    if (tty_mux_enabled()) {
+        /* TLS channel frames, partial write is retried by wolfSSL */
+        size_t sent = tty_put_frame(TTY_CH_TLS, (u8*)buf, sz);
+        return (sent > 0) ? (int)sent : WOLFSSL_CBIO_ERR_WANT_WRITE;
+    }
+
+    /* TLS data CDC interface, console stays free for commands and log */
+    usb_result_e result = usb_cdc_data_tx((u8*)buf, (u16)sz);
     
     if (result == USB_RESULT_BUSY) {
         return WOLFSSL_CBIO_ERR_WANT_WRITE;
@@ -202,7 +241,7 @@ int EmbedSend(WOLFSSL* ssl, char* buf, int sz, void* ctx) {
  * Properly cleans up WolfSSL objects and resets state
  * ------------------------------------------------------------------------- */
 
-static void cleanup_tls_resources(WOLFSSL* ssl, WOLFSSL_CTX* ctx) {
+static void free_tls_resources(WOLFSSL* ssl, WOLFSSL_CTX* ctx) {
     /* Clean up SSL objects */
     if (ssl != NULL) {
         wolfSSL_free(ssl);
@@ -215,6 +254,14 @@ static void cleanup_tls_resources(WOLFSSL* ssl, WOLFSSL_CTX* ctx) {
     rxRing.head = 0;
     rxRing.tail = 0;
     rxRing.overflow_count = 0;
+
+    /* USB events were taken by the handshake loop, console lines read
+     * meanwhile wait in the stream buffer for the main loop */
+    event_set(EVENT_USB);
+}
+
+static void cleanup_tls_resources(WOLFSSL* ssl, WOLFSSL_CTX* ctx) {
+    free_tls_resources(ssl, ctx);
     
     /* Flush USB buffers to ensure clean state for next run */
     for (int i = 0; i < 5; i++) {
@@ -227,6 +274,8 @@ static void cleanup_tls_resources(WOLFSSL* ssl, WOLFSSL_CTX* ctx) {
      */
     
     tls_active = false;
+    rxRing.buffer = NULL;
+    arena_leave(ARENA_TLS);
     
     debug_printf("TLS task completed, ready for next command");
     
@@ -239,32 +288,26 @@ static void cleanup_tls_resources(WOLFSSL* ssl, WOLFSSL_CTX* ctx) {
 }
 
 /* -------------------------------------------------------------------------
- * Main TLS Task
+ * Session Setup
+ * Context with client credentials and SSL object reading the RX ring,
+ * shared by the handshake over USB and the replay. On failure the caller
+ * frees what was created.
  * ------------------------------------------------------------------------- */
 
-void tls_pqc_task(void) {
-    WOLFSSL_CTX* ctx = NULL;
-    WOLFSSL* ssl = NULL;
+static bool setup_tls_resources(WOLFSSL_CTX** pctx, WOLFSSL** pssl, CallbackIOSend send) {
+    WOLFSSL_CTX* ctx;
+    WOLFSSL* ssl;
     int ret;
-    int error_count = 0;
 
-    tls_active = true;
-
-    wolfSSL_Init();
-    
-    /* Enable Debug Logging with custom callback */
-    #ifdef DEBUG_WOLFSSL
-    wolfSSL_SetLoggingCb(wolfssl_debug_callback);
-    wolfSSL_Debugging_ON();
-    #endif
-
-    debug_printf("TLS PQC task starting. RB Size: %d", RING_BUF_SIZE);
+    *pctx = NULL;
+    *pssl = NULL;
 
     ctx = wolfSSL_CTX_new(wolfTLSv1_3_client_method());
     if (ctx == NULL) {
         debug_printf("Error: Failed to create SSL context");
-        goto cleanup;
+        return false;
     }
+    *pctx = ctx;
 
     /* Enable certificate verification with maximum security */
     /* WOLFSSL_VERIFY_PEER: Require peer to present a certificate */
@@ -274,7 +317,7 @@ void tls_pqc_task(void) {
     wolfSSL_CTX_set_verify(ctx, WOLFSSL_VERIFY_PEER | WOLFSSL_VERIFY_FAIL_IF_NO_PEER_CERT, cert_verify_callback);
     
     wolfSSL_CTX_SetIORecv(ctx, EmbedReceive);
-    wolfSSL_CTX_SetIOSend(ctx, EmbedSend);
+    wolfSSL_CTX_SetIOSend(ctx, send);
 
     /* Load client certificate and keys for mutual TLS authentication */
     #ifdef WOLFSSL_DUAL_ALG_CERTS
@@ -282,7 +325,7 @@ void tls_pqc_task(void) {
     ret = wolfSSL_CTX_use_certificate_buffer(ctx, client_cert_der, (long)client_cert_der_len, WOLFSSL_FILETYPE_ASN1);
     if (ret != WOLFSSL_SUCCESS) {
         debug_printf("Error: Failed to load client certificate (code=%d)", ret);
-        goto cleanup;
+        return false;
     }
     debug_printf("Client certificate loaded successfully");
 
@@ -290,7 +333,7 @@ void tls_pqc_task(void) {
     ret = wolfSSL_CTX_use_PrivateKey_buffer(ctx, client_key_der, (long)client_key_der_len, WOLFSSL_FILETYPE_ASN1);
     if (ret != WOLFSSL_SUCCESS) {
         debug_printf("Error: Failed to load client ECC key (code=%d)", ret);
-        goto cleanup;
+        return false;
     }
     debug_printf("Client ECC key loaded successfully");
 
@@ -303,7 +346,7 @@ void tls_pqc_task(void) {
         ret = wolfSSL_CTX_use_AltPrivateKey_buffer(ctx, client_dilithium_key_der, (long)client_dilithium_key_der_len, WOLFSSL_FILETYPE_PEM);
         if (ret != WOLFSSL_SUCCESS) {
             debug_printf("Error: Failed to load client Dilithium key (code=%d)", ret);
-            goto cleanup;
+            return false;
         }
         debug_printf("Client Dilithium key loaded successfully (PEM format)");
     } else {
@@ -316,28 +359,72 @@ void tls_pqc_task(void) {
     ssl = wolfSSL_new(ctx);
     if (ssl == NULL) {
         debug_printf("Error: Failed to create SSL object");
-        goto cleanup;
+        return false;
     }
+    *pssl = ssl;
     
     /* Set CKS (Dual-Alg) verification after SSL object is created */
     byte cks_order[] = { WOLFSSL_CKS_SIGSPEC_BOTH };
     if (!wolfSSL_UseCKS(ssl, cks_order, sizeof(cks_order))) {
         debug_printf("Error: Failed to set Dual-Alg (CKS) verification to BOTH");
-        goto cleanup;
+        return false;
     }
 
     wolfSSL_SetIOReadCtx(ssl, &rxRing);
 
+    return true;
+}
+
+/* -------------------------------------------------------------------------
+ * Main TLS Task
+ * ------------------------------------------------------------------------- */
+
+void tls_pqc_task(void) {
+    WOLFSSL_CTX* ctx = NULL;
+    WOLFSSL* ssl = NULL;
+    int ret;
+    int error_count = 0;
+    bool handshake_ok = false;
+    timer_time_t start;
+
+    if (!arena_enter(ARENA_TLS)) {
+        debug_printf("Error: RAM arena owned by %s", arena_mode_name(arena_mode()));
+        return;
+    }
+    rxRing.buffer = arena_alloc(ARENA_TLS, RING_BUF_SIZE);
+    tls_active = true;
+
+    wolfSSL_Init();
+    
+    /* Enable Debug Logging with custom callback */
+    #ifdef DEBUG_WOLFSSL
+    wolfSSL_SetLoggingCb(wolfssl_debug_callback);
+    wolfSSL_Debugging_ON();
+    #endif
+
+    debug_printf("TLS PQC task starting. RB Size: %d", RING_BUF_SIZE);
+
+#if TEST_ENABLE
+    /* SEED: seed stream from the start, every handshake sends the same ClientHello */
+    main_seed_set(main_seed);
+#endif
+    if (!setup_tls_resources(&ctx, &ssl, EmbedSend)) {
+        goto cleanup;
+    }
+
     /* Reset Ring Buffer state before starting */
     rxRing.head = 0;
     rxRing.tail = 0;
     rxRing.overflow_count = 0;
 
     debug_printf("Starting TLS handshake...");
+    start = timer_get_time();
 
     /* Handshake Loop */
     while (1) {
+        PROF_BEGIN(PROF_TLS_CONNECT);
         ret = wolfSSL_connect(ssl);
+        PROF_END(PROF_TLS_CONNECT);
         if (ret == WOLFSSL_SUCCESS) break; 
 
         int err = wolfSSL_get_error(ssl, ret);
@@ -350,9 +437,11 @@ void tls_pqc_task(void) {
             }
 
             /* * CRITICAL: We need to yield to let USB interrupts fire, 
-             * but not sleep too long.
+             * but not sleep too long. Next USB packet or timer wakes us.
              */
-            OS_DELAY(1); 
+            timer_wake_at(timer_get_time() + 100*TIMER_MS);
+            event_wait_mask(EVENT_USB | EVENT_TIMER);
+            (void)event_take_mask(EVENT_USB | EVENT_TIMER);
             usb_device_task();
             wd_feed();
             
@@ -382,9 +471,14 @@ void tls_pqc_task(void) {
             goto cleanup;
         }
         debug_printf("TLS Handshake Complete! Cipher: %s", wolfSSL_get_cipher(ssl));
+        handshake_ok = true;
+        STATS_INC(STATS_TLS_OK);
+        STATS_ADD(STATS_TLS_MS, (u32)((timer_get_time() - start) / TIMER_MS));
         
         const char* msg = "hello";
+        PROF_BEGIN(PROF_TLS_WRITE);
         int write_ret = wolfSSL_write(ssl, msg, strlen(msg));
+        PROF_END(PROF_TLS_WRITE);
         if (write_ret < 0) {
             int write_err = wolfSSL_get_error(ssl, write_ret);
             debug_printf("Error: TLS write failed (code=%d)", write_err);
@@ -400,6 +494,9 @@ void tls_pqc_task(void) {
     }
 
 cleanup:
+    if (!handshake_ok) {
+        STATS_INC(STATS_TLS_FAILED);
+    }
     cleanup_tls_resources(ssl, ctx);
 }
 
@@ -411,4 +508,174 @@ bool tls_pqc_handshake_with_data(const char* data_to_send) {
 
 bool tls_pqc_is_active(void) {
     return tls_active;
-}
\ No newline at end of file
+}
+
+void tls_pqc_client_credentials(const u8 **cert, u32 *cert_len,
+                                const u8 **mldsa_key, u32 *mldsa_key_len) {
+    *cert = client_cert_der;
+    *cert_len = client_cert_der_len;
+    *mldsa_key = client_dilithium_key_der;
+    *mldsa_key_len = client_dilithium_key_der_len;
+}
+
+#if TEST_ENABLE
+/* -------------------------------------------------------------------------
+ * Handshake Replay
+ * Server flight of a recorded handshake (replay_flight.h) goes into the RX
+ * ring at a set rate, client records go to a counter. The RNG seed of the
+ * recording makes the ClientHello the same as then, so the flight decrypts
+ * and the handshake completes without USB or server. CRC16 of the client
+ * records shows the runs (and builds) did the same handshake.
+ * ------------------------------------------------------------------------- */
+
+static u32 replay_sent = 0;
+static u16 replay_crc = CRC16_INIT;
+
+static int ReplaySend(WOLFSSL* ssl, char* buf, int sz, void* ctx) {
+    (void)ssl; (void)ctx;
+
+    replay_crc = crc16_update(replay_crc, (const u8*)buf, sz);
+    replay_sent += sz;
+    return sz;
+}
+
+static void replay_feed(u32 *fed, u32 due) {
+    /* no more than the ring takes, the rest follows on next slices */
+    u32 room = RING_BUF_SIZE - 1 - RB_Available(&rxRing);
+    u32 len = due - *fed;
+
+    if (len > room) {
+        len = room;
+    }
+    RB_Write(&rxRing, &replay_flight[*fed], len);
+    *fed += len;
+}
+
+/* One handshake, 0 or wolfSSL error; cycles of the wolfSSL_connect() slices */
+static int replay_handshake(u32 rate, u32 *cycles, u32 *time_us) {
+    WOLFSSL_CTX* ctx = NULL;
+    WOLFSSL* ssl = NULL;
+    timer_time_t start, now;
+    u32 fed = 0;
+    u32 due, t0;
+    u32 seed = main_seed; /* SEED of the user, back after the handshake */
+    int ret;
+    int err = 0;
+
+    *cycles = 0;
+    main_seed_set(REPLAY_FLIGHT_SEED);
+    replay_sent = 0;
+    replay_crc = CRC16_INIT;
+    if (!setup_tls_resources(&ctx, &ssl, ReplaySend)) {
+        free_tls_resources(ssl, ctx);
+        main_seed_set(seed);
+        return WOLFSSL_FATAL_ERROR;
+    }
+
+    start = timer_get_time();
+    while (1) {
+        /* bytes a link of <rate> B/ms would have brought by now */
+        now = timer_get_time();
+        due = REPLAY_FLIGHT_SIZE;
+        if ((rate != 0) && ((u64)rate * (now - start) / TIMER_MS < due)) {
+            due = (u32)((u64)rate * (now - start) / TIMER_MS);
+        }
+        if (due > fed) {
+            replay_feed(&fed, due);
+        }
+
+        t0 = bench_cycles();
+        ret = wolfSSL_connect(ssl);
+        *cycles += bench_cycles() - t0;
+        if (ret == WOLFSSL_SUCCESS) {
+            err = 0;
+            break;
+        }
+        err = wolfSSL_get_error(ssl, ret);
+        if (err != WOLFSSL_ERROR_WANT_READ && err != WOLFSSL_ERROR_WANT_WRITE) {
+            break;
+        }
+        if (fed == REPLAY_FLIGHT_SIZE && RB_IsEmpty(&rxRing)) {
+            break; /* flight ended early: other ClientHello than recorded */
+        }
+        if (fed < REPLAY_FLIGHT_SIZE) {
+            /* link idle time, not counted in cycles */
+            timer_wake_at(now + TIMER_MS);
+            event_wait_mask(EVENT_USB | EVENT_TIMER);
+            (void)event_take_mask(EVENT_USB | EVENT_TIMER);
+        }
+        usb_device_task();
+        wd_feed();
+    }
+    *time_us = (u32)(timer_get_time() - start);
+
+    free_tls_resources(ssl, ctx);
+    main_seed_set(seed);
+    return err;
+}
+
+u32 tls_pqc_replay_flight(u32 *seed) {
+    *seed = REPLAY_FLIGHT_SEED;
+    return REPLAY_FLIGHT_SIZE;
+}
+
+bool tls_pqc_replay(u32 iterations, u32 rate, tls_pqc_replay_t *result) {
+    mem_peak_t peak;
+    u32 cycles, time_us;
+    int err = 0;
+
+    memset(result, 0, sizeof(*result));
+    result->flight = REPLAY_FLIGHT_SIZE;
+    result->min = (u32)-1;
+    if (REPLAY_FLIGHT_SIZE == 0) {
+        result->error = BAD_FUNC_ARG; /* no flight compiled in */
+        return false;
+    }
+    if (!arena_enter(ARENA_TLS)) {
+        result->error = BAD_STATE_E;
+        return false;
+    }
+    rxRing.buffer = arena_alloc(ARENA_TLS, RING_BUF_SIZE);
+    rxRing.head = 0;
+    rxRing.tail = 0;
+    rxRing.overflow_count = 0;
+    wolfSSL_Init();
+    replay_active = true;
+
+    while (result->iterations < iterations) {
+        /* setup allocations count too, they are part of every handshake */
+        mem_mark();
+        err = replay_handshake(rate, &cycles, &time_us);
+        mem_since_mark(&peak);
+        if (err != 0) {
+            break;
+        }
+        result->iterations++;
+        result->cycles += cycles;
+        result->time_us += time_us;
+        if (cycles < result->min) {
+            result->min = cycles;
+        }
+        if (cycles > result->max) {
+            result->max = cycles;
+        }
+        if (peak.stack > result->stack) {
+            result->stack = peak.stack;
+        }
+        if (peak.heap > result->heap) {
+            result->heap = peak.heap;
+        }
+    }
+    result->sent = replay_sent;
+    result->crc = replay_crc;
+
+    replay_active = false;
+    rxRing.buffer = NULL;
+    arena_leave(ARENA_TLS);
+    if (result->iterations == 0) {
+        result->min = 0;
+    }
+    result->error = err;
+    return (err == 0);
+}
+#endif /* TEST_ENABLE */
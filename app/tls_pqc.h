@@ -12,7 +12,9 @@
     #else
         /* type.h not found - provide minimal type definitions for test environment */
         typedef unsigned char u8;
+        typedef uint16_t u16;
         typedef uint32_t u32;
+        typedef uint64_t u64;
         typedef unsigned char byte;
     #endif
 #else
@@ -24,7 +26,9 @@
     /* If type.h still not available after include attempt, define minimal types */
     #ifndef TYPE_H
         typedef unsigned char u8;
+        typedef uint16_t u16;
         typedef uint32_t u32;
+        typedef uint64_t u64;
         typedef unsigned char byte;
     #endif
 #endif
@@ -43,6 +47,38 @@ void tls_pqc_usb_rx_handler(u8 *data, u32 len);
 /* Check if TLS handshake is currently active */
 bool tls_pqc_is_active(void);
 
+#if TEST_ENABLE
+/* Handshake replay (REPLAY, make TEST=1): recorded server flight of replay_flight.h fed
+ * into the RX ring at <rate> bytes per ms (0 == all at once), RNG seeded
+ * with the seed of the recording, no USB I/O. Cycles count the
+ * wolfSSL_connect() slices only, time includes waiting for the flight.
+ */
+#define TLS_PQC_REPLAY_MAX  (1000)
+
+typedef struct {
+    u32 iterations;     /* handshakes completed */
+    u32 flight;         /* server bytes per handshake */
+    u32 sent;           /* client bytes of the last handshake */
+    u16 crc;            /* CRC16 of them, same on every run and build */
+    u64 cycles;         /* all handshakes together */
+    u32 min;            /* cycles of fastest and slowest handshake */
+    u32 max;
+    u64 time_us;        /* first flight byte to done, all handshakes */
+    u32 stack;          /* deepest stack use of one handshake */
+    u32 heap;           /* heap peak of one handshake incl. setup */
+    int error;          /* wolfSSL error, WANT_READ == flight ended early */
+} tls_pqc_replay_t;
+
+/* Size of the compiled in flight, 0 == none */
+u32 tls_pqc_replay_flight(u32 *seed);
+/* false on error, result->error tells which */
+bool tls_pqc_replay(u32 iterations, u32 rate, tls_pqc_replay_t *result);
+#endif /* TEST_ENABLE */
+
+/* Client certificate and ML-DSA private key (DER), also used by BENCH */
+void tls_pqc_client_credentials(const u8 **cert, u32 *cert_len,
+                                const u8 **mldsa_key, u32 *mldsa_key_len);
+
 #endif /* TLS_PQC_H */
 
 
@@ -143,6 +143,10 @@
 /* Single-precision ECC acceleration (disabled to save ~45 KiB flash) */
 //#define WOLFSSL_HAVE_SP_ECC
 
+/* X25519 for the TROPIC01 L3 secure session (app/l3.c), small code variant */
+#define HAVE_CURVE25519
+#define CURVE25519_SMALL
+
 /* Timing resistance - CRITICAL for side-channel attack prevention */
 #define ECC_TIMING_RESISTANT
 /* RSA enabled for WOLFSSL_DUAL_ALG_CERTS support (required even if using ECC+Dilithium) */
@@ -0,0 +1,349 @@
+/* host_bench.c
+ * Runs the firmware crypto benchmark (app/bench.c, BENCH command) on the
+ * host with wolfSSL built from app/user_settings.h, optionally next to the
+ * PQClean clean implementations of the post-quantum schemes. Text output
+ * has the lines of the BENCH command with the implementation in front,
+ * JSON output is for comparing results across commits.
+ *
+ * Usage: ./crypto_bench [-j] [-i] [-n <iterations>] [name]
+ *   -j  JSON output
+ *   -i  instructions (perf counter, user space) instead of nanoseconds
+ */
+
+#include "bench.h"
+#include "mem.h"
+#include "tls_pqc.h"
+#include "wd.h"
+
+#include <wolfssl/wolfcrypt/settings.h>
+#include <wolfssl/wolfcrypt/error-crypt.h>
+#include <wolfssl/wolfcrypt/random.h>
+
+#include <linux/perf_event.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/random.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "client_certs.h"
+
+#if BENCH_PQCLEAN
+#include "crypto_kem/ml-kem-768/clean/api.h"
+#include "crypto_sign/ml-dsa-65/clean/api.h"
+#include "crypto_sign/sphincs-sha2-128f-simple/clean/api.h"
+#endif
+
+#ifndef BENCH_REV
+  #define BENCH_REV         "unknown"
+#endif
+
+#define ITERATIONS_DEFAULT  (100)
+#define MSG_SIZE            (32)
+
+static int _perf_fd = -1;   // instruction counter, -1 == nanoseconds
+static bool _json = false;
+static u32 _printed = 0;
+
+// --- firmware stand-ins used by app/bench.c ---
+
+u32 bench_host_clock(void)
+{   // differences of the low 32 bits are enough for one operation
+    struct timespec ts;
+    u64 count;
+
+    if (_perf_fd >= 0)
+    {
+        if (read(_perf_fd, &count, sizeof(count)) != sizeof(count))
+            count = 0;
+        return ((u32)count);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((u32)((u64)ts.tv_sec * 1000000000ULL + (u64)ts.tv_nsec));
+}
+
+int custom_wc_GenerateSeed(OS_Seed* os, byte* output, word32 sz)
+{   // STM32 RNG on the target
+    (void)os;
+    return ((getrandom(output, sz, 0) == (ssize_t)sz) ? 0 : RNG_FAILURE_E);
+}
+
+void tls_pqc_client_credentials(const u8 **cert, u32 *cert_len,
+                                const u8 **mldsa_key, u32 *mldsa_key_len)
+{
+    *cert = client_cert_der;
+    *cert_len = client_cert_der_len;
+    *mldsa_key = client_dilithium_key_der;
+    *mldsa_key_len = client_dilithium_key_der_len;
+}
+
+void wd_feed(void)
+{
+}
+
+void mem_mark(void)
+{
+}
+
+void mem_since_mark(mem_peak_t *peak)
+{   // no stack painting and heap wrapper on the host, reported as 0
+    memset(peak, 0, sizeof(*peak));
+}
+
+// --- PQClean reference implementations ---
+
+#if BENCH_PQCLEAN
+
+typedef struct {
+    const char *name;
+    int (*setup)(void);
+    int (*op)(void);
+} pqclean_entry_t;
+
+static u8 _msg[MSG_SIZE];
+
+static u8 _kem_pk[PQCLEAN_MLKEM768_CLEAN_CRYPTO_PUBLICKEYBYTES];
+static u8 _kem_sk[PQCLEAN_MLKEM768_CLEAN_CRYPTO_SECRETKEYBYTES];
+static u8 _kem_ct[PQCLEAN_MLKEM768_CLEAN_CRYPTO_CIPHERTEXTBYTES];
+static u8 _kem_ss[PQCLEAN_MLKEM768_CLEAN_CRYPTO_BYTES];
+
+static u8 _dsa_pk[PQCLEAN_MLDSA65_CLEAN_CRYPTO_PUBLICKEYBYTES];
+static u8 _dsa_sk[PQCLEAN_MLDSA65_CLEAN_CRYPTO_SECRETKEYBYTES];
+static u8 _dsa_sig[PQCLEAN_MLDSA65_CLEAN_CRYPTO_BYTES];
+static size_t _dsa_sig_len;
+
+static u8 _spx_pk[PQCLEAN_SPHINCSSHA2128FSIMPLE_CLEAN_CRYPTO_PUBLICKEYBYTES];
+static u8 _spx_sk[PQCLEAN_SPHINCSSHA2128FSIMPLE_CLEAN_CRYPTO_SECRETKEYBYTES];
+static u8 _spx_sig[PQCLEAN_SPHINCSSHA2128FSIMPLE_CLEAN_CRYPTO_BYTES];
+static size_t _spx_sig_len;
+
+static int _kem_keygen(void)
+{
+    return (PQCLEAN_MLKEM768_CLEAN_crypto_kem_keypair(_kem_pk, _kem_sk));
+}
+
+static int _kem_encaps(void)
+{
+    return (PQCLEAN_MLKEM768_CLEAN_crypto_kem_enc(_kem_ct, _kem_ss, _kem_pk));
+}
+
+static int _kem_decaps(void)
+{
+    return (PQCLEAN_MLKEM768_CLEAN_crypto_kem_dec(_kem_ss, _kem_ct, _kem_sk));
+}
+
+static int _kem_setup(void)
+{   // key pair and one ciphertext for decapsulation
+    int ret = _kem_keygen();
+
+    return ((ret == 0) ? _kem_encaps() : ret);
+}
+
+static int _dsa_keygen(void)
+{
+    return (PQCLEAN_MLDSA65_CLEAN_crypto_sign_keypair(_dsa_pk, _dsa_sk));
+}
+
+static int _dsa_sign(void)
+{
+    return (PQCLEAN_MLDSA65_CLEAN_crypto_sign_signature(_dsa_sig, &_dsa_sig_len,
+                                                        _msg, sizeof(_msg), _dsa_sk));
+}
+
+static int _dsa_verify(void)
+{
+    return (PQCLEAN_MLDSA65_CLEAN_crypto_sign_verify(_dsa_sig, _dsa_sig_len,
+                                                     _msg, sizeof(_msg), _dsa_pk));
+}
+
+static int _dsa_setup(void)
+{   // key pair and one signature for verification
+    int ret = _dsa_keygen();
+
+    return ((ret == 0) ? _dsa_sign() : ret);
+}
+
+static int _spx_keygen(void)
+{
+    return (PQCLEAN_SPHINCSSHA2128FSIMPLE_CLEAN_crypto_sign_keypair(_spx_pk, _spx_sk));
+}
+
+static int _spx_sign(void)
+{
+    return (PQCLEAN_SPHINCSSHA2128FSIMPLE_CLEAN_crypto_sign_signature(_spx_sig, &_spx_sig_len,
+                                                                      _msg, sizeof(_msg), _spx_sk));
+}
+
+static int _spx_verify(void)
+{
+    return (PQCLEAN_SPHINCSSHA2128FSIMPLE_CLEAN_crypto_sign_verify(_spx_sig, _spx_sig_len,
+                                                                   _msg, sizeof(_msg), _spx_pk));
+}
+
+static int _spx_setup(void)
+{
+    int ret = _spx_keygen();
+
+    return ((ret == 0) ? _spx_sign() : ret);
+}
+
+static const pqclean_entry_t _PQCLEAN[] = {
+    {"MLKEM768_KEYGEN",     _kem_setup, _kem_keygen},
+    {"MLKEM768_ENCAPS",     _kem_setup, _kem_encaps},
+    {"MLKEM768_DECAPS",     _kem_setup, _kem_decaps},
+    {"MLDSA65_KEYGEN",      _dsa_setup, _dsa_keygen},
+    {"MLDSA65_SIGN",        _dsa_setup, _dsa_sign},
+    {"MLDSA65_VERIFY",      _dsa_setup, _dsa_verify},
+    {"SPHINCS128F_KEYGEN",  _spx_setup, _spx_keygen},
+    {"SPHINCS128F_SIGN",    _spx_setup, _spx_sign},
+    {"SPHINCS128F_VERIFY",  _spx_setup, _spx_verify},
+};
+
+static void _pqclean_run(const pqclean_entry_t *entry, u32 iterations, bench_result_t *result)
+{   // same measurement as bench_run()
+    u32 start, clocks;
+    int ret;
+
+    memset(result, 0, sizeof(*result));
+    result->min = (u32)-1;
+    memset(_msg, 0x5A, sizeof(_msg));
+
+    ret = entry->setup();
+    while ((ret == 0) && (result->iterations < iterations))
+    {
+        start = bench_host_clock();
+        ret = entry->op();
+        clocks = bench_host_clock() - start;
+        if (ret != 0)
+            break;
+
+        result->iterations++;
+        result->cycles += clocks;
+        if (clocks < result->min)
+            result->min = clocks;
+        if (clocks > result->max)
+            result->max = clocks;
+    }
+    if (result->iterations == 0)
+        result->min = 0;
+    result->error = ret;
+}
+
+#endif // BENCH_PQCLEAN
+
+// --- output ---
+
+static bool _perf_open(void)
+{   // user space instructions of this process
+    struct perf_event_attr attr;
+
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    _perf_fd = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+    return (_perf_fd >= 0);
+}
+
+static void _print(const char *impl, const char *name, const bench_result_t *r)
+{   // avg, min and max are per operation in the selected unit
+    u64 avg = (r->iterations > 0) ? (r->cycles / r->iterations) : 0;
+    u64 ops = ((_perf_fd < 0) && (r->cycles > 0)) ? (1000000000ULL * r->iterations / r->cycles) : 0;
+
+    if (_json)
+    {
+        printf("%s\n    {\"impl\": \"%s\", \"name\": \"%s\", \"iterations\": %u, \"bytes\": %u, "
+               "\"avg\": %llu, \"min\": %u, \"max\": %u, \"ops_per_s\": %llu, \"error\": %d}",
+               (_printed > 0) ? "," : "", impl, name, r->iterations, r->bytes,
+               (unsigned long long)avg, r->min, r->max, (unsigned long long)ops, r->error);
+    }
+    else if (r->error != 0)
+    {
+        printf("%s, %s, ERROR %d\n", impl, name, r->error);
+    }
+    else
+    {   // <impl>, <name>, <iterations>, <bytes>, <avg>, <min>, <max>, <ops/s>
+        printf("%s, %s, %u, %u, %llu, %u, %u, %llu\n", impl, name, r->iterations, r->bytes,
+               (unsigned long long)avg, r->min, r->max, (unsigned long long)ops);
+    }
+    fflush(stdout);
+    _printed++;
+}
+
+static bool _selected(const char *filter, const char *name)
+{
+    return ((filter == NULL) || (strcasecmp(filter, name) == 0));
+}
+
+int main(int argc, char **argv)
+{
+    const char *filter = NULL;
+    const char *unit;
+    bench_result_t result;
+    u32 iterations = ITERATIONS_DEFAULT;
+    u32 failures = 0;
+    u32 i;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "jin:")) != -1)
+    {
+        switch (opt)
+        {
+            case 'j':
+                _json = true;
+                break;
+            case 'i':
+                if (! _perf_open())
+                {
+                    fprintf(stderr, "perf instruction counter not available\n");
+                    return (2);
+                }
+                break;
+            case 'n':
+                iterations = (u32)strtoul(optarg, NULL, 0);
+                break;
+            default:
+                fprintf(stderr, "usage: %s [-j] [-i] [-n <iterations>] [name]\n", argv[0]);
+                return (2);
+        }
+    }
+    if (optind < argc)
+        filter = argv[optind];
+    if ((iterations == 0) || (iterations > BENCH_ITERATIONS_MAX))
+        iterations = ITERATIONS_DEFAULT;
+    unit = (_perf_fd >= 0) ? "instructions" : "ns";
+
+    if (_json)
+        printf("{\n  \"rev\": \"%s\",\n  \"unit\": \"%s\",\n  \"results\": [", BENCH_REV, unit);
+    else
+        printf("# %s, %s per operation\n", BENCH_REV, unit);
+
+    for (i = 0; i < bench_count(); i++)
+    {
+        if (! _selected(filter, bench_name(i)))
+            continue;
+        if (! bench_run(i, iterations, &result))
+            failures++;
+        _print("wolfcrypt", bench_name(i), &result);
+    }
+#if BENCH_PQCLEAN
+    for (i = 0; i < sizeof(_PQCLEAN) / sizeof(_PQCLEAN[0]); i++)
+    {
+        if (! _selected(filter, _PQCLEAN[i].name))
+            continue;
+        _pqclean_run(&_PQCLEAN[i], iterations, &result);
+        if (result.error != 0)
+            failures++;
+        _print("pqclean", _PQCLEAN[i].name, &result);
+    }
+#endif
+
+    if (_json)
+        printf("\n  ]\n}\n");
+    return ((failures == 0) ? 0 : 1);
+}
@@ -0,0 +1,6 @@
+#ifndef STM32U5XX_H
+#define STM32U5XX_H
+
+// Host build: no device header, AES undefined keeps the STM32 CRYP port out
+
+#endif // ! STM32U5XX_H
@@ -0,0 +1,23 @@
+#ifndef BENCH_USER_SETTINGS_H
+#define BENCH_USER_SETTINGS_H
+
+// Host builds (bench/, sim/): firmware wolfSSL settings (app/user_settings.h)
+// as they are, only the STM32 port is taken out. stm32u5xx.h is the stand-in
+// of the build directory, HAL configuration is skipped by its include guard.
+
+#define STM32U5xx_HAL_CONF_H
+#include "../app/user_settings.h"
+
+#undef WOLFSSL_STM32U5
+#undef STM32_HAL_V2
+#undef WOLFSSL_STM32_CUBEMX
+#undef STM32_RNG
+
+// RNG is the HAL peripheral of main.c (sim/ stand-in), no wolfSSL alias
+#define NO_OLD_RNGNAME
+
+// glibc has struct tm and gmtime()
+#undef USE_WOLF_TM
+#undef WOLFSSL_GMTIME
+
+#endif // ! BENCH_USER_SETTINGS_H
@@ -0,0 +1,40 @@
+# wolfSSL sources of app/Makefile without the Cortex-M and STM32 ports,
+# shared by the host builds (bench/, sim/). WOLFSSL_DIR is set by includer.
+
+WOLFSSL_SOURCES = \
+  $(WOLFSSL_DIR)/src/internal.c \
+  $(WOLFSSL_DIR)/src/keys.c \
+  $(WOLFSSL_DIR)/src/ssl.c \
+  $(WOLFSSL_DIR)/src/tls.c \
+  $(WOLFSSL_DIR)/src/tls13.c \
+  $(WOLFSSL_DIR)/src/wolfio.c \
+  $(WOLFSSL_DIR)/wolfcrypt/src/aes.c \
+  $(WOLFSSL_DIR)/wolfcrypt/src/asn.c \
+  $(WOLFSSL_DIR)/wolfcrypt/src/coding.c \
+  $(WOLFSSL_DIR)/wolfcrypt/src/curve25519.c \
+  $(WOLFSSL_DIR)/wolfcrypt/src/dilithium.c \
+  $(WOLFSSL_DIR)/wolfcrypt/src/ecc.c \
+  $(WOLFSSL_DIR)/wolfcrypt/src/error.c \
+  $(WOLFSSL_DIR)/wolfcrypt/src/evp.c \
+  $(WOLFSSL_DIR)/wolfcrypt/src/ext_mlkem.c \
+  $(WOLFSSL_DIR)/wolfcrypt/src/fe_low_mem.c \
+  $(WOLFSSL_DIR)/wolfcrypt/src/hash.c \
+  $(WOLFSSL_DIR)/wolfcrypt/src/hmac.c \
+  $(WOLFSSL_DIR)/wolfcrypt/src/kdf.c \
+  $(WOLFSSL_DIR)/wolfcrypt/src/logging.c \
+  $(WOLFSSL_DIR)/wolfcrypt/src/memory.c \
+  $(WOLFSSL_DIR)/wolfcrypt/src/misc.c \
+  $(WOLFSSL_DIR)/wolfcrypt/src/pwdbased.c \
+  $(WOLFSSL_DIR)/wolfcrypt/src/random.c \
+  $(WOLFSSL_DIR)/wolfcrypt/src/rsa.c \
+  $(WOLFSSL_DIR)/wolfcrypt/src/sha.c \
+  $(WOLFSSL_DIR)/wolfcrypt/src/sha256.c \
+  $(WOLFSSL_DIR)/wolfcrypt/src/sha3.c \
+  $(WOLFSSL_DIR)/wolfcrypt/src/sha512.c \
+  $(WOLFSSL_DIR)/wolfcrypt/src/signature.c \
+  $(WOLFSSL_DIR)/wolfcrypt/src/sp_int.c \
+  $(WOLFSSL_DIR)/wolfcrypt/src/wc_encrypt.c \
+  $(WOLFSSL_DIR)/wolfcrypt/src/wc_mlkem.c \
+  $(WOLFSSL_DIR)/wolfcrypt/src/wc_mlkem_poly.c \
+  $(WOLFSSL_DIR)/wolfcrypt/src/wc_port.c \
+  $(WOLFSSL_DIR)/wolfcrypt/src/wolfmath.c
@@ -22,6 +22,7 @@
 #define UART1_ISR_PRIO          DEF_PRIO
 #define USB_ISR_PRIO            DEF_PRIO
 #define SPI_ISR_PRIO            DEF_PRIO
+#define GPO_ISR_PRIO            DEF_PRIO
 
 #endif // ! HARDWARE_H
 
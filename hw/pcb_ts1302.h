@@ -5,7 +5,8 @@
 
 #define	HW_HSE_ENABLED 1 // HSE crystal 8MHz assembled 
 
-#define SYSCLK                  48000000
+#define SYSCLK                  48000000 // boot clock, see CLOCK command
+#define HW_CLOCK_PROFILE        0        // after power on: 0 = 48 MHz, 1 = 160 MHz, 2 = auto
 #define HCLK                    SYSCLK
 #define PCLK1                   (HCLK/2)
 #define APB1CLK                 (PCLK1/1)
@@ -59,6 +60,12 @@
 #define HW_GPO_IN_PORT     GPIOB
 #define HW_GPO_IN_INIT     GPIO_PIN_INIT(HW_GPO_IN_PORT,HW_GPO_IN_BIT,GPIO_MODE_INPUT)
 #define HW_GPO_IN          GPIO_IN(HW_GPO_IN_PORT,HW_GPO_IN_BIT)
+// GPO rising edge interrupt (response ready)
+#define HW_GPO_EXTI_PORT   LL_EXTI_EXTI_PORTB
+#define HW_GPO_EXTI_SOURCE LL_EXTI_EXTI_LINE0
+#define HW_GPO_EXTI_LINE   LL_EXTI_LINE_0
+#define HW_GPO_EXTI_IRQn   EXTI0_IRQn
+#define HW_GPO_EXTI_IRQHandler EXTI0_IRQHandler
 
 // VCC power switch
 #define HW_CHIP_PWR_BIT     (0)
@@ -0,0 +1,11 @@
+#ifndef CRC16_H
+#define CRC16_H
+
+#include "common.h"
+
+#define CRC16_INIT (0x0000)
+
+u16 crc16_update(u16 crc, const u8 *data, size_t len);
+u16 crc16(const u8 *data, size_t len);
+
+#endif // ! CRC16_H
@@ -52,53 +52,60 @@ int is_number(const char *str, int limit)
     return (i);
 }
 
-static int _hex_to_bin(char ch)
-{
-    if ((ch >= '0') && (ch <= '9'))
-        return (ch -'0');
-    if ((ch >= 'a') && (ch <= 'f'))
-        return (10 + ch - 'a');
-    if ((ch >= 'A') && (ch <= 'F'))
-        return (10 + ch - 'A');
-
-    return (-1);
-}
+// nibble value of HEX character, 0xFF for anything else
+static const u8 _HEX_TO_BIN[256] = {
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+       0,    1,    2,    3,    4,    5,    6,    7,    8,    9, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF,   10,   11,   12,   13,   14,   15, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF,   10,   11,   12,   13,   14,   15, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+};
+
+static const char _BIN_TO_HEX[16] = "0123456789ABCDEF";
 
 bool is_hex(char ch)
 {
-	return ((_hex_to_bin(ch) >= 0) ? true : false);
-}
-
-static bool _get_hex(u8 *dest, const char *src)
-{   // read one byte of HEX value
-    int tmp;
-    u8 result = 0;
-    
-    if ((tmp = _hex_to_bin(*src++)) < 0)
-        return (false);
-
-    result = tmp<<4;
-
-    if ((tmp = _hex_to_bin(*src++)) < 0)
-        return (false);
-
-    result |= tmp;
-    *dest = result;
-    return (true);
+    return ((_HEX_TO_BIN[(u8)ch] != 0xFF) ? true : false);
 }
 
 int hex_to_bin(u8 *dest, const char *src, int limit)
-{
-	int i;
+{   // returns number of bytes, stops at first character pair which is not HEX
+    u8 hi, lo;
+    int i;
 
-	for (i=0; i<limit; i++)
-	{
-        if (! _get_hex(dest, src))
+    for (i=0; i<limit; i++)
+    {
+        if ((hi = _HEX_TO_BIN[(u8)src[0]]) == 0xFF)
+            break;
+        if ((lo = _HEX_TO_BIN[(u8)src[1]]) == 0xFF)
             break;
 
-		dest++;
-		src += 2;
-	}
-	return (i);
+        *dest++ = (hi << 4) | lo;
+        src += 2;
+    }
+    return (i);
 }
 
+int bin_to_hex(char *dest, const u8 *src, int len)
+{   // upper case HEX string with terminating zero, returns number of characters
+    int i;
+
+    for (i=0; i<len; i++)
+    {
+        *dest++ = _BIN_TO_HEX[src[i] >> 4];
+        *dest++ = _BIN_TO_HEX[src[i] & 0x0F];
+    }
+    *dest = '\0';
+    return (2*len);
+}
@@ -8,6 +8,7 @@ bool is_char(char ch);
 int is_number(const char *str, int limit);
 bool is_hex(char ch);
 int hex_to_bin(u8 *dest, const char *src, int limit);
+int bin_to_hex(char *dest, const u8 *src, int len);
 
 #endif // ! UTIL_H
 
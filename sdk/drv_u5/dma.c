@@ -25,7 +25,7 @@ extern SPI_HandleTypeDef hspi1;
 /**
   * @brief  DMA Linked-list Queue_tx configuration
   */
-static void _linked_list_tx_config(void)
+static void _linked_list_tx_config(bool word)
 {
     // DMA node configuration declaration
     DMA_NodeConfTypeDef pNodeConfig;
@@ -37,8 +37,8 @@ static void _linked_list_tx_config(void)
     pNodeConfig.Init.Direction = DMA_MEMORY_TO_PERIPH;
     pNodeConfig.Init.SrcInc = DMA_SINC_INCREMENTED;
     pNodeConfig.Init.DestInc = DMA_DINC_FIXED;
-    pNodeConfig.Init.SrcDataWidth = DMA_SRC_DATAWIDTH_BYTE;
-    pNodeConfig.Init.DestDataWidth = DMA_DEST_DATAWIDTH_BYTE;
+    pNodeConfig.Init.SrcDataWidth = word ? DMA_SRC_DATAWIDTH_WORD : DMA_SRC_DATAWIDTH_BYTE;
+    pNodeConfig.Init.DestDataWidth = word ? DMA_DEST_DATAWIDTH_WORD : DMA_DEST_DATAWIDTH_BYTE;
     pNodeConfig.Init.SrcBurstLength = 1;
     pNodeConfig.Init.DestBurstLength = 1;
     pNodeConfig.Init.TransferAllocatedPort = DMA_SRC_ALLOCATED_PORT1|DMA_DEST_ALLOCATED_PORT0;
@@ -52,15 +52,12 @@ static void _linked_list_tx_config(void)
 
     // Build Node_tx Node
     HAL_DMAEx_List_BuildNode(&pNodeConfig, &Node_tx);
-
-    // Insert Node_tx to Queue
-    HAL_DMAEx_List_InsertNode_Tail(&Queue_tx, &Node_tx);
 }
   
 /**
   * @brief  DMA Linked-list Queue_rx configuration
   */
-static void _linked_list_rx_config(void)
+static void _linked_list_rx_config(bool word)
 {
     // DMA node configuration declaration
     DMA_NodeConfTypeDef pNodeConfig;
@@ -72,8 +69,8 @@ static void _linked_list_rx_config(void)
     pNodeConfig.Init.Direction = DMA_PERIPH_TO_MEMORY;
     pNodeConfig.Init.SrcInc = DMA_SINC_FIXED;
     pNodeConfig.Init.DestInc = DMA_DINC_INCREMENTED;
-    pNodeConfig.Init.SrcDataWidth = DMA_SRC_DATAWIDTH_BYTE;
-    pNodeConfig.Init.DestDataWidth = DMA_DEST_DATAWIDTH_BYTE;
+    pNodeConfig.Init.SrcDataWidth = word ? DMA_SRC_DATAWIDTH_WORD : DMA_SRC_DATAWIDTH_BYTE;
+    pNodeConfig.Init.DestDataWidth = word ? DMA_DEST_DATAWIDTH_WORD : DMA_DEST_DATAWIDTH_BYTE;
     pNodeConfig.Init.SrcBurstLength = 1;
     pNodeConfig.Init.DestBurstLength = 1;
     pNodeConfig.Init.TransferAllocatedPort = DMA_SRC_ALLOCATED_PORT0|DMA_DEST_ALLOCATED_PORT0;
@@ -87,9 +84,6 @@ static void _linked_list_rx_config(void)
 
     // Build Node_rx Node
     HAL_DMAEx_List_BuildNode(&pNodeConfig, &Node_rx);
-
-    // Insert Node_rx to Queue
-    HAL_DMAEx_List_InsertNode_Tail(&Queue_rx, &Node_rx);
 }
 
 
@@ -119,7 +113,8 @@ void dma_init_spi_rx(void)
     }
     irq_enable(GPDMA1_Channel6_IRQn, 0);
 
-    _linked_list_rx_config();
+    _linked_list_rx_config(false);
+    HAL_DMAEx_List_InsertNode_Tail(&Queue_rx, &Node_rx);
     HAL_DMAEx_List_LinkQ(&handle_GPDMA1_Channel6, &Queue_rx);
     __HAL_LINKDMA(&hspi1, hdmarx, handle_GPDMA1_Channel6);
 }
@@ -142,11 +137,24 @@ void dma_init_spi_tx(void)
     }
     irq_enable(GPDMA1_Channel7_IRQn, 0);
 
-    _linked_list_tx_config();
+    _linked_list_tx_config(false);
+    HAL_DMAEx_List_InsertNode_Tail(&Queue_tx, &Node_tx);
     HAL_DMAEx_List_LinkQ(&handle_GPDMA1_Channel7, &Queue_tx);
     __HAL_LINKDMA(&hspi1, hdmatx, handle_GPDMA1_Channel7);
 }
 
+void dma_spi_set_word(bool word)
+{   // SPI1 packed mode: 32 bit beats on both ports, one request moves 4 frames;
+    // single beats only, channels 6 and 7 have 8 byte FIFO. Channels idle.
+    _linked_list_rx_config(word);
+    _linked_list_tx_config(word);
+    // HAL SPI reads data widths from handle when it sets up the transfer
+    handle_GPDMA1_Channel6.Init.SrcDataWidth = word ? DMA_SRC_DATAWIDTH_WORD : DMA_SRC_DATAWIDTH_BYTE;
+    handle_GPDMA1_Channel6.Init.DestDataWidth = word ? DMA_DEST_DATAWIDTH_WORD : DMA_DEST_DATAWIDTH_BYTE;
+    handle_GPDMA1_Channel7.Init.SrcDataWidth = word ? DMA_SRC_DATAWIDTH_WORD : DMA_SRC_DATAWIDTH_BYTE;
+    handle_GPDMA1_Channel7.Init.DestDataWidth = word ? DMA_DEST_DATAWIDTH_WORD : DMA_DEST_DATAWIDTH_BYTE;
+}
+
 void GPDMA1_Channel6_IRQHandler(void)
 {
     HAL_DMA_IRQHandler(&handle_GPDMA1_Channel6);
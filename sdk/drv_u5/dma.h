@@ -8,6 +8,7 @@ void Error_Handler(void);
 bool dma_init(void);
 void dma_init_spi_rx(void);
 void dma_init_spi_tx(void);
+void dma_spi_set_word(bool word);
 
 void dma_spi_rx_start(char *dest, size_t len);
 void dma_spi_tx_start(char *src, size_t len);
@@ -7,11 +7,14 @@
 #define	GPREG_BOOT_REBOOT        0x00000100UL // 
 #define GPREG_BOOT_STAY_IN_BOOT  0x0000AABBUL // 
 #define GPREG_WDID_REBOOT_RQ     0x0000b098UL
+#define GPREG_CLOCK_VALID        0xC10C0000UL // | clock profile
+#define GPREG_CLOCK_MASK         0xFFFF0000UL
 
 #define GPREG_WR_ENABLE
 
 #define GPREG_BOOT  TAMP->BKP0R // information for bootloader (if present)
 #define GPREG_WDID  TAMP->BKP1R // watchdog-reset reason
+#define GPREG_CLOCK TAMP->BKP2R // clock profile kept over reset
 
 #define	GPREG_WRITE(reg, value) {GPREG_WR_ENABLE; reg=value;}
 
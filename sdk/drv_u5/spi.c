@@ -6,6 +6,10 @@
 #include "dma.h"
 #include "irq.h"
 #include "sys.h"
+#include "event.h"
+#include "time.h"
+#include "prof.h"
+#include "stats.h"
 
 #include "log.h"
 LOG_DEF("SPI");
@@ -23,7 +27,24 @@ LOG_DEF("SPI");
 #define PRESCALER_SPI_MAX 256
 
 static bool _spi1_cs_state = SPI_CS_IDLE; // true == active == LOW
-static volatile bool _spi_transfer_done = false;
+static bool _spi1_packed = false;          // 4 frames per FIFO access and DMA beat
+static u32 _spi1_sck = 0;                  // SCK [Hz] kept across SYSCLK changes
+
+// job queue, next job is started from completion IRQ of the previous one;
+// the IRQ moves the pointers, volatile so spi1_busy() loops read them again
+static spi_job_t * volatile _job_head = NULL;   // waiting
+static spi_job_t * volatile _job_tail = NULL;
+static spi_job_t * volatile _job_active = NULL; // transferring or in delay after transfer
+static spi_job_t * volatile _done_head = NULL;  // finished, done callback pending
+static spi_job_t * volatile _done_tail = NULL;
+
+// transaction trace ring, one flag test per job when disabled
+static bool _trace_on = false;
+static u8 _trace_source = SPI_SOURCE_RAW;
+static u32 _trace_start_us;
+static bool _trace_cs;
+static spi_trace_t _trace[SPI_TRACE_SIZE];
+static u32 _trace_head = 0; // entries recorded since enable
 
 SPI_HandleTypeDef hspi1;
 
@@ -72,6 +93,11 @@ u32 spi1_get_prescaler(void)
     return (0); // impossible value
 }
 
+u32 spi1_get_frequency(void)
+{   // SCK [Hz], kernel clock is SYSCLK
+    return (sys_get_hclk() / spi1_get_prescaler());
+}
+
 bool spi1_set_prescaler(u32 value)
 {
     u32 prescaler;
@@ -90,9 +116,42 @@ bool spi1_set_prescaler(u32 value)
         return (false);
     }
     SPI1->CFG1 = (SPI1->CFG1 & ~SPI_CFG1_MBR) | prescaler;
+    _spi1_sck = sys_get_hclk() / value;
     return (true);
 }
 
+void spi1_clock_update(void)
+{   // after SYSCLK change: fastest prescaler not above SCK set before,
+    // call with SPI idle
+    u32 sck = _spi1_sck;
+    u32 value;
+
+    for (value = 2; (value < PRESCALER_SPI_MAX) && ((sys_get_hclk() / value) > sck); value *= 2)
+        ;
+    spi1_set_prescaler(value);
+    _spi1_sck = sck; // next change starts from the same SCK again
+}
+
+bool spi1_set_packed(bool packed)
+{   // bulk mode, jobs must be multiple of 4 bytes on 4 byte aligned buffers;
+    // CFG1 is written with SPE off, HAL disables SPI after every transfer
+    if (packed == _spi1_packed)
+        return (true);
+    if (spi1_busy())
+        return (false);
+
+    hspi1.Init.FifoThreshold = packed ? SPI_FIFO_THRESHOLD_04DATA : SPI_FIFO_THRESHOLD_01DATA;
+    SPI1->CFG1 = (SPI1->CFG1 & ~SPI_CFG1_FTHLV) | hspi1.Init.FifoThreshold;
+    dma_spi_set_word(packed);
+    _spi1_packed = packed;
+    return (true);
+}
+
+bool spi1_packed(void)
+{
+    return (_spi1_packed);
+}
+
 void spi1_init(void)
 {
     SPI_AutonomousModeConfTypeDef HAL_SPI_AutonomousMode_Cfg_Struct = {0};
@@ -131,20 +190,190 @@ void spi1_init(void)
         Error_Handler();
     }
 
+    _spi1_sck = sys_get_hclk() / spi1_get_prescaler();
+
     dma_init_spi_rx();
     dma_init_spi_tx();
+    timer3_init(); // delay between jobs
 }
 
-void spi1_data_transfer(u8 *rx, u8 *tx, size_t len)
-{   // 
-    _spi_transfer_done = false;
-   
-    // non-blocking function
-    HAL_SPI_TransmitReceive_DMA(&hspi1, (u8*)tx, (u8 *)rx, len);
-    
-    // make it blocking, wait until done
-    while (_spi_transfer_done == false)
+static void _trace_record(const spi_job_t *job)
+{   // IRQ context or IRQ disabled, job transfer finished or failed
+    spi_trace_t *entry = &_trace[_trace_head & (SPI_TRACE_SIZE - 1)];
+
+    entry->start_us = _trace_start_us;
+    entry->end_us = timer_get_time32();
+    entry->len = job->len;
+    entry->prescaler = spi1_get_prescaler();
+    entry->source = job->source;
+    entry->flags = (_trace_cs ? SPI_TRACE_CS : 0) |
+                   ((job->flags & SPI_JOB_CS_RELEASE) ? SPI_TRACE_RELEASE : 0) |
+                   (job->error ? SPI_TRACE_ERROR : 0);
+    entry->tx[0] = job->tx[0];
+    entry->tx[1] = job->tx[job->len - 1];
+    entry->rx[0] = job->rx[0];
+    entry->rx[1] = job->rx[job->len - 1];
+    _trace_head++;
+}
+
+static void _spi1_cs_set(bool state)
+{   // job engine, CS changes in order with the transfers
+    if (state)
+    {
+        HW_SPI_SW_CS_DOWN;
+        _spi1_cs_state = SPI_CS_ACTIVE;
+    }
+    else
+    {
+        HW_SPI_SW_CS_UP;
+        _spi1_cs_state = SPI_CS_IDLE;
+    }
+}
+
+static void _job_start_next(void);
+
+static void _job_delay_done(void)
+{   // TIM3 IRQ
+    _job_active = NULL;
+    _job_start_next();
+}
+
+static bool _job_finish(spi_job_t *job)
+{   // IRQ context or IRQ disabled, returns true when delay after job runs
+    if (job->len > 0)
+    {
+        PROF_END(PROF_SPI);
+        if (_trace_on)
+            _trace_record(job);
+    }
+    if (job->flags & SPI_JOB_CS_RELEASE)
+        _spi1_cs_set(false);
+
+    if (job->done != NULL)
+    {   // callback from main loop, blocking callers just watch busy flag
+        job->next = NULL;
+        if (_done_tail == NULL)
+            _done_head = job;
+        else
+            _done_tail->next = job;
+        _done_tail = job;
+    }
+    job->busy = false;
+    event_set(EVENT_SPI);
+
+    if (job->delay_us > 0)
+    {
+        timer3_oneshot(job->delay_us, _job_delay_done);
+        return (true);
+    }
+    _job_active = NULL;
+    return (false);
+}
+
+static void _job_start_next(void)
+{   // IRQ context or IRQ disabled
+    spi_job_t *job;
+
+    while ((_job_active == NULL) && ((job = _job_head) != NULL))
+    {
+        _job_head = job->next;
+        if (_job_head == NULL)
+            _job_tail = NULL;
+
+        _job_active = job;
+        if (job->flags & SPI_JOB_CS_ASSERT)
+            _spi1_cs_set(true);
+
+        if (job->len > 0)
+        {
+            PROF_BEGIN(PROF_SPI);
+            if (_trace_on)
+            {
+                _trace_start_us = timer_get_time32();
+                _trace_cs = _spi1_cs_state;
+            }
+            if (HAL_SPI_TransmitReceive_DMA(&hspi1, job->tx, job->rx, job->len) == HAL_OK)
+                return; // HAL_SPI_TxRxCpltCallback() continues
+            job->error = true;
+        }
+        _job_finish(job); // CS only (or failed), next one in loop
+    }
+}
+
+bool spi1_submit(spi_job_t *job)
+{   // non-blocking, job memory must stay valid until busy is cleared
+    u32 primask;
+
+    if ((job->len > 0) && ((job->tx == NULL) || (job->rx == NULL)))
+        return (false);
+    if (_spi1_packed && ((job->len & 3) || (((u32)job->tx | (u32)job->rx) & 3)))
+        return (false);
+
+    job->next = NULL;
+    job->error = false;
+    job->source = _trace_source;
+    job->busy = true;
+    if (job->len > 0)
+    {
+        STATS_INC(STATS_SPI_JOBS);
+        STATS_ADD(STATS_SPI_BYTES, job->len);
+    }
+
+    primask = __get_PRIMASK();
+    __disable_irq();
+    if (_job_tail == NULL)
+        _job_head = job;
+    else
+        _job_tail->next = job;
+    _job_tail = job;
+    _job_start_next();
+    __set_PRIMASK(primask);
+
+    return (true);
+}
+
+bool spi1_busy(void)
+{
+    return (((_job_active != NULL) || (_job_head != NULL)) ? true : false);
+}
+
+void spi1_task(void)
+{   // runs done callbacks of finished jobs, call on EVENT_SPI
+    spi_job_t *job;
+
+    while (1)
+    {
+        __disable_irq();
+        job = _done_head;
+        if (job != NULL)
+        {
+            _done_head = job->next;
+            if (_done_head == NULL)
+                _done_tail = NULL;
+        }
+        __enable_irq();
+
+        if (job == NULL)
+            break;
+        job->done(job);
+    }
+}
+
+bool spi1_data_transfer(u8 *rx, u8 *tx, size_t len)
+{   // blocking transfer, queued behind already submitted jobs, false when
+    // nothing valid is in rx (rejected by spi1_submit() or DMA failed)
+    spi_job_t job = {0};
+
+    job.tx = tx;
+    job.rx = rx;
+    job.len = len;
+
+    if (! spi1_submit(&job))
+        return (false);
+
+    while (job.busy)
         ;
+    return (! job.error);
 }
 
 void spi1_flush(void)
@@ -158,7 +387,7 @@ void spi1_flush(void)
 
 u8 spi1_transfer(u8 c)
 {
-    u8 rx;
+    u8 rx = 0xFF; // idle MISO when the transfer did not run
 
     spi1_data_transfer(&rx, &c, 1);
     return rx;
@@ -170,17 +399,49 @@ bool spi1_cs_state(void)
 }
 
 void spi1_cs(bool state)
+{   // blocking callers, queued jobs finish first so CS never changes under
+    // a running transfer (jobs use SPI_JOB_CS_ASSERT/RELEASE instead)
+    while (spi1_busy())
+        ;
+    _spi1_cs_set(state);
+}
+
+u8 spi1_trace_source(u8 source)
+{   // transfers submitted from now on are traced as source
+    u8 prev = _trace_source;
+
+    _trace_source = source;
+    return (prev);
+}
+
+void spi1_trace_enable(bool enable)
+{   // enable starts with empty ring
+    if (enable && (! _trace_on))
+        _trace_head = 0;
+    _trace_on = enable;
+}
+
+bool spi1_trace_enabled(void)
 {
-    if (state)
-    {
-        HW_SPI_SW_CS_DOWN;
-        _spi1_cs_state = SPI_CS_ACTIVE;
-    }
-    else
-    {
-        HW_SPI_SW_CS_UP;
-        _spi1_cs_state = SPI_CS_IDLE;
-    }
+    return (_trace_on);
+}
+
+u32 spi1_trace_count(void)
+{
+    return ((_trace_head < SPI_TRACE_SIZE) ? _trace_head : SPI_TRACE_SIZE);
+}
+
+u32 spi1_trace_lost(void)
+{
+    return (_trace_head - spi1_trace_count());
+}
+
+bool spi1_trace_get(u32 index, spi_trace_t *entry)
+{   // stop trace before reading, entries are not locked
+    if (index >= spi1_trace_count())
+        return (false);
+    *entry = _trace[(_trace_head - spi1_trace_count() + index) & (SPI_TRACE_SIZE - 1)];
+    return (true);
 }
 
 void SPI1_IRQHandler(void)
@@ -203,9 +464,20 @@ void HAL_SPI_MspInit(SPI_HandleTypeDef* hspi)
 
 void HAL_SPI_TxRxCpltCallback(SPI_HandleTypeDef *hspi)
 {
-    if (hspi->Instance == SPI1) 
+    if ((hspi->Instance == SPI1) && (_job_active != NULL))
+    {
+        if (! _job_finish(_job_active))
+            _job_start_next(); // back-to-back, no main loop involvement
+    }
+}
+
+void HAL_SPI_ErrorCallback(SPI_HandleTypeDef *hspi)
+{
+    if ((hspi->Instance == SPI1) && (_job_active != NULL))
     {
-        _spi_transfer_done = true;
+        _job_active->error = true;
+        if (! _job_finish(_job_active))
+            _job_start_next();
     }
 }
 #endif // SPI1_ON
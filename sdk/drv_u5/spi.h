@@ -16,6 +16,54 @@
 #define SPI_CS_ACTIVE true
 #define SPI_CS_IDLE   false
 
+// asynchronous transfer descriptor flags
+#define SPI_JOB_CS_ASSERT   (0x01) // CS low before transfer
+#define SPI_JOB_CS_RELEASE  (0x02) // CS high after transfer
+
+// caller of transfers in SPI trace, see spi1_trace_source()
+typedef enum {
+    SPI_SOURCE_RAW = 0, // HEX lines and MUX frames from host
+    SPI_SOURCE_AUTO,    // AUTO response reading
+    SPI_SOURCE_CMD,     // commands (SPISCRIPT, SPISTREAM, ...)
+    SPI_SOURCE_L2,      // L2/L3 engine
+    SPI_SOURCES
+} spi_source_e;
+
+// SPI trace entry flags
+#define SPI_TRACE_CS        (0x01) // CS asserted during transfer
+#define SPI_TRACE_RELEASE   (0x02) // CS released after transfer
+#define SPI_TRACE_ERROR     (0x04) // DMA start or transfer failed
+
+#define SPI_TRACE_SIZE      (256)  // entries in ring, power of 2
+
+typedef struct {
+    u32 start_us;       // low 32 bits of timer_get_time()
+    u32 end_us;
+    u16 len;
+    u16 prescaler;
+    u8 source;          // spi_source_e
+    u8 flags;           // SPI_TRACE_xxx
+    u8 tx[2];           // first and last MOSI byte
+    u8 rx[2];           // first and last MISO byte
+} spi_trace_t;
+
+typedef struct spi_job_s spi_job_t;
+typedef void (*spi_job_done_t)(spi_job_t *job);
+
+struct spi_job_s {
+    u8 *tx;              // DMA accessible buffers, len bytes each
+    u8 *rx;
+    u16 len;             // 0 == CS control (and delay) only
+    u8 flags;            // SPI_JOB_xxx
+    u16 delay_us;        // pause after this job, before the next one starts
+    spi_job_done_t done; // called from spi1_task() in main loop, may be NULL
+    void *ctx;           // caller data
+    volatile bool busy;  // set by submit, cleared by completion IRQ
+    bool error;          // DMA start or transfer failed
+    u8 source;           // spi_source_e, set by submit
+    spi_job_t *next;     // queue link, owned by driver
+};
+
 #if SPI1_ON 
 
   void spi1_init (void);
@@ -23,11 +71,24 @@
   u32 spi1_get_frequency(void);
   bool spi1_set_frequency(u32 freq);
   bool spi1_set_prescaler(u32 value);
-  void spi1_data_transfer(u8 *rx, u8 *tx, size_t len);
+  void spi1_clock_update(void);
+  bool spi1_set_packed(bool packed);
+  bool spi1_packed(void);
+  bool spi1_data_transfer(u8 *rx, u8 *tx, size_t len); // false == rx not valid
+  bool spi1_submit(spi_job_t *job);
+  bool spi1_busy(void);
+  void spi1_task(void);
   void spi1_flush(void);
   u8 spi1_transfer(u8 c);
   bool spi1_cs_state(void);
-  void spi1_cs(bool state);
+  void spi1_cs(bool state); // waits for queued jobs
+
+  u8 spi1_trace_source(u8 source); // returns previous source
+  void spi1_trace_enable(bool enable);
+  bool spi1_trace_enabled(void);
+  u32 spi1_trace_count(void);      // entries in ring
+  u32 spi1_trace_lost(void);       // overwritten entries
+  bool spi1_trace_get(u32 index, spi_trace_t *entry); // 0 == oldest
 
 #endif // SPI1_ON
 
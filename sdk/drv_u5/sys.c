@@ -33,6 +33,13 @@ void sys_init(void)
 }
 
 
+// PLL1 runs from 4 MHz reference (HSE 8 MHz / 2 or HSI 16 MHz / 4),
+// VCO 384 MHz / 8 == 48 MHz or 320 MHz / 2 == 160 MHz
+#define SYS_PLL1_N_BASE     (96)
+#define SYS_PLL1_R_BASE     (8)
+#define SYS_PLL1_N_PERF     (80)
+#define SYS_PLL1_R_PERF     (2)
+
 void sys_clock_config(void)
 {
     LL_FLASH_SetLatency(LL_FLASH_LATENCY_3);
@@ -65,9 +72,9 @@ void sys_clock_config(void)
     LL_PWR_EnableBkUpAccess();
 
 #if (HW_HSE_ENABLED == 1)
-    LL_RCC_PLL1_ConfigDomain_SYS(LL_RCC_PLL1SOURCE_HSE, 2, 96, 8);
+    LL_RCC_PLL1_ConfigDomain_SYS(LL_RCC_PLL1SOURCE_HSE, 2, SYS_PLL1_N_BASE, SYS_PLL1_R_BASE);
 #else // (HW_HSE_ENABLED == 1)
-    LL_RCC_PLL1_ConfigDomain_SYS(LL_RCC_PLL1SOURCE_HSI, 4, 96, 8);
+    LL_RCC_PLL1_ConfigDomain_SYS(LL_RCC_PLL1SOURCE_HSI, 4, SYS_PLL1_N_BASE, SYS_PLL1_R_BASE);
 #endif // (HW_HSE_ENABLED != 1)
     LL_RCC_PLL1_EnableDomain_SYS();
     LL_RCC_SetPll1EPodPrescaler(LL_RCC_PLL1MBOOST_DIV_1);
@@ -88,7 +95,7 @@ void sys_clock_config(void)
     LL_RCC_SetAPB1Prescaler(LL_RCC_APB1_DIV_1);
     LL_RCC_SetAPB2Prescaler(LL_RCC_APB2_DIV_1);
     LL_RCC_SetAPB3Prescaler(LL_RCC_APB3_DIV_1);
-    LL_SetSystemCoreClock(48000000);
+    LL_SetSystemCoreClock(SYS_HCLK_BASE);
 
     LL_APB1_GRP1_EnableClock(LL_APB1_GRP1_PERIPH_CRS);
     LL_APB1_GRP1_ForceReset(LL_APB1_GRP1_PERIPH_CRS);
@@ -117,6 +124,69 @@ u32 sys_get_hclk(void)
     return (SystemCoreClock); // [Hz]
 }
 
+bool sys_set_hclk(u32 freq)
+{   // USB, RNG (HSI48 + CRS) and LPUART (HSI16) do not depend on SYSCLK,
+    // caller adjusts prescalers of timers and SPI afterwards
+    u32 n, r;
+
+    switch (freq)
+    {
+    case SYS_HCLK_BASE: n = SYS_PLL1_N_BASE; r = SYS_PLL1_R_BASE; break;
+    case SYS_HCLK_PERF: n = SYS_PLL1_N_PERF; r = SYS_PLL1_R_PERF; break;
+    default:
+        return (false);
+    }
+    if (freq == SystemCoreClock)
+        return (true);
+
+    if (freq > SystemCoreClock)
+    {   // voltage, booster (above 55 MHz) and wait states before clock rises
+        LL_PWR_SetRegulVoltageScaling(LL_PWR_REGU_VOLTAGE_SCALE1);
+        while (LL_PWR_IsActiveFlag_VOS() == 0)
+            ;
+        LL_PWR_EnableEPODBooster();
+        while (LL_PWR_IsActiveFlag_BOOST() == 0)
+            ;
+        LL_FLASH_SetLatency(LL_FLASH_LATENCY_4);
+        while (LL_FLASH_GetLatency() != LL_FLASH_LATENCY_4)
+            ;
+    }
+
+    // HSI16 keeps the core running while PLL1 is stopped
+    LL_RCC_HSI_Enable();
+    while (LL_RCC_HSI_IsReady() != 1)
+        ;
+    LL_RCC_SetSysClkSource(LL_RCC_SYS_CLKSOURCE_HSI);
+    while (LL_RCC_GetSysClkSource() != LL_RCC_SYS_CLKSOURCE_STATUS_HSI)
+        ;
+
+    LL_RCC_PLL1_Disable();
+    while (LL_RCC_PLL1_IsReady() != 0)
+        ;
+    LL_RCC_PLL1_SetN(n);
+    LL_RCC_PLL1_SetR(r);
+    LL_RCC_PLL1_Enable();
+    while (LL_RCC_PLL1_IsReady() != 1)
+        ;
+
+    LL_RCC_SetSysClkSource(LL_RCC_SYS_CLKSOURCE_PLL1);
+    while (LL_RCC_GetSysClkSource() != LL_RCC_SYS_CLKSOURCE_STATUS_PLL1)
+        ;
+    LL_SetSystemCoreClock(freq);
+
+    if (freq == SYS_HCLK_BASE)
+    {   // back to boot settings
+        LL_FLASH_SetLatency(LL_FLASH_LATENCY_3);
+        while (LL_FLASH_GetLatency() != LL_FLASH_LATENCY_3)
+            ;
+        LL_PWR_DisableEPODBooster();
+        LL_PWR_SetRegulVoltageScaling(LL_PWR_REGU_VOLTAGE_SCALE3);
+        while (LL_PWR_IsActiveFlag_VOS() == 0)
+            ;
+    }
+    return (true);
+}
+
 u32 sys_flash_size(void)
 {
     return (LL_GetFlashSize());
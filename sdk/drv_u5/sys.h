@@ -4,13 +4,16 @@
 #include "common.h"
 
 #define SYS_HCLK_MIN 40000000
-#define SYS_HCLK_MAX 80000000
+#define SYS_HCLK_MAX 160000000
+
+#define SYS_HCLK_BASE 48000000  // VOS3, boot clock
+#define SYS_HCLK_PERF 160000000 // VOS1 with EPOD booster
 
 void sys_init(void);
 void sys_clock_config(void);
 void sys_usb_clock_config(void);
 u32  sys_get_hclk(void); // [Hz]
-bool sys_set_hclk(u32 freq); // [Hz]
+bool sys_set_hclk(u32 freq); // [Hz], SYS_HCLK_BASE or SYS_HCLK_PERF
 u32  sys_flash_size(void);
 
 
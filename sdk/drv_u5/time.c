@@ -1,19 +1,41 @@
 #include "platform_setup.h"
 #include "hardware.h"
 #include "time.h"
+#include "event.h"
 
-static u64 timer_ms = 0;
+#if TIMER2_ON 
 
+// TIM2 runs free at 1 MHz over the whole 32 bit range, upper 32 bits are
+// counted on read when the counter is lower than at previous read. Reads
+// come at least every 100 ms (LED tick wake up), update IRQ every 71 minutes
+// keeps it right without them. CC1 wakes the main loop at the next deadline.
+static u32 _timer_last = 0;
+static u32 _timer_high = 0;
 
-#if TIMER2_ON 
+static inline timer_time_t _get_timer_time(void)
+{   // IRQs disabled
+    u32 t = TIM2->CNT;
+
+    if (t < _timer_last)
+        _timer_high++;
+    _timer_last = t;
+    return (((timer_time_t)_timer_high << 32) | t);
+}
 
 void TIM2_IRQHandler(void)
 {
-    // Check whether update interrupt is pending
-    if (TIM2->SR & TIM_SR_UIF)
-    {   // Clear the update interrupt flag
-        TIM2->SR &= ~(TIM_SR_UIF);
-        timer_ms++;
+    u32 sr = TIM2->SR;
+
+    if (sr & TIM_SR_UIF)
+    {   // counter wrapped
+        TIM2->SR = ~TIM_SR_UIF;
+        (void)_get_timer_time();
+    }
+    if (sr & TIM_SR_CC1IF)
+    {   // deadline, one wake up per timer_wake_at()
+        TIM2->SR = ~TIM_SR_CC1IF;
+        TIM2->DIER &= ~TIM_DIER_CC1IE;
+        event_set(EVENT_TIMER);
     }
 }
 
@@ -26,34 +48,22 @@ void timer_init(void)
     RCC->APB1RSTR1 |= RCC_APB1RSTR1_TIM2RST;
     RCC->APB1RSTR1 &= ~RCC_APB1RSTR1_TIM2RST;
 
-    // Set the Autoreload value
-    TIM2->ARR = 1000;
+    // Set the Autoreload value, free running 32 bit
+    TIM2->ARR = 0xFFFFFFFFUL;
 
     // Set the Prescaler value
     TIM2->PSC = (TIM2CLK/1000000)-1; // [us]
 
+    // Generate an update event to reload the Prescaler value immediatly
+    TIM2->EGR = TIM_EGR_UG;
+    TIM2->SR = 0; // prescaler reload is not a wrap
+
     TIM2->CR1 = TIM_CR1_CEN; // Counter enable
 
-    TIM2->DIER |= TIM_DIER_UIE; // Enable update interrupt
+    TIM2->DIER |= TIM_DIER_UIE; // wrap, CC1IE only while a deadline waits
 
     NVIC_SetPriority(TIM2_IRQn, 0);
     NVIC_EnableIRQ(TIM2_IRQn);
-
-    // Generate an update event to reload the Prescaler value immediatly
-    TIM2->EGR = TIM_EGR_UG;    //1
-}
-
-static inline timer_time_t _get_timer_time(void)
-{
-    u32 t;
-
-    t = TIM2->CNT;
-    if (t < 100)
-    {   // there is small probability there is pending IRQ
-        if (TIM2->SR & TIM_SR_UIF)
-            t += 1000; // fix missing IRQ, which will execute later
-    }
-    return (timer_ms * (u64)1000 + t);
 }
 
 timer_time_t timer_get_time(void)
@@ -69,12 +79,62 @@ timer_time_t timer_get_time(void)
 
 timer_time_t timer_get_time_irq(void)
 {   // may be called from IRQ (or when already disabled IRQ)
-    // be sure no any timer IRQ appears here
-    TIM2_IRQHandler(); // force update ms timer
-    return (_get_timer_time());
+    u32 primask = __get_PRIMASK();
+    timer_time_t t;
+
+    __disable_irq();
+    t = _get_timer_time();
+    __set_PRIMASK(primask);
+
+    return (t);
+}
+
+void timer_wake_at(timer_time_t time)
+{   // EVENT_TIMER at time, replaces previous deadline; at most 32 bit range ahead
+    u32 primask = __get_PRIMASK();
+    timer_time_t now;
+
+    __disable_irq();
+    now = _get_timer_time();
+    if (time > now + 0x7FFFFFFFUL)
+        time = now + 0x7FFFFFFFUL;
+
+    TIM2->CCR1 = (u32)time;
+    TIM2->SR = ~TIM_SR_CC1IF;
+    TIM2->DIER |= TIM_DIER_CC1IE;
+
+    // counter may have passed CCR1 while it was written
+    if ((s32)((u32)time - TIM2->CNT) <= 0)
+    {
+        TIM2->DIER &= ~TIM_DIER_CC1IE;
+        event_set(EVENT_TIMER);
+    }
+    __set_PRIMASK(primask);
 }
 #endif // TIMER2_ON 
 
+static void _timer_set_prescaler(TIM_TypeDef *tim, u32 clk)
+{   // new prescaler at once, counter keeps its value and no update IRQ
+    u32 cnt = tim->CNT;
+
+    tim->PSC = (clk/1000000)-1; // [us]
+    tim->CR1 |= TIM_CR1_URS;    // UG does not set UIF
+    tim->EGR = TIM_EGR_UG;
+    tim->CNT = cnt;
+    tim->CR1 &= ~TIM_CR1_URS;
+}
+
+void timer_clock_update(u32 clk)
+{   // after SYSCLK change, clk == new TIM2/TIM3 kernel clock [Hz];
+    // no TIM3 one-shot may run, update event ends it
+    __disable_irq();
+#if TIMER2_ON
+    _timer_set_prescaler(TIM2, clk);
+#endif
+    _timer_set_prescaler(TIM3, clk);
+    __enable_irq();
+}
+
 void time_delay_ms(u32 tm)
 {
     tm *= TIMER_MS;
@@ -95,6 +155,26 @@ void time_delay_us (u32 tm)
         ;
 }
 
+static void (*_timer3_callback)(void) = NULL;
+
+void TIM3_IRQHandler(void)
+{
+    if (TIM3->SR & TIM_SR_UIF)
+    {
+        TIM3->SR &= ~(TIM_SR_UIF);
+        if (_timer3_callback != NULL)
+            _timer3_callback();
+    }
+}
+
+void timer3_oneshot(u32 us, void (*callback)(void))
+{   // callback is called from TIM3 IRQ after us microseconds (1 .. 65535)
+    _timer3_callback = callback;
+    TIM3->ARR = (us > UINT16_MAX) ? UINT16_MAX : ((us > 0) ? us : 1);
+    TIM3->CNT = 0;
+    TIM3->CR1 |= TIM_CR1_CEN; // one pulse mode stops the counter on update
+}
+
 void timer3_init(void)
 {
     // enable clock
@@ -115,5 +195,10 @@ void timer3_init(void)
 
     // Generate an update event to reload the Prescaler value immediatly
     TIM3->EGR = TIM_EGR_UG;
+    TIM3->SR = 0; // update event of prescaler reload is not a timeout
+
+    TIM3->DIER |= TIM_DIER_UIE; // used by timer3_oneshot()
+    NVIC_SetPriority(TIM3_IRQn, DEF_PRIO);
+    NVIC_EnableIRQ(TIM3_IRQn);
 }
 
@@ -15,12 +15,18 @@ typedef u64 timer_time_t;
 void timer_init(void);
 timer_time_t timer_get_time(void);
 timer_time_t timer_get_time_irq(void);
+// low 32 bits of timer_get_time(), wrap in 71 minutes, no IRQ lock
+static inline u32 timer_get_time32(void) { return (TIM2->CNT); }
+void timer_wake_at(timer_time_t time);
+
+void timer_clock_update(u32 clk);
 
 void timer3_init(void);
 static inline void timer3_run(void) { TIM3->CR1 |= TIM_CR1_CEN; }
 static inline void timer3_stop(void)  { TIM3->CR1 &= ~TIM_CR1_CEN; }
 static inline void timer3_reset(void) { TIM3->CNT = 0; }
 static inline u32 timer3_get_time(void) { return (TIM3->CNT); }
+void timer3_oneshot(u32 us, void (*callback)(void));
 
 void timer5_free_run(void);
 #define timer5_get_time() (TIM5->CNT)
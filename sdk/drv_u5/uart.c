@@ -3,6 +3,7 @@
 #include "irq.h"
 #include "gpio.h"
 #include "os.h"
+#include "event.h"
 
 #include "stm32u5xx_ll_lpuart.h"
 // #include "stm32u5xx_ll_usart.h"
@@ -118,6 +119,7 @@ void LPUART1_IRQHandler(void)
     if (status & USART_ISR_RXNE_RXFNE)
     {
         _u1_rx(LPUART1->RDR);
+        event_set(EVENT_UART);
     }
     // (Optional) Handle errors if needed
     if (status & (USART_ISR_ORE | USART_ISR_FE | USART_ISR_PE))
@@ -138,7 +140,11 @@ void uart1_init(u32 baudrate)
     u1.rx_buf = u1_rx_buf;
     u1.tx_buf = u1_tx_buf;
 
-    LL_RCC_SetLPUARTClockSource(LL_RCC_LPUART1_CLKSOURCE_PCLK3);
+    // HSI16 kernel clock, baud rate does not follow SYSCLK profile changes
+    LL_RCC_HSI_Enable();
+    while (LL_RCC_HSI_IsReady() != 1)
+        ;
+    LL_RCC_SetLPUARTClockSource(LL_RCC_LPUART1_CLKSOURCE_HSI);
 
     LL_APB3_GRP1_EnableClock(LL_APB3_GRP1_PERIPH_LPUART1);
 
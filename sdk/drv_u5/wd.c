@@ -2,6 +2,7 @@
 #include "gpreg.h"
 
 #include "wd.h"
+#include "stats.h"
 
 #if (MAIN_DEBUG == 1)
   #warning "WD disabled" 
@@ -74,6 +75,7 @@ void wd_disable (void)
 
 void wd_feed (void)
 {
+	STATS_INC(STATS_WD_FEEDS);
 	if (_wd_clr_enable == true)
 	{
 		IWDG->KR=IWDG_KEY_RELOAD;
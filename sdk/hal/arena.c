@@ -0,0 +1,62 @@
+#include "arena.h"
+
+static u64 _arena[ARENA_SIZE / sizeof(u64)];
+static arena_mode_e _mode = ARENA_CONSOLE;
+static u32 _used = 0;
+static u32 _peak = 0;
+
+static const char *_ARENA_NAME[ARENA_MODES] = {
+    "CONSOLE",
+    "TLS",
+    "SPISTREAM",
+    "USBBENCH",
+};
+
+bool arena_enter(arena_mode_e mode)
+{   // switch is explicit, previous owner must leave first
+    if ((mode == ARENA_CONSOLE) || (mode >= ARENA_MODES) || (_mode != ARENA_CONSOLE))
+        return (false);
+    _mode = mode;
+    _used = 0;
+    return (true);
+}
+
+void arena_leave(arena_mode_e mode)
+{
+    if (_mode != mode)
+        return;
+    _mode = ARENA_CONSOLE;
+    _used = 0;
+}
+
+void *arena_alloc(arena_mode_e mode, u32 size)
+{
+    void *ptr;
+
+    if ((mode != _mode) || (mode == ARENA_CONSOLE))
+        return (NULL);
+    size = (size + 7) & ~7UL;
+    if (size > sizeof(_arena) - _used)
+        return (NULL);
+
+    ptr = (u8 *)_arena + _used;
+    _used += size;
+    if (_used > _peak)
+        _peak = _used;
+    return (ptr);
+}
+
+arena_mode_e arena_mode(void)
+{
+    return (_mode);
+}
+
+const char *arena_mode_name(arena_mode_e mode)
+{
+    return ((mode < ARENA_MODES) ? _ARENA_NAME[mode] : "?");
+}
+
+u32 arena_peak(void)
+{
+    return (_peak);
+}
@@ -0,0 +1,35 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include "type.h"
+
+// One RAM block for the large buffers of whichever mode owns the CDC data
+// link: TLS session RX ring, SPISTREAM/SPIBENCH blocks or USBBENCH buffers.
+// Only one mode runs at a time, the owner enters before it allocates and
+// leaves when done; allocations are bump style and all end with leave.
+// Console buffers stay static, console is served in every mode.
+
+#ifndef ARENA_SIZE
+  #define ARENA_SIZE    (32*1024)   // TLS RX ring, largest user
+#endif
+
+typedef enum {
+    ARENA_CONSOLE = 0,  // no owner, nothing allocated
+    ARENA_TLS,
+    ARENA_SPI_STREAM,
+    ARENA_USB_BENCH,
+    ARENA_MODES
+} arena_mode_e;
+
+// false when other mode owns the arena
+bool arena_enter(arena_mode_e mode);
+// back to console, buffers of the mode are gone
+void arena_leave(arena_mode_e mode);
+// 8 byte aligned, NULL when mode does not own arena or it is full
+void *arena_alloc(arena_mode_e mode, u32 size);
+
+arena_mode_e arena_mode(void);
+const char *arena_mode_name(arena_mode_e mode);
+u32 arena_peak(void);
+
+#endif // ! ARENA_H
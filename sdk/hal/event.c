@@ -0,0 +1,62 @@
+#include "platform_setup.h"
+#include "event.h"
+
+static volatile u32 _event_pending = 0;
+
+void event_set(u32 mask)
+{   // may be called from any IRQ priority
+    u32 primask = __get_PRIMASK();
+
+    __disable_irq();
+    _event_pending |= mask;
+    __set_PRIMASK(primask);
+}
+
+u32 event_take(void)
+{   // get and clear all pending flags
+    u32 mask;
+
+    __disable_irq();
+    mask = _event_pending;
+    _event_pending = 0;
+    __enable_irq();
+
+    return (mask);
+}
+
+u32 event_take_mask(u32 mask)
+{   // get and clear flags in mask only, used by blocking loops outside _main_task
+    u32 taken;
+
+    __disable_irq();
+    taken = _event_pending & mask;
+    _event_pending &= ~mask;
+    __enable_irq();
+
+    return (taken);
+}
+
+bool event_pending(u32 mask)
+{
+    return ((_event_pending & mask) ? true : false);
+}
+
+void event_wait(void)
+{   // sleep until any event is pending
+    __disable_irq();
+    if (_event_pending == 0)
+    {
+        __WFI(); // pending IRQ wakes the core even with IRQs masked
+    }
+    __enable_irq(); // IRQ handler runs here
+}
+
+void event_wait_mask(u32 mask)
+{   // sleep until an event in mask is pending, others may stay pending meanwhile
+    __disable_irq();
+    if ((_event_pending & mask) == 0)
+    {
+        __WFI();
+    }
+    __enable_irq();
+}
@@ -0,0 +1,21 @@
+
+#ifndef EVENT_H
+#define EVENT_H
+
+#include "type.h"
+
+// pending work flags, set by IRQ handlers and consumed by the main loop
+#define EVENT_USB       (1UL << 0) // USB IRQ (transfer done, bus state change)
+#define EVENT_TIMER     (1UL << 1) // timer tick
+#define EVENT_SPI       (1UL << 2) // SPI DMA transfer completed
+#define EVENT_UART      (1UL << 3) // UART RX data
+#define EVENT_GPO       (1UL << 4) // target GPO edge, response ready
+
+void event_set(u32 mask);
+u32  event_take(void);
+u32  event_take_mask(u32 mask); // others stay pending for the main loop
+bool event_pending(u32 mask);
+void event_wait(void);
+void event_wait_mask(u32 mask);
+
+#endif // ! EVENT_H
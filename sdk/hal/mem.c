@@ -0,0 +1,179 @@
+#include "platform_setup.h"
+#include "mem.h"
+
+#define MEM_PAINT           0xC5C5C5C5UL
+#define MEM_PAINT_MARGIN    (64) // [B] below SP, frame of painting function
+
+typedef struct {
+    u32 size;
+    u32 reserved;       // keeps 8 byte alignment of the block
+} mem_header_t;
+
+// linker script symbols, only addresses are meaningful
+extern u32 _sidata, _sdata, _edata, _sbss, _ebss, _estack;
+extern u32 _sramfunc, _eramfunc, _ssram4, _esram4;
+extern u32 _Min_Stack_Size;
+extern u8 end;
+
+void *_sbrk(int incr);
+void *__real_malloc(size_t size);
+void __real_free(void *ptr);
+void *__real_realloc(void *ptr, size_t size);
+
+static u32 _heap_used = 0;
+static u32 _heap_peak = 0;
+static u32 _heap_blocks = 0;
+static u32 _heap_fails = 0;
+static u32 _heap_mark = 0;      // in use at mem_mark()
+static u32 _heap_mark_peak = 0;
+static u32 _stack_peak = 0;     // before last repaint
+
+static inline u32 *_stack_limit(void)
+{
+    return ((u32 *)((u32)&_estack - (u32)&_Min_Stack_Size));
+}
+
+static void _stack_paint(void)
+{   // top down from SP; IRQ frames below SP end before painting continues
+    u32 *p = (u32 *)(__get_MSP() - MEM_PAINT_MARGIN);
+    u32 *limit = _stack_limit();
+
+    while (p > limit)
+        *--p = MEM_PAINT;
+}
+
+static u32 _stack_used(void)
+{   // first word overwritten since painting, from the bottom
+    const u32 *p = _stack_limit();
+    const u32 *top = (const u32 *)__get_MSP();
+
+    while ((p < top) && (*p == MEM_PAINT))
+        p++;
+    return ((u32)&_estack - (u32)p);
+}
+
+static void _heap_add(u32 size)
+{
+    _heap_used += size;
+    if (_heap_used > _heap_peak)
+        _heap_peak = _heap_used;
+    if (_heap_used > _heap_mark_peak)
+        _heap_mark_peak = _heap_used;
+}
+
+void *__wrap_malloc(size_t size)
+{
+    mem_header_t *header = __real_malloc(sizeof(mem_header_t) + size);
+
+    if (header == NULL)
+    {
+        _heap_fails++;
+        return (NULL);
+    }
+    header->size = size;
+    _heap_blocks++;
+    _heap_add(size);
+    return (header + 1);
+}
+
+void __wrap_free(void *ptr)
+{
+    mem_header_t *header;
+
+    if (ptr == NULL)
+        return;
+    header = (mem_header_t *)ptr - 1;
+    _heap_used -= header->size;
+    _heap_blocks--;
+    __real_free(header);
+}
+
+void *__wrap_realloc(void *ptr, size_t size)
+{
+    mem_header_t *header;
+    u32 old;
+
+    if (ptr == NULL)
+        return (__wrap_malloc(size));
+    if (size == 0)
+    {
+        __wrap_free(ptr);
+        return (NULL);
+    }
+
+    header = (mem_header_t *)ptr - 1;
+    old = header->size;
+    header = __real_realloc(header, sizeof(mem_header_t) + size);
+    if (header == NULL)
+    {   // old block stays valid
+        _heap_fails++;
+        return (NULL);
+    }
+    header->size = size;
+    _heap_used -= old;
+    _heap_add(size);
+    return (header + 1);
+}
+
+void *__wrap_calloc(size_t count, size_t size)
+{
+    void *ptr;
+
+    if ((size != 0) && (count > SIZE_MAX / size))
+    {
+        _heap_fails++;
+        return (NULL);
+    }
+    ptr = __wrap_malloc(count * size);
+    if (ptr != NULL)
+        memset(ptr, 0, count * size);
+    return (ptr);
+}
+
+void mem_init(void)
+{
+    _stack_paint();
+}
+
+void mem_reset(void)
+{
+    _heap_peak = _heap_used;
+    _heap_fails = 0;
+    _stack_peak = 0;
+    _stack_paint();
+}
+
+void mem_get_info(mem_info_t *info)
+{
+    u32 stack = _stack_used();
+
+    info->ramfunc = (u32)&_eramfunc - (u32)&_sramfunc;
+    info->data = (u32)&_edata - (u32)&_sdata;
+    info->flash = (u32)&_sidata - FLASH_BASE + info->data;
+    info->bss = (u32)&_ebss - (u32)&_sbss;
+    info->sram4 = (u32)&_esram4 - (u32)&_ssram4;
+    info->heap = _heap_used;
+    info->heap_peak = _heap_peak;
+    info->heap_arena = (u32)_sbrk(0) - (u32)&end;
+    info->heap_blocks = _heap_blocks;
+    info->heap_fails = _heap_fails;
+    info->stack = (u32)&_Min_Stack_Size;
+    info->stack_peak = (stack > _stack_peak) ? stack : _stack_peak;
+}
+
+void mem_mark(void)
+{   // repaint loses the global peak, keep it first
+    u32 stack = _stack_used();
+
+    if (stack > _stack_peak)
+        _stack_peak = stack;
+    _stack_paint();
+    _heap_mark = _heap_used;
+    _heap_mark_peak = _heap_used;
+}
+
+void mem_since_mark(mem_peak_t *peak)
+{
+    peak->stack = _stack_used();
+    peak->heap = _heap_mark_peak - _heap_mark;
+}
@@ -0,0 +1,43 @@
+#ifndef MEM_H
+#define MEM_H
+
+#include "type.h"
+
+// RAM use figures for sizing buffers. Stack reserve (_Min_Stack_Size under
+// _estack) is painted with a pattern, its peak is the lowest overwritten
+// word. malloc/free/realloc/calloc are wrapped by the linker (--wrap), each
+// block carries an 8 byte header with its size. Blocks allocated inside
+// libc (_malloc_r, e.g. stdio buffers) are not counted and must be freed by
+// libc.
+
+typedef struct {
+    u32 flash;          // .text, .rodata, .ramfunc and .data image
+    u32 ramfunc;        // code copied to SRAM
+    u32 data;           // incl. HAL .RamFunc
+    u32 bss;
+    u32 sram4;          // SRAM4_BSS buffers
+    u32 heap;           // requested bytes in use
+    u32 heap_peak;
+    u32 heap_arena;     // taken from sbrk by libc
+    u32 heap_blocks;
+    u32 heap_fails;     // allocations returning NULL
+    u32 stack;          // reserve size
+    u32 stack_peak;     // deepest use from _estack
+} mem_info_t;
+
+typedef struct {
+    u32 stack;          // deepest use from _estack since mem_mark()
+    u32 heap;           // heap peak above heap in use at mem_mark()
+} mem_peak_t;
+
+// paints stack reserve below current SP, call first in main()
+void mem_init(void);
+// global peaks start again from current use
+void mem_reset(void);
+void mem_get_info(mem_info_t *info);
+
+// measured section, e.g. one command; repaints stack below SP
+void mem_mark(void);
+void mem_since_mark(mem_peak_t *peak);
+
+#endif // ! MEM_H
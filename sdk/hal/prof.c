@@ -0,0 +1,51 @@
+#include "prof.h"
+
+#ifndef BENCH_HOST
+#include "platform_setup.h"
+
+void prof_cycles_init(void)
+{   // cycle counter runs without debugger too once trace is enabled
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+#endif // ! BENCH_HOST
+
+#if PROF_ENABLE
+
+prof_zone_t prof_zone[PROF_ZONES];
+
+static const char *_PROF_NAME[PROF_ZONES] = {
+    "MAIN",
+    "USB",
+    "TTY",
+    "SPI",
+    "L2",
+    "L3",
+    "L3SESSION",
+    "RBWRITE",
+    "RBREAD",
+    "TLSCONNECT",
+    "TLSWRITE",
+};
+
+void prof_init(void)
+{   // after prof_cycles_init()
+    prof_reset();
+}
+
+void prof_reset(void)
+{
+    int i;
+
+    memset(prof_zone, 0, sizeof(prof_zone));
+    for (i = 0; i < PROF_ZONES; i++)
+        prof_zone[i].min = (u32)-1;
+}
+
+const char *prof_name(prof_zone_e zone)
+{
+    return ((zone < PROF_ZONES) ? _PROF_NAME[zone] : "?");
+}
+
+#endif // PROF_ENABLE
@@ -0,0 +1,76 @@
+#ifndef PROF_H
+#define PROF_H
+
+#include "type.h"
+
+// Cycle profiling on DWT CYCCNT: PROF_BEGIN/PROF_END around a zone count
+// calls and min/avg/max cycles. Zones do not nest into themselves, other
+// zones may run inside (USB task in main loop) and IRQs are included.
+// Built with make PROF=1, otherwise the macros are empty.
+
+#ifndef PROF_ENABLE
+  #define PROF_ENABLE 0
+#endif
+
+// starts DWT CYCCNT once at init, also with PROF=0 (BENCH, REPLAY)
+void prof_cycles_init(void);
+
+typedef enum {
+    PROF_MAIN_LOOP = 0, // one pass of pending events, without sleep
+    PROF_USB_TASK,      // usb_device_task()
+    PROF_TTY_PARSER,    // HEX line or command
+    PROF_SPI,           // SPI1 job, start to completion IRQ
+    PROF_L2,            // L2 command transaction
+    PROF_L3,            // L3 command incl. encryption
+    PROF_L3_SESSION,    // L3 handshake (X25519, HKDF)
+    PROF_RB_WRITE,      // TLS RX ring buffer
+    PROF_RB_READ,
+    PROF_TLS_CONNECT,   // one wolfSSL_connect() slice of handshake
+    PROF_TLS_WRITE,     // wolfSSL_write()
+    PROF_ZONES
+} prof_zone_e;
+
+typedef struct {
+    u32 start;          // CYCCNT at PROF_BEGIN
+    u32 calls;
+    u32 min;
+    u32 max;
+    u64 sum;
+} prof_zone_t;
+
+#if PROF_ENABLE
+
+  #include "platform_setup.h"
+
+  extern prof_zone_t prof_zone[PROF_ZONES];
+
+  #define PROF_BEGIN(zone)  (prof_zone[zone].start = DWT->CYCCNT)
+  #define PROF_END(zone)    prof_end(&prof_zone[zone])
+
+  static inline void prof_end(prof_zone_t *zone)
+  {
+      u32 cycles = DWT->CYCCNT - zone->start;
+
+      zone->calls++;
+      zone->sum += cycles;
+      if (cycles < zone->min)
+          zone->min = cycles;
+      if (cycles > zone->max)
+          zone->max = cycles;
+  }
+
+  void prof_init(void);
+  void prof_reset(void);
+  const char *prof_name(prof_zone_e zone);
+
+#else // PROF_ENABLE
+
+  #define PROF_BEGIN(zone)
+  #define PROF_END(zone)
+
+  #define prof_init()
+  #define prof_reset()
+
+#endif // ! PROF_ENABLE
+
+#endif // ! PROF_H
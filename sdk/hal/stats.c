@@ -0,0 +1,45 @@
+#include "common.h"
+#include "stats.h"
+#include "time.h"
+
+u32 stats_counter[STATS_COUNTERS];
+
+static timer_time_t _stats_start = 0;
+
+static const char *_STATS_NAME[STATS_COUNTERS] = {
+    "USB_RX_BYTES",
+    "USB_RX_PACKETS",
+    "USB_TX_BYTES",
+    "USB_TX_PACKETS",
+    "USB_TX_BUSY",
+    "USB_RX_OVERFLOW",
+    "TLS_RX_OVERFLOW",
+    "TLS_RX_PEAK",
+    "TTY_LINES",
+    "HEX_LINES",
+    "CMD_ERRORS",
+    "SPI_JOBS",
+    "SPI_BYTES",
+    "AUTO_READS",
+    "AUTO_EMPTY",
+    "TLS_OK",
+    "TLS_FAILED",
+    "TLS_MS",
+    "WD_FEEDS",
+};
+
+void stats_reset(void)
+{
+    memset(stats_counter, 0, sizeof(stats_counter));
+    _stats_start = timer_get_time();
+}
+
+u32 stats_ms(void)
+{
+    return ((u32)((timer_get_time() - _stats_start) / TIMER_MS));
+}
+
+const char *stats_name(stats_counter_e counter)
+{
+    return ((counter < STATS_COUNTERS) ? _STATS_NAME[counter] : "?");
+}
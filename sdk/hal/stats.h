@@ -0,0 +1,51 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include "type.h"
+
+// Runtime counters for fleet monitoring (STATS command). Each counter is
+// written from one context only (USB task, main loop or SPI submit), so
+// plain increments are enough; _PEAK entries keep the highest value seen.
+// STATS=0 clears all, the reset cause and time since clear come with them.
+
+typedef enum {
+    STATS_USB_RX_BYTES = 0,     // both CDC ports
+    STATS_USB_RX_PACKETS,       // reads delivered to RX handlers
+    STATS_USB_TX_BYTES,
+    STATS_USB_TX_PACKETS,       // writes taken by the stack
+    STATS_USB_TX_BUSY,          // writes refused, caller retries
+    STATS_USB_RX_OVERFLOW,      // console stream buffer full, rest dropped
+    STATS_TLS_RX_OVERFLOW,      // bytes dropped on full TLS RX ring
+    STATS_TLS_RX_PEAK,          // TLS RX ring high water mark [B]
+    STATS_TTY_LINES,            // console lines parsed
+    STATS_HEX_LINES,            // of them raw HEX lines sent to SPI
+    STATS_CMD_ERRORS,           // unknown or failed commands
+    STATS_SPI_JOBS,             // SPI1 transfers
+    STATS_SPI_BYTES,
+    STATS_AUTO_READS,           // AUTO reads with a response
+    STATS_AUTO_EMPTY,           // AUTO reads without response
+    STATS_TLS_OK,               // handshakes completed
+    STATS_TLS_FAILED,
+    STATS_TLS_MS,               // time of completed handshakes together
+    STATS_WD_FEEDS,
+    STATS_COUNTERS
+} stats_counter_e;
+
+extern u32 stats_counter[STATS_COUNTERS];
+
+#define STATS_INC(counter)          (stats_counter[counter]++)
+#define STATS_ADD(counter, n)       (stats_counter[counter] += (n))
+#define STATS_PEAK(counter, value)  stats_peak(&stats_counter[counter], (value))
+
+static inline void stats_peak(u32 *counter, u32 value)
+{
+    if (value > *counter)
+        *counter = value;
+}
+
+void stats_reset(void);
+// time since power on or STATS=0
+u32 stats_ms(void);
+const char *stats_name(stats_counter_e counter);
+
+#endif // ! STATS_H
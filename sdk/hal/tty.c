@@ -1,5 +1,7 @@
 #include "common.h"
 #include "tty.h"
+#include "crc16.h"
+#include "stats.h"
 #include "usb_device.h"
 #include "tls_pqc.h"
 
@@ -31,29 +33,98 @@ static char _usb_stream_buffer[USB_TTY_BUFFER_SIZE];
 static size_t _usb_stream_wr_ptr = 0;
 static size_t _usb_stream_rd_ptr = 0;
 
-static void _usb_send_data(u8 *data, u16 len)
+typedef enum {
+    _MUX_RX_SYNC = 0,
+    _MUX_RX_CHANNEL,
+    _MUX_RX_LEN_LSB,
+    _MUX_RX_LEN_MSB,
+    _MUX_RX_DATA,
+    _MUX_RX_CRC_LSB,
+    _MUX_RX_CRC_MSB,
+} mux_rx_state_e;
+
+typedef struct {
+    mux_rx_state_e state;
+    u8 hdr[TTY_FRAME_HDR_SIZE];
+    u16 len;
+    u16 pos;
+    u16 crc;
+    u8 data[TTY_FRAME_MAX];
+} mux_rx_t;
+
+static bool _mux_enabled = false;
+static bool _mux_next = false;
+static u32 _mux_errors = 0;
+static mux_rx_t _mux_rx;
+static u8 _mux_tx_buf[TTY_FRAME_HDR_SIZE + TTY_FRAME_MAX + TTY_FRAME_CRC_SIZE];
+static tty_channel_rx_t _mux_rx_handler[TTY_CH_COUNT];
+
+int _write (int fd, const void *buf, size_t count);
+
+static bool _usb_send_data(u8 *data, u16 len)
 {
-#define USB_RETRY_NUM (100)
+#define USB_TX_TIMEOUT (100*OS_TIMER_MS)
 
     int limit;
+    os_timer_t start;
 
     if (! usb_device_connected())
-        return;
+        return (false);
 
-    limit = USB_RETRY_NUM;
+    start = os_timer_get_time();
     while (usb_cdc_tx(data, len) == USB_RESULT_BUSY)
-    {
-        if (--limit == 0)
-            return;
-        OS_DELAY(1);
+    {   // every call advances the write state machine, don't sleep 1ms between
+        if ((os_timer_get_time() - start) > USB_TX_TIMEOUT)
+            return (false);
     }
     limit = 10;
     while (usb_cdc_tx_busy())
     {
         if (--limit == 0)
-            return;
+            break;
         OS_DELAY(1);
     }
+    return (true);
+}
+
+size_t tty_put_frame(tty_channel_e ch, const u8 *data, size_t len)
+{   // returns number of payload bytes sent
+    size_t sent = 0;
+    size_t l;
+    u16 crc;
+
+    if (! _mux_enabled)
+    {   // plain text mode, send data as they are
+        if ((ch == TTY_CH_CONSOLE) || (ch == TTY_CH_LOG))
+        {
+            _write(1, data, len);
+            return (len);
+        }
+        return (_usb_send_data((u8 *)data, len) ? len : 0);
+    }
+
+    do
+    {   // split to frames, one USB write per frame
+        l = len - sent;
+        if (l > TTY_FRAME_MAX)
+            l = TTY_FRAME_MAX;
+
+        _mux_tx_buf[0] = TTY_FRAME_SYNC;
+        _mux_tx_buf[1] = ch;
+        _mux_tx_buf[2] = l & 0xFF;
+        _mux_tx_buf[3] = l >> 8;
+        memcpy(&_mux_tx_buf[TTY_FRAME_HDR_SIZE], &data[sent], l);
+        crc = crc16(&_mux_tx_buf[1], TTY_FRAME_HDR_SIZE - 1 + l);
+        _mux_tx_buf[TTY_FRAME_HDR_SIZE + l] = crc & 0xFF;
+        _mux_tx_buf[TTY_FRAME_HDR_SIZE + l + 1] = crc >> 8;
+
+        if (! _usb_send_data(_mux_tx_buf, TTY_FRAME_HDR_SIZE + l + TTY_FRAME_CRC_SIZE))
+            break;
+
+        sent += l;
+    } while (sent < len);
+
+    return (sent);
 }
 
 int _write (int fd, const void *buf, size_t count)
@@ -61,7 +132,10 @@ int _write (int fd, const void *buf, size_t count)
     char *ptr = (char *)buf;
     size_t n = count;
 
-    _usb_send_data((u8 *)buf, count);
+    if (_mux_enabled)
+        tty_put_frame(TTY_CH_CONSOLE, (const u8 *)buf, count);
+    else
+        _usb_send_data((u8 *)buf, count);
 
     while (n--)
     {
@@ -76,15 +150,8 @@ int _read (int fd, const void *buf, size_t count)
     return (0);
 }
 
-static void _usb_rx_handler(u8 *buf, u32 len)
+static void _usb_stream_put(u8 *buf, u32 len)
 {
-    /* Check if TLS handshake is active - route to TLS handler */
-    if (tls_pqc_is_active()) {
-        tls_pqc_usb_rx_handler(buf, len);
-        return;
-    }
-
-    /* Normal TTY mode - route to command parser */
     u32 i;
 
     size_t wr_ptr = _usb_stream_wr_ptr;
@@ -96,6 +163,7 @@ static void _usb_rx_handler(u8 *buf, u32 len)
 
         if (wr_ptr == _usb_stream_rd_ptr)
         {
+            STATS_INC(STATS_USB_RX_OVERFLOW);
             OS_ERROR("USB RX overflow !");
             return;
         }
@@ -104,6 +172,108 @@ static void _usb_rx_handler(u8 *buf, u32 len)
     _usb_stream_wr_ptr = wr_ptr;
 }
 
+static void _mux_dispatch(u8 ch, u8 *data, u32 len)
+{
+    switch (ch)
+    {
+    case TTY_CH_CONSOLE:
+        _usb_stream_put(data, len);
+        break;
+
+    case TTY_CH_TLS:
+        tls_pqc_usb_rx_handler(data, len);
+        break;
+
+    default:
+        if ((ch < TTY_CH_COUNT) && (_mux_rx_handler[ch] != NULL))
+            _mux_rx_handler[ch](data, len);
+        break;
+    }
+}
+
+static void _mux_rx_feed(u8 *buf, u32 len)
+{   // frames may be split to any number of USB packets
+    mux_rx_t *rx = &_mux_rx;
+    u32 l;
+
+    while (len > 0)
+    {
+        switch (rx->state)
+        {
+        case _MUX_RX_SYNC:
+            if (*buf == TTY_FRAME_SYNC)
+                rx->state = _MUX_RX_CHANNEL;
+            break;
+
+        case _MUX_RX_CHANNEL:
+            rx->hdr[1] = *buf;
+            rx->state = _MUX_RX_LEN_LSB;
+            break;
+
+        case _MUX_RX_LEN_LSB:
+            rx->hdr[2] = *buf;
+            rx->state = _MUX_RX_LEN_MSB;
+            break;
+
+        case _MUX_RX_LEN_MSB:
+            rx->hdr[3] = *buf;
+            rx->len = rx->hdr[2] | (rx->hdr[3] << 8);
+            rx->pos = 0;
+            if (rx->len > TTY_FRAME_MAX)
+            {   // not a frame, search for next sync
+                _mux_errors++;
+                rx->state = _MUX_RX_SYNC;
+            }
+            else
+                rx->state = (rx->len > 0) ? _MUX_RX_DATA : _MUX_RX_CRC_LSB;
+            break;
+
+        case _MUX_RX_DATA:
+            // copy as much as possible at once
+            l = rx->len - rx->pos;
+            if (l > len)
+                l = len;
+            memcpy(&rx->data[rx->pos], buf, l);
+            rx->pos += l;
+            buf += l;
+            len -= l;
+            if (rx->pos == rx->len)
+                rx->state = _MUX_RX_CRC_LSB;
+            continue;
+
+        case _MUX_RX_CRC_LSB:
+            rx->crc = *buf;
+            rx->state = _MUX_RX_CRC_MSB;
+            break;
+
+        case _MUX_RX_CRC_MSB:
+            rx->crc |= *buf << 8;
+            rx->state = _MUX_RX_SYNC;
+            if (crc16_update(crc16(&rx->hdr[1], TTY_FRAME_HDR_SIZE - 1), rx->data, rx->len) != rx->crc)
+            {
+                _mux_errors++;
+                break;
+            }
+            _mux_dispatch(rx->hdr[1], rx->data, rx->len);
+            break;
+        }
+        buf++;
+        len--;
+    }
+}
+
+static void _usb_rx_handler(u8 *buf, u32 len)
+{
+    if (_mux_enabled)
+    {   // framed data, routed by channel
+        _mux_rx_feed(buf, len);
+        return;
+    }
+
+    // TLS records use own CDC data interface, console is always routed to command parser
+    _usb_stream_put(buf, len);
+}
+
 int _usb_getchar(void)
 {
     size_t rd_ptr = _usb_stream_rd_ptr;
@@ -137,10 +307,18 @@ void _rx_feed(tty_buf_t *buf, char ch)
     {
         if (buf->len>0)
         {
+            STATS_INC(STATS_TTY_LINES);
             if (_rx_callback != NULL)
                 _rx_callback(buf->data);
 
             buf->len = 0;
+
+            if (_mux_next != _mux_enabled)
+            {   // reply to the command was sent in previous mode
+                OS_FLUSH();
+                _mux_rx.state = _MUX_RX_SYNC;
+                _mux_enabled = _mux_next;
+            }
         }
     }
     else if (buf->len < (TTY_BUF_SIZE-1))
@@ -169,13 +347,19 @@ void tty_rx_task(void)
 
 void tty_put_binary(u8 *data, size_t len)
 {
-    _usb_send_data(data, len);
+    if (_mux_enabled)
+        tty_put_frame(TTY_CH_CONSOLE, data, len);
+    else
+        _usb_send_data(data, len);
     // NOTE: we dont send binary data to UART in this function
 }
 
 void tty_put_text(char *text)
 {
-    _usb_send_data((u8 *)text, strlen(text));
+    if (_mux_enabled)
+        tty_put_frame(TTY_CH_CONSOLE, (const u8 *)text, strlen(text));
+    else
+        _usb_send_data((u8 *)text, strlen(text));
     while (*text != '\0')
     {
         TTY_UART_PUTCHAR(*text);
@@ -183,6 +367,43 @@ void tty_put_text(char *text)
     }
 }
 
+void tty_put_log(char *text)
+{
+    if (_mux_enabled)
+        tty_put_frame(TTY_CH_LOG, (const u8 *)text, strlen(text));
+    else
+        tty_put_text(text);
+}
+
+void tty_mux_request(bool state)
+{
+    _mux_next = state;
+}
+
+void tty_mux_reset(void)
+{
+    OS_FLUSH();
+    _mux_next = false;
+    _mux_enabled = false;
+    _mux_rx.state = _MUX_RX_SYNC;
+}
+
+bool tty_mux_enabled(void)
+{
+    return (_mux_enabled);
+}
+
+u32 tty_mux_errors(void)
+{
+    return (_mux_errors);
+}
+
+void tty_mux_set_rx_handler(tty_channel_e ch, tty_channel_rx_t handler)
+{
+    if (ch < TTY_CH_COUNT)
+        _mux_rx_handler[ch] = handler;
+}
+
 void tty_flush_usb_rx(void)
 {
     /* Clear USB command stream buffer to prevent contamination */
@@ -23,7 +23,24 @@
  	#define	TTY_UART_INIT(baud)
 #endif
 
+// binary framing (MUX) mode, frame: SYNC, channel, length (LSB first), payload, CRC16 (LSB first)
+// CRC16 (see crc16.h) covers channel, length and payload
+#define TTY_FRAME_SYNC      (0xA5)
+#define TTY_FRAME_HDR_SIZE  (4)
+#define TTY_FRAME_CRC_SIZE  (2)
+#define TTY_FRAME_MAX       (2048) // maximum payload size
+
+typedef enum {
+    TTY_CH_CONSOLE   = 0, // command lines and their replies
+    TTY_CH_TLS       = 1, // raw TLS records
+    TTY_CH_SPI       = 2, // binary SPI transfers
+    TTY_CH_LOG       = 3, // debug output
+    TTY_CH_TELEMETRY = 4, // counters and measurements
+    TTY_CH_COUNT
+} tty_channel_e;
+
 typedef void (*tty_parse_callback_t) (char *data);
+typedef void (*tty_channel_rx_t) (u8 *data, u32 len);
 
 bool tty_init(tty_parse_callback_t callback);
 void tty_put_binary(u8 *data, size_t len);
@@ -31,5 +48,13 @@ void tty_put_text(char *text);
 void tty_rx_task(void);
 void tty_flush_usb_rx(void);  /* Clear USB command stream buffer */
 
+void tty_mux_request(bool state); // applied after reply to the current command line
+void tty_mux_reset(void);         // back to plain text mode immediately
+bool tty_mux_enabled(void);
+u32 tty_mux_errors(void);
+void tty_mux_set_rx_handler(tty_channel_e ch, tty_channel_rx_t handler);
+size_t tty_put_frame(tty_channel_e ch, const u8 *data, size_t len);
+void tty_put_log(char *text);
+
 #endif // ! TTY_H
 
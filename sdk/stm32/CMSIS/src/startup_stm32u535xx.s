@@ -41,6 +41,12 @@ defined in linker script */
 .word _sbss
 /* end address for the .bss section. defined in linker script */
 .word _ebss
+/* ramfunc code in flash and SRAM, sram4 buffers. defined in linker script */
+.word _siramfunc
+.word _sramfunc
+.word _eramfunc
+.word _ssram4
+.word _esram4
 
 /**
  * @brief  This is the code that gets called when the processor first
@@ -77,6 +83,23 @@ LoopCopyDataInit:
   cmp r4, r1
   bcc CopyDataInit
 
+/* Copy the ramfunc code from flash to SRAM */
+  ldr r0, =_sramfunc
+  ldr r1, =_eramfunc
+  ldr r2, =_siramfunc
+  movs r3, #0
+  b LoopCopyRamFunc
+
+CopyRamFunc:
+  ldr r4, [r2, r3]
+  str r4, [r0, r3]
+  adds r3, r3, #4
+
+LoopCopyRamFunc:
+  adds r4, r0, r3
+  cmp r4, r1
+  bcc CopyRamFunc
+
 /* Zero fill the bss segment. */
   ldr r2, =_sbss
   ldr r4, =_ebss
@@ -91,6 +114,24 @@ LoopFillZerobss:
   cmp r2, r4
   bcc FillZerobss
 
+/* SRAM4 clock on (RCC_AHB3ENR SRAM4EN), then zero fill the sram4 segment */
+  ldr r2, =0x46020C94
+  ldr r3, [r2]
+  orr r3, r3, #0x80000000
+  str r3, [r2]
+  ldr r2, =_ssram4
+  ldr r4, =_esram4
+  movs r3, #0
+  b LoopFillZeroSram4
+
+FillZeroSram4:
+  str  r3, [r2]
+  adds r2, r2, #4
+
+LoopFillZeroSram4:
+  cmp r2, r4
+  bcc FillZeroSram4
+
 /* Call static constructors */
   bl __libc_init_array
 /* Call the application's entry point.*/
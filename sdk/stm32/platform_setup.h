@@ -13,6 +13,19 @@
 #define PACK_BEGIN
 #define PACK_END
 
+// code copied to SRAM by the startup, no flash wait states or ICACHE misses,
+// RAMFUNC_ENABLE=0 (make RAMFUNC=0) leaves it in flash for comparison
+#ifndef RAMFUNC_ENABLE
+#define RAMFUNC_ENABLE  1
+#endif
+#if RAMFUNC_ENABLE
+#define RAMFUNC     __attribute__((section(".ramfunc"), noinline))
+#else
+#define RAMFUNC     __attribute__((noinline))
+#endif
+// zeroed by the startup in SRAM4, DMA buffers apart from CPU data in SRAM1/2
+#define SRAM4_BSS   __attribute__((section(".sram4")))
+
 #define PLATFORM_NAME        "STM32xx"
 
 #define NL "\r\n"
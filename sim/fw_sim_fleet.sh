@@ -0,0 +1,30 @@
+#!/bin/bash
+# Starts N simulated devices (fw_sim) named sim000, sim001, ... Their ports
+# are linked in DIR as <name>-console and <name>-data, stderr (pty names and
+# L3SESSION command) goes to DIR/<name>.log. Ctrl-C stops all of them.
+#
+#   ./fw_sim_fleet.sh [N] [DIR] [fw_sim options]
+#   ./fw_sim_fleet.sh 200 /tmp/fw_sim -s
+
+N="${1:-10}"
+DIR="${2:-/tmp/fw_sim}"
+shift 2 2>/dev/null
+
+cd "$(dirname "$0")"
+if [ ! -x ./fw_sim ]; then
+    echo "Error: ./fw_sim not built, run: make sim"
+    exit 1
+fi
+
+mkdir -p "$DIR"
+pids=()
+trap 'kill "${pids[@]}" 2>/dev/null; exit 0' INT TERM
+
+for ((i = 0; i < N; i++)); do
+    name=$(printf "sim%03d" "$i")
+    ./fw_sim -n "$name" -l "$DIR" "$@" 2> "$DIR/$name.log" &
+    pids+=($!)
+done
+
+echo "$N devices in $DIR, Ctrl-C stops them"
+wait
@@ -0,0 +1,57 @@
+#ifndef HARDWARE_H
+#define HARDWARE_H
+
+// Host build: no board, SPI and GPO are wired to the target model
+// (sim_model.h), GPIO ports are plain memory (stm32u5xx.h stand-in)
+
+#include "stm32u5xx.h"
+
+#include "platform_setup.h"
+
+#define HW_NAME             "SIM"
+
+#define SYSCLK                  48000000 // sys_get_hclk() after start
+#define HW_CLOCK_PROFILE        0
+#define HCLK                    SYSCLK
+
+#define HW_LED1_BIT   (9)
+#define HW_LED1_PORT  GPIOA
+#define HW_LED1_INIT  GPIO_PIN_INIT(HW_LED1_PORT, HW_LED1_BIT, GPIO_MODE_OUTPUT)
+#define HW_LED1_ON    GPIO_BIT_SET(HW_LED1_PORT, HW_LED1_BIT)
+#define HW_LED1_OFF   GPIO_BIT_CLR(HW_LED1_PORT, HW_LED1_BIT)
+
+// no button, BUTTON command is left out
+#define HW_BUTTON_INIT
+
+#define HW_CONSOLE_ON_UART  0
+
+#define SPI1_ON  1
+
+#define HW_SPI_OE_INIT
+#define HW_SPI_OE_ENABLE
+#define HW_SPI_OE_DISABLE
+
+bool sim_gpo(void);
+
+#define HW_GPO_IN_INIT
+#define HW_GPO_IN           (sim_gpo())
+// GPO rising edge interrupt, raised by sim_hw.c after SPI1 transfers
+#define HW_GPO_EXTI_PORT   (0)
+#define HW_GPO_EXTI_SOURCE (0)
+#define HW_GPO_EXTI_LINE   (1UL << 0)
+#define HW_GPO_EXTI_IRQn   EXTI0_IRQn
+#define HW_GPO_EXTI_IRQHandler EXTI0_IRQHandler
+
+#define HW_CHIP_PWR_BIT     (0)
+#define HW_CHIP_PWR_PORT    GPIOA
+#define HW_CHIP_PWR_INIT    GPIO_PIN_INIT(HW_CHIP_PWR_PORT, HW_CHIP_PWR_BIT, GPIO_MODE_OUTPUT)
+#define HW_CHIP_PWR_ON      GPIO_BIT_SET(HW_CHIP_PWR_PORT, HW_CHIP_PWR_BIT)
+#define HW_CHIP_PWR_OFF     GPIO_BIT_CLR(HW_CHIP_PWR_PORT, HW_CHIP_PWR_BIT)
+
+#define HW_USB_DP_BIT   (12)
+#define HW_USB_DP_PORT  GPIOA
+
+#define DEF_PRIO                7
+#define GPO_ISR_PRIO            DEF_PRIO
+
+#endif // ! HARDWARE_H
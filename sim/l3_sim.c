@@ -0,0 +1,132 @@
+/* l3_sim.c
+ * Runs the device side L2/L3 engines (app/l2.c, app/l3.c) against the
+ * software TROPIC01 model: session start, chunked commands and results,
+ * L2 CRC retries, busy chip, wrong pairing key and session abort.
+ *
+ * Usage: ./l3_sim [rounds]
+ */
+
+#include "l2.h"
+#include "l3.h"
+#include "tropic01_model.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <wolfssl/wolfcrypt/curve25519.h>
+#include <wolfssl/wolfcrypt/random.h>
+
+#define PING        0x01
+#define RANDOM_GET  0x50
+
+static int failures;
+
+static void check(int ok, const char *what)
+{
+    printf("[%c] %s\n", ok ? '+' : '-', what);
+    if (!ok)
+        failures++;
+}
+
+static int keypair(WC_RNG *rng, uint8_t *priv, uint8_t *pub)
+{
+    curve25519_key key;
+    word32 priv_len = MODEL_KEY_SIZE, pub_len = MODEL_KEY_SIZE;
+    int ret;
+
+    wc_curve25519_init(&key);
+    ret = wc_curve25519_make_key(rng, MODEL_KEY_SIZE, &key);
+    if (ret == 0)
+        ret = wc_curve25519_export_key_raw_ex(&key, priv, &priv_len, pub, &pub_len,
+                                              EC25519_LITTLE_ENDIAN);
+    wc_curve25519_free(&key);
+    return ret;
+}
+
+static int ping(size_t len)
+{
+    static u8 cmd[L3_DATA_MAX], res[L3_DATA_MAX];
+    u32 res_len = sizeof(res);
+    size_t i;
+
+    cmd[0] = PING;
+    for (i = 1; i < len; i++)
+        cmd[i] = (u8)(i * 7);
+    if (l3_command(cmd, len, res, &res_len, L2_TIMEOUT_MS) != L3_OK)
+        return 0;
+    return res_len == len && res[0] == L3_RESULT_OK && memcmp(&res[1], &cmd[1], len - 1) == 0;
+}
+
+int main(int argc, char **argv)
+{
+    WC_RNG rng;
+    uint8_t st_priv[MODEL_KEY_SIZE], st_pub[MODEL_KEY_SIZE];
+    uint8_t sh_priv[MODEL_KEY_SIZE], sh_pub[MODEL_KEY_SIZE];
+    uint8_t other_priv[MODEL_KEY_SIZE], other_pub[MODEL_KEY_SIZE];
+    u8 cmd[2], res[L3_DATA_MAX];
+    u32 res_len, retries;
+    int rounds = (argc > 1) ? atoi(argv[1]) : 100;
+    int i, ok;
+
+    if (wc_InitRng(&rng) != 0 ||
+        keypair(&rng, st_priv, st_pub) != 0 ||
+        keypair(&rng, sh_priv, sh_pub) != 0 ||
+        keypair(&rng, other_priv, other_pub) != 0 ||
+        tropic01_model_init(st_priv) != 0) {
+        fprintf(stderr, "[-] wolfSSL X25519 not available\n");
+        return 1;
+    }
+    tropic01_model_pair(0, sh_pub);
+
+    res_len = sizeof(res);
+    check(l3_command((const u8 *)"\x01", 1, res, &res_len, L2_TIMEOUT_MS) == L3_ERR_NO_SESSION,
+          "command without session refused");
+
+    check(l3_session_start(0, sh_priv, st_pub, L2_TIMEOUT_MS) == L3_OK, "session start");
+    printf("    handshake %u us\n", l3_stats.last_handshake_us);
+
+    check(ping(1), "ping without data");
+    check(ping(200), "ping in one chunk");
+    check(ping(L3_DATA_MAX), "ping in 5 chunks, result in 5 frames");
+
+    cmd[0] = RANDOM_GET;
+    cmd[1] = 32;
+    res_len = sizeof(res);
+    check(l3_command(cmd, 2, res, &res_len, L2_TIMEOUT_MS) == L3_OK &&
+          res[0] == L3_RESULT_OK && res_len == 4 + 32, "random value get");
+
+    retries = l2_stats.crc_retries;
+    tropic01_model_corrupt(2);
+    check(ping(600), "ping with damaged response CRC");
+    check(l2_stats.crc_retries == retries + 2, "L2 resend on CRC error");
+
+    tropic01_model_busy(20);
+    check(ping(16), "ping while chip busy");
+    tropic01_model_busy(0);
+
+    for (i = 0, ok = 1; i < rounds && ok; i++)
+        ok = ping(1 + (i * 37) % L3_DATA_MAX);
+    check(ok, "IV counter in step over many commands");
+    printf("    %d commands, last %u us\n", rounds, l3_stats.last_command_us);
+
+    l3_session_abort(L2_TIMEOUT_MS);
+    check(!l3_session_active() && !ping(4), "session abort");
+
+    check(l3_session_start(0, other_priv, st_pub, L2_TIMEOUT_MS) == L3_ERR_AUTH,
+          "wrong pairing key detected");
+    check(l3_session_start(1, sh_priv, st_pub, L2_TIMEOUT_MS) == L3_ERR_STATUS,
+          "empty pairing slot refused");
+    check(l3_session_start(0, sh_priv, other_pub, L2_TIMEOUT_MS) == L3_ERR_AUTH,
+          "wrong chip key detected");
+
+    printf("[*] L2: %u requests, %u polls, %u CRC retries, %u timeouts\n",
+           l2_stats.requests, l2_stats.polls, l2_stats.crc_retries, l2_stats.timeouts);
+    printf("[*] model: %u requests, %u GET_RESP, %u handshakes, %u commands\n",
+           model_stats.requests, model_stats.get_resp, model_stats.handshakes,
+           model_stats.commands);
+    printf("%s\n", failures ? "FAIL" : "PASS");
+
+    wc_FreeRng(&rng);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,162 @@
+import glob
+import os
+import selectors
+import sys
+import time
+import tty
+
+# --- Configuration ---
+DEFAULT_DIR = '/tmp/fw_sim'
+DEFAULT_SECONDS = 10
+DEFAULT_COMMAND = 'ID'
+TIMEOUT = 2.0
+
+# Closed loop console load on many simulated devices (fw_sim_fleet.sh): each
+# device has one command in flight, the next is sent when "OK" or "ERROR"
+# came back. Reports requests per second over all devices and the latency
+# distribution. With --l3 every device first starts an L3 secure session
+# (key slot from <name>.log) and the command is an encrypted Ping.
+#
+#   python3 load_gen.py [DIR] [seconds] [command | --l3]
+
+
+def percentile(values, p):
+    values = sorted(values)
+    idx = min(len(values) - 1, int(round(p / 100.0 * (len(values) - 1))))
+    return values[idx]
+
+
+class Device:
+    def __init__(self, link):
+        self.name = os.path.basename(link)[:-len('-console')]
+        self.fd = os.open(link, os.O_RDWR | os.O_NOCTTY | os.O_NONBLOCK)
+        tty.setraw(self.fd)
+        self.buf = b''
+        self.sent = 0.0
+        self.lost = False
+
+    def drain(self):
+        try:
+            while os.read(self.fd, 4096):
+                pass
+        except BlockingIOError:
+            pass
+
+    def send(self, line):
+        self.buf = b''
+        self.sent = time.perf_counter()
+        os.write(self.fd, line.encode() + b'\r\n')
+
+    def receive(self):
+        """Returns True/False when the reply is complete (OK/ERROR), else None."""
+        try:
+            data = os.read(self.fd, 4096)
+        except BlockingIOError:
+            return None
+        except OSError:
+            data = b''
+        if not data:
+            self.lost = True  # device reset, pty is gone
+            return False
+        self.buf += data
+        if b'OK\r\n' in self.buf:
+            return True
+        if b'ERROR' in self.buf:
+            return False
+        return None
+
+
+def session_line(log_dir, name):
+    with open(os.path.join(log_dir, name + '.log')) as f:
+        for line in f:
+            if line.startswith('# L3SESSION='):
+                return line[2:].strip()
+    return None
+
+
+def run_one(dev, line):
+    """Blocking request, for session setup."""
+    dev.send(line)
+    deadline = time.monotonic() + TIMEOUT
+    while time.monotonic() < deadline:
+        result = dev.receive()
+        if result is not None:
+            return result
+        time.sleep(0.001)
+    return False
+
+
+def main():
+    log_dir = sys.argv[1] if len(sys.argv) > 1 else DEFAULT_DIR
+    seconds = float(sys.argv[2]) if len(sys.argv) > 2 else DEFAULT_SECONDS
+    command = sys.argv[3] if len(sys.argv) > 3 else DEFAULT_COMMAND
+    l3 = command == '--l3'
+
+    links = sorted(glob.glob(os.path.join(log_dir, '*-console')))
+    if not links:
+        print(f"[-] no devices in {log_dir}, start fw_sim_fleet.sh first")
+        return 1
+    devices = [Device(link) for link in links]
+    for dev in devices:
+        dev.drain()
+    print(f"[+] {len(devices)} devices in {log_dir}")
+
+    if l3:
+        command = 'L3=01' + '5a' * 32  # Ping with 32 bytes
+        for dev in devices:
+            line = session_line(log_dir, dev.name)
+            if line is None or not run_one(dev, line):
+                print(f"[-] {dev.name}: L3 session start failed")
+                return 1
+        print("[+] L3 sessions started")
+
+    sel = selectors.DefaultSelector()
+    for dev in devices:
+        sel.register(dev.fd, selectors.EVENT_READ, dev)
+        dev.send(command)
+
+    samples = []
+    errors = 0
+    timeouts = 0
+    t0 = time.perf_counter()
+    end = t0 + seconds
+    while devices and time.perf_counter() < end:
+        for key, _ in sel.select(timeout=0.1):
+            dev = key.data
+            result = dev.receive()
+            if result is None:
+                continue
+            now = time.perf_counter()
+            if result:
+                samples.append((now - dev.sent) * 1e6)
+            else:
+                errors += 1
+            if dev.lost:
+                sel.unregister(dev.fd)
+                devices.remove(dev)
+                continue
+            if now < end:
+                dev.send(command)
+        now = time.perf_counter()
+        for dev in devices:
+            if now - dev.sent > TIMEOUT:
+                timeouts += 1
+                dev.send(command)
+    dt = time.perf_counter() - t0
+
+    if not samples:
+        print(f"[-] no replies, {errors} errors, {timeouts} timeouts")
+        return 1
+    print(f"[*] {len(samples)} x {command[:16]} in {dt:.1f} s = {len(samples) / dt:.0f} req/s, "
+          f"{errors} errors, {timeouts} timeouts")
+    print(f"[*] latency: "
+          f"min {min(samples):.0f} us, "
+          f"p50 {percentile(samples, 50):.0f} us, "
+          f"p90 {percentile(samples, 90):.0f} us, "
+          f"p99 {percentile(samples, 99):.0f} us, "
+          f"max {max(samples):.0f} us")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,826 @@
+/* sim_fw.c
+ * Linux host build of the whole firmware (fw_sim): app/main.c runs as
+ * fw_main() on POSIX stand-ins of the board.
+ *
+ *   USB CDC ports   pty pairs, <link dir>/<name>-console and -data symlinks
+ *   SPI1, GPO       target model of sim_hw.c, GPO edge raises the EXTI IRQ
+ *   TIM2            CLOCK_MONOTONIC, __WFI() is ppoll() until the deadline
+ *   RNG             getrandom()
+ *   pairing page    slot 0 holds the fixed host key paired with the model
+ *   watchdog        SIGALRM checks wd_feed() calls, timeout re-executes the
+ *                   binary like a reset; backup registers survive in env
+ *
+ * Usage: ./fw_sim [-n name] [-l link dir] [-m model] [-s] [-W]
+ */
+
+#define _GNU_SOURCE
+
+#include "common.h"
+#include "event.h"
+#include "gpio.h"
+#include "gpreg.h"
+#include "irq.h"
+#include "mem.h"
+#include "pairing.h"
+#include "reset.h"
+#include "sim_model.h"
+#include "spi.h"
+#include "stats.h"
+#include "sys.h"
+#include "time.h"
+#include "tropic01_model.h"
+#include "usb_device.h"
+#include "wd.h"
+#include "stm32u5xx_hal.h"
+#include "stm32u5xx_ll_exti.h"
+
+#include <wolfssl/wolfcrypt/settings.h>
+#include <wolfssl/wolfcrypt/curve25519.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/random.h>
+#include <sys/time.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+#define _WD_TIMEOUT     (2500)  // [8 ms] as sdk/drv_u5/wd.c
+#define _WD_TICK_MS     (100)
+#define _ENV_BKP        "SIM_BKP="  // backup registers over reset
+#define _ENV_RST        "SIM_RST="  // reset flag of next start, reset_type_e
+#define _TX_WAIT_MS     (100)       // host not reading the pty
+
+int fw_main(void);
+void EXTI0_IRQHandler(void);
+int _write(int fd, const void *buf, size_t count);
+
+GPIO_TypeDef sim_gpioa;
+TAMP_TypeDef sim_tamp;
+volatile u32 sim_exti_rising = 0;
+u32 sim_exti_enabled = 0;
+
+static const char *_name = "fw_sim";
+static const char *_link_dir = NULL;
+static bool _spi_timed = false;
+static bool _wd_on = true;
+
+static char _exe[PATH_MAX];
+static char **_argv;
+static char **_envp;
+static char _env_bkp[sizeof(_ENV_BKP) + 3*9];
+static char _env_rst[sizeof(_ENV_RST) + 1];
+static reset_type_e _reset_flag = RESET_POWER_ON;
+
+// --- reset and backup registers ---
+
+static void _hex8(char *dest, u32 value)
+{
+    int i;
+
+    for (i = 0; i < 8; i++)
+        dest[i] = "0123456789abcdef"[(value >> (28 - 4*i)) & 0xF];
+}
+
+static void _restart(reset_type_e flag)
+{   // RAM is gone, backup registers stay; async-signal-safe, the watchdog
+    // runs it from SIGALRM
+    char *p = _env_bkp;
+
+    memcpy(p, _ENV_BKP, sizeof(_ENV_BKP) - 1);
+    p += sizeof(_ENV_BKP) - 1;
+    _hex8(p, sim_tamp.BKP0R);
+    p[8] = ',';
+    _hex8(&p[9], sim_tamp.BKP1R);
+    p[17] = ',';
+    _hex8(&p[18], sim_tamp.BKP2R);
+    p[26] = '\0';
+
+    memcpy(_env_rst, _ENV_RST, sizeof(_ENV_RST) - 1);
+    _env_rst[sizeof(_ENV_RST) - 1] = '0' + flag;
+    _env_rst[sizeof(_ENV_RST)] = '\0';
+
+    // watchdog tick survives exec, its handler does not
+    signal(SIGALRM, SIG_IGN);
+    execve(_exe, _argv, _envp);
+    _exit(1);
+}
+
+static void _restart_init(void)
+{   // state of previous run, environment of the next one
+    extern char **environ;
+    const char *env;
+    u32 i, n;
+
+    // own path, /proc/self/exe would rename the process to "exe"
+    if (readlink("/proc/self/exe", _exe, sizeof(_exe) - 1) < 0)
+        strcpy(_exe, "/proc/self/exe");
+
+    env = getenv("SIM_BKP");
+    if (env != NULL)
+        sscanf(env, "%x,%x,%x", (u32 *)&sim_tamp.BKP0R, (u32 *)&sim_tamp.BKP1R,
+               (u32 *)&sim_tamp.BKP2R);
+    env = getenv("SIM_RST");
+    if (env != NULL)
+        _reset_flag = atoi(env);
+
+    for (i = 0; environ[i] != NULL; i++)
+        ;
+    _envp = calloc(i + 3, sizeof(char *));
+    if (_envp == NULL)
+        exit(1);
+    for (i = 0, n = 0; environ[i] != NULL; i++)
+    {
+        if (strncmp(environ[i], _ENV_BKP, sizeof(_ENV_BKP) - 1) &&
+            strncmp(environ[i], _ENV_RST, sizeof(_ENV_RST) - 1))
+            _envp[n++] = environ[i];
+    }
+    _envp[n++] = _env_bkp;
+    _envp[n] = _env_rst;
+}
+
+reset_type_e reset_get_type(void)
+{
+    if (GPREG_WDID == GPREG_WDID_REBOOT_RQ)
+        return (RESET_USER_RQ);
+    return (_reset_flag);
+}
+
+void reset_clear(void)
+{
+    _reset_flag = RESET_POWER_ON;
+    GPREG_WRITE(GPREG_WDID, 0);
+}
+
+// --- watchdog ---
+
+static u32 _wd_timeout = _WD_TIMEOUT;
+static bool _wd_clr_enable = true;
+static u32 _wd_feeds;
+static u32 _wd_idle_ms;
+
+static void _wd_tick(int sig)
+{   // SIGALRM, no wd_feed() within timeout resets
+    static const char msg[] = "WATCHDOG RESET\n";
+    ssize_t n;
+
+    (void)sig;
+    if (_wd_clr_enable && (sim_wd_feeds != _wd_feeds))
+    {
+        _wd_feeds = sim_wd_feeds;
+        _wd_idle_ms = 0;
+        return;
+    }
+    _wd_idle_ms += _WD_TICK_MS;
+    if (_wd_idle_ms >= _wd_timeout*8)
+    {
+        n = write(STDERR_FILENO, msg, sizeof(msg) - 1);
+        (void)n;
+        _restart(RESET_WDT);
+    }
+}
+
+void wd_init(void)
+{
+}
+
+void wd_run(void)
+{
+    struct sigaction sa = {0};
+    struct itimerval tick = {
+        { 0, _WD_TICK_MS*1000 },
+        { 0, _WD_TICK_MS*1000 }
+    };
+
+    if (! _wd_on)
+        return;
+    sa.sa_handler = _wd_tick;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGALRM, &sa, NULL);
+    setitimer(ITIMER_REAL, &tick, NULL);
+}
+
+void wd_reset(u32 reason)
+{
+    GPREG_WRITE(GPREG_WDID, GPREG_WDID_REBOOT_RQ);
+    GPREG_WRITE(GPREG_BOOT, reason);
+    _restart(RESET_WDT);
+}
+
+void wd_disable(void)
+{
+    _wd_clr_enable = false;
+}
+
+void wd_set_timeout(u32 timeout)
+{
+    _wd_timeout = timeout;
+}
+
+// --- clocks, GPIO, IRQ ---
+
+static u32 _hclk = SYS_HCLK_BASE;
+
+void sys_init(void)
+{
+}
+
+void sys_clock_config(void)
+{
+}
+
+u32 sys_get_hclk(void)
+{
+    return (_hclk);
+}
+
+bool sys_set_hclk(u32 freq)
+{
+    if ((freq != SYS_HCLK_BASE) && (freq != SYS_HCLK_PERF))
+        return (false);
+    _hclk = freq;
+    return (true);
+}
+
+void gpio_init(void)
+{
+}
+
+void gpio_pin_init(gpio_port_t *port, u8 pin, u32 mode)
+{
+    (void)port;
+    (void)pin;
+    (void)mode;
+}
+
+void irq_enable(IRQn_Type IRQn, s32 prio)
+{
+    (void)IRQn;
+    (void)prio;
+}
+
+static void _gpo_rising(void)
+{   // EXTI of the GPO pin
+    sim_exti_rising |= HW_GPO_EXTI_LINE;
+    if (sim_exti_enabled & HW_GPO_EXTI_LINE)
+        HW_GPO_EXTI_IRQHandler();
+}
+
+HAL_StatusTypeDef HAL_RNG_Init(RNG_HandleTypeDef *hrng)
+{
+    (void)hrng;
+    return (HAL_OK);
+}
+
+HAL_StatusTypeDef HAL_RNG_DeInit(RNG_HandleTypeDef *hrng)
+{
+    (void)hrng;
+    return (HAL_OK);
+}
+
+HAL_StatusTypeDef HAL_RNG_GenerateRandomNumber(RNG_HandleTypeDef *hrng, uint32_t *random32bit)
+{
+    (void)hrng;
+    if (getrandom(random32bit, sizeof(*random32bit), 0) != sizeof(*random32bit))
+        return (HAL_ERROR);
+    return (HAL_OK);
+}
+
+// --- TIM2 and sleep ---
+
+static timer_time_t _wake_at;
+static bool _wake_armed = false;
+
+void timer_init(void)
+{
+}
+
+timer_time_t timer_get_time_irq(void)
+{
+    return (timer_get_time());
+}
+
+void timer_wake_at(timer_time_t time)
+{   // EVENT_TIMER at time, replaces previous deadline
+    _wake_at = time;
+    _wake_armed = true;
+    if (time <= timer_get_time())
+    {
+        _wake_armed = false;
+        event_set(EVENT_TIMER);
+    }
+}
+
+void timer_clock_update(u32 clk)
+{   // microsecond timebase does not depend on HCLK
+    (void)clk;
+}
+
+// --- SPI1 ---
+
+static u32 _spi1_prescaler = 32;
+static u32 _spi1_sck = 0;
+static bool _spi1_packed = false;
+static spi_job_t *_done_head = NULL;
+static spi_job_t *_done_tail = NULL;
+
+static void _spi1_sck_update(void)
+{   // bus time of transfers follows the set SCK with -s
+    sim_spi_sck = _spi_timed ? spi1_get_frequency() : 0;
+}
+
+void spi1_init(void)
+{
+    _spi1_sck = sys_get_hclk() / _spi1_prescaler;
+    _spi1_sck_update();
+}
+
+u32 spi1_get_prescaler(void)
+{
+    return (_spi1_prescaler);
+}
+
+u32 spi1_get_frequency(void)
+{
+    return (sys_get_hclk() / _spi1_prescaler);
+}
+
+bool spi1_set_prescaler(u32 value)
+{
+    if ((value < 2) || (value > 256) || (value & (value - 1)))
+        return (false);
+    _spi1_prescaler = value;
+    _spi1_sck = sys_get_hclk() / value;
+    _spi1_sck_update();
+    return (true);
+}
+
+void spi1_clock_update(void)
+{   // fastest prescaler not above SCK set before
+    u32 sck = _spi1_sck;
+    u32 value;
+
+    for (value = 2; (value < 256) && ((sys_get_hclk() / value) > sck); value *= 2)
+        ;
+    spi1_set_prescaler(value);
+    _spi1_sck = sck;
+}
+
+bool spi1_set_packed(bool packed)
+{
+    _spi1_packed = packed;
+    return (true);
+}
+
+bool spi1_packed(void)
+{
+    return (_spi1_packed);
+}
+
+bool spi1_submit(spi_job_t *job)
+{   // runs at once, done callback from spi1_task() as on the board
+    if ((job->len > 0) && ((job->tx == NULL) || (job->rx == NULL)))
+        return (false);
+    if (_spi1_packed && ((job->len & 3) || (((uintptr_t)job->tx | (uintptr_t)job->rx) & 3)))
+        return (false);
+
+    job->next = NULL;
+    job->error = false;
+    job->source = SPI_SOURCE_RAW; // not traced
+    job->busy = true;
+
+    if (job->flags & SPI_JOB_CS_ASSERT)
+        spi1_cs(true);
+    if (job->len > 0)
+        spi1_data_transfer(job->rx, job->tx, job->len);
+    if (job->flags & SPI_JOB_CS_RELEASE)
+        spi1_cs(false);
+
+    if (job->done != NULL)
+    {
+        if (_done_tail == NULL)
+            _done_head = job;
+        else
+            _done_tail->next = job;
+        _done_tail = job;
+    }
+    job->busy = false;
+    event_set(EVENT_SPI);
+
+    if (job->delay_us > 0)
+        time_delay_us(job->delay_us);
+    return (true);
+}
+
+bool spi1_busy(void)
+{
+    return (false);
+}
+
+void spi1_task(void)
+{   // runs done callbacks of finished jobs, call on EVENT_SPI
+    spi_job_t *job;
+
+    while ((job = _done_head) != NULL)
+    {
+        _done_head = job->next;
+        if (_done_head == NULL)
+            _done_tail = NULL;
+        job->done(job);
+    }
+}
+
+void spi1_flush(void)
+{
+}
+
+u8 spi1_transfer(u8 c)
+{
+    u8 rx;
+
+    spi1_data_transfer(&rx, &c, 1);
+    return (rx);
+}
+
+// no trace ring on host, SPITRACE stays empty
+void spi1_trace_enable(bool enable)
+{
+    (void)enable;
+}
+
+bool spi1_trace_enabled(void)
+{
+    return (false);
+}
+
+u32 spi1_trace_count(void)
+{
+    return (0);
+}
+
+u32 spi1_trace_lost(void)
+{
+    return (0);
+}
+
+bool spi1_trace_get(u32 index, spi_trace_t *entry)
+{
+    (void)index;
+    (void)entry;
+    return (false);
+}
+
+// --- USB CDC ports on ptys ---
+
+typedef struct {
+    const char *name;       // symlink suffix
+    int master;             // device side, non-blocking
+    int slave;              // kept open, hosts come and go as on USB
+    usb_cdc_rx_pfunc_t rx_handler;
+} sim_port_t;
+
+static sim_port_t _port[USB_CDC_PORTS] = {
+    { "console", -1, -1, NULL },
+    { "data",    -1, -1, NULL },
+};
+
+static void _port_open(sim_port_t *port)
+{
+    struct termios tio;
+    char link[PATH_MAX];
+    const char *path;
+
+    port->master = posix_openpt(O_RDWR | O_NOCTTY | O_CLOEXEC);
+    if ((port->master < 0) || grantpt(port->master) || unlockpt(port->master) ||
+        ((path = ptsname(port->master)) == NULL))
+    {
+        perror("pty");
+        exit(1);
+    }
+    port->slave = open(path, O_RDWR | O_NOCTTY | O_CLOEXEC);
+    if ((port->slave < 0) || tcgetattr(port->slave, &tio))
+    {
+        perror(path);
+        exit(1);
+    }
+    cfmakeraw(&tio); // no echo, binary MUX frames and TLS records pass
+    tcsetattr(port->slave, TCSANOW, &tio);
+    fcntl(port->master, F_SETFL, O_NONBLOCK);
+
+    fprintf(stderr, "%s %s %s\n", _name, port->name, path);
+    if (_link_dir != NULL)
+    {
+        snprintf(link, sizeof(link), "%s/%s-%s", _link_dir, _name, port->name);
+        unlink(link);
+        if (symlink(path, link) != 0)
+            perror(link);
+    }
+}
+
+static bool _port_poll(void)
+{   // at most one read per port, true when any data came
+    u8 buf[USB_DEVICE_POLL_MAX];
+    bool data = false;
+    ssize_t n;
+    u32 i;
+
+    for (i = 0; i < USB_CDC_PORTS; i++)
+    {
+        if (_port[i].master < 0)
+            continue;
+        n = read(_port[i].master, buf, sizeof(buf));
+        if (n <= 0)
+            continue;
+        data = true;
+        STATS_INC(STATS_USB_RX_PACKETS);
+        STATS_ADD(STATS_USB_RX_BYTES, n);
+        if (_port[i].rx_handler != NULL)
+            _port[i].rx_handler(buf, n);
+    }
+    return (data);
+}
+
+static usb_result_e _port_tx(sim_port_t *port, const u8 *data, u16 len)
+{   // whole write or BUSY, rest of a partial write waits for the host
+    struct pollfd pfd = { port->master, POLLOUT, 0 };
+    ssize_t n;
+    u16 done;
+
+    if (port->master < 0)
+        return (USB_RESULT_BUSY);
+    n = write(port->master, data, len);
+    if ((n < 0) && ((errno == EAGAIN) || (errno == EINTR)))
+    {
+        STATS_INC(STATS_USB_TX_BUSY);
+        return (USB_RESULT_BUSY);
+    }
+    STATS_INC(STATS_USB_TX_PACKETS);
+    STATS_ADD(STATS_USB_TX_BYTES, len);
+    if (n < 0)
+        return (USB_RESULT_OK);
+
+    for (done = n; done < len; done += (n > 0) ? n : 0)
+    {
+        if (poll(&pfd, 1, _TX_WAIT_MS) == 0)
+            break; // nobody reads, rest is lost as on a stalled IN endpoint
+        n = write(port->master, &data[done], len - done);
+    }
+    return (USB_RESULT_OK);
+}
+
+char *ux_device_sn_text(void)
+{   // USB serial number, the name tells simulated devices apart
+    return ((char *)_name);
+}
+
+void usb_device_init(void)
+{
+    u32 i;
+
+    for (i = 0; i < USB_CDC_PORTS; i++)
+        _port_open(&_port[i]);
+}
+
+void usb_device_task(void)
+{   // drain all data already received
+    int limit = 64;
+
+    while (_port_poll() && (--limit > 0))
+        ;
+}
+
+void usb_device_poll(void)
+{
+    _port_poll();
+}
+
+bool usb_device_connected(void)
+{
+    return (_port[USB_CDC_CONSOLE].master >= 0);
+}
+
+bool usb_cdc_rx_init(usb_cdc_rx_pfunc_t rx_handler)
+{
+    _port[USB_CDC_CONSOLE].rx_handler = rx_handler;
+    return (true);
+}
+
+usb_result_e usb_cdc_tx(u8 *data, u16 len)
+{
+    return (_port_tx(&_port[USB_CDC_CONSOLE], data, len));
+}
+
+bool usb_cdc_tx_busy(void)
+{
+    return (false);
+}
+
+bool usb_cdc_data_connected(void)
+{
+    return (_port[USB_CDC_DATA].master >= 0);
+}
+
+bool usb_cdc_data_rx_init(usb_cdc_rx_pfunc_t rx_handler)
+{
+    _port[USB_CDC_DATA].rx_handler = rx_handler;
+    return (true);
+}
+
+usb_cdc_rx_pfunc_t usb_cdc_data_rx_handler(void)
+{
+    return (_port[USB_CDC_DATA].rx_handler);
+}
+
+usb_result_e usb_cdc_data_tx(u8 *data, u16 len)
+{
+    return (_port_tx(&_port[USB_CDC_DATA], data, len));
+}
+
+void sim_wfi(void)
+{   // IRQs of the board: pty data (USB) and TIM2 compare, signals wake too
+    struct pollfd fds[USB_CDC_PORTS];
+    struct timespec ts;
+    struct timespec *timeout = NULL;
+    timer_time_t now;
+    u32 i;
+
+    for (i = 0; i < USB_CDC_PORTS; i++)
+    {
+        fds[i].fd = _port[i].master;
+        fds[i].events = POLLIN;
+        fds[i].revents = 0;
+    }
+    if (_wake_armed)
+    {
+        now = timer_get_time();
+        if (_wake_at > now)
+        {
+            ts.tv_sec = (_wake_at - now) / 1000000UL;
+            ts.tv_nsec = ((_wake_at - now) % 1000000UL) * 1000;
+        }
+        else
+        {
+            ts.tv_sec = 0;
+            ts.tv_nsec = 0;
+        }
+        timeout = &ts;
+    }
+
+    if (ppoll(fds, USB_CDC_PORTS, timeout, NULL) > 0)
+    {
+        for (i = 0; i < USB_CDC_PORTS; i++)
+        {
+            if (fds[i].revents & POLLIN)
+                event_set(EVENT_USB);
+        }
+    }
+    if (_wake_armed && (timer_get_time() >= _wake_at))
+    {
+        _wake_armed = false;
+        event_set(EVENT_TIMER);
+    }
+}
+
+// --- RAM figures and BENCH clock ---
+
+// linker sections and the stack of the MCU do not exist here, MEM reads 0
+void mem_init(void)
+{
+}
+
+void mem_reset(void)
+{
+}
+
+void mem_get_info(mem_info_t *info)
+{
+    memset(info, 0, sizeof(*info));
+}
+
+void mem_mark(void)
+{
+}
+
+void mem_since_mark(mem_peak_t *peak)
+{
+    memset(peak, 0, sizeof(*peak));
+}
+
+// --- pairing flash page ---
+
+static u8 _pairing_sh_priv[L3_KEY_SIZE];
+static u8 _pairing_st_pub[L3_KEY_SIZE];
+
+bool pairing_get(u8 slot, u8 *sh_priv, u8 *st_pub)
+{   // only slot 0 is provisioned, see main()
+    if (slot != 0)
+        return (false);
+    memcpy(sh_priv, _pairing_sh_priv, L3_KEY_SIZE);
+    memcpy(st_pub, _pairing_st_pub, L3_KEY_SIZE);
+    return (true);
+}
+
+void prof_cycles_init(void)
+{   // no DWT, BENCH and REPLAY count with bench_host_clock()
+}
+
+u32 bench_host_clock(void)
+{   // nanoseconds scaled to HCLK cycles, BENCH prints the usual figures
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((u32)(((u64)ts.tv_sec * 1000000000ULL + ts.tv_nsec) * (sys_get_hclk() / 1000000) / 1000));
+}
+
+// --- start ---
+
+static ssize_t _stdout_write(void *cookie, const char *buf, size_t size)
+{   // printf() of the firmware goes through tty.c as newlib's _write() does
+    (void)cookie;
+    return (_write(1, buf, size));
+}
+
+static void _key(u8 *key, u8 seed)
+{   // fixed keys, hosts know them without a provisioning step
+    u32 i;
+
+    for (i = 0; i < MODEL_KEY_SIZE; i++)
+        key[i] = seed + i;
+    key[0] &= 248;
+    key[31] &= 127;
+    key[31] |= 64;
+}
+
+static void _usage(void)
+{
+    const sim_model_t *model;
+    u32 i;
+
+    fprintf(stderr,
+        "usage: fw_sim [-n name] [-l link dir] [-m model] [-s] [-W]\n"
+        "  -n  name of ports and log lines (fw_sim)\n"
+        "  -l  <dir>/<name>-console and <name>-data link to the ptys\n"
+        "  -m  target on SPI1:");
+    for (i = 0; (model = sim_model_get(i)) != NULL; i++)
+        fprintf(stderr, " %s", model->name);
+    fprintf(stderr, "\n"
+        "  -s  transfers take SPI bus time at the set SCK\n"
+        "  -W  no watchdog (debugger)\n");
+    exit(2);
+}
+
+int main(int argc, char **argv)
+{
+    cookie_io_functions_t io = { .write = _stdout_write };
+    u8 st_priv[MODEL_KEY_SIZE];
+    u8 sh_pub[MODEL_KEY_SIZE];
+    const sim_model_t *model = &sim_model_tropic01;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:l:m:sW")) != -1)
+    {
+        switch (opt)
+        {
+        case 'n': _name = optarg; break;
+        case 'l': _link_dir = optarg; break;
+        case 'm':
+            model = sim_model_find(optarg);
+            if (model == NULL)
+                _usage();
+            break;
+        case 's': _spi_timed = true; break;
+        case 'W': _wd_on = false; break;
+        default:
+            _usage();
+        }
+    }
+    _argv = argv;
+    _restart_init();
+
+    // TROPIC01 model paired with the key provisioned in slot 0, L3SESSION
+    // command on stderr for load_gen.py
+    _key(st_priv, 0x40);
+    _key(_pairing_sh_priv, 0x60);
+    if ((tropic01_model_init(st_priv) != 0) ||
+        (wc_curve25519_make_pub(sizeof(sh_pub), sh_pub, sizeof(_pairing_sh_priv), _pairing_sh_priv) != 0))
+    {
+        fprintf(stderr, "%s: X25519 not available\n", _name);
+        return (1);
+    }
+    tropic01_model_st_pub(_pairing_st_pub);
+    tropic01_model_pair(0, sh_pub);
+    fputs("# L3SESSION=0\n", stderr);
+
+    sim_model_set(model);
+    sim_gpo_rising = _gpo_rising;
+
+    stdout = fopencookie(NULL, "w", io);
+    if (stdout == NULL)
+        return (1);
+    setvbuf(stdout, NULL, _IOLBF, BUFSIZ);
+
+    return (fw_main());
+}
@@ -0,0 +1,150 @@
+#include "hardware.h"
+#include "spi.h"
+#include "time.h"
+#include "wd.h"
+#include "sim_model.h"
+#include "stats.h"
+#include "tropic01_model.h"
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+
+// Host build: driver calls used by app/l2.c and app/l3.c, shared by l3_sim
+// and fw_sim; SPI1 and GPO go to the selected model
+
+static void _loopback_cs(bool active)
+{
+    (void)active;
+}
+
+static void _loopback_transfer(u8 *miso, const u8 *mosi, size_t len)
+{
+    memmove(miso, mosi, len);
+}
+
+static bool _loopback_gpo(void)
+{
+    return (false);
+}
+
+const sim_model_t sim_model_tropic01 = {
+    "tropic01", tropic01_model_cs, tropic01_model_transfer, tropic01_model_gpo
+};
+
+const sim_model_t sim_model_loopback = {
+    "loopback", _loopback_cs, _loopback_transfer, _loopback_gpo
+};
+
+static const sim_model_t *_models[] = {
+    &sim_model_tropic01,
+    &sim_model_loopback,
+    NULL
+};
+
+static const sim_model_t *_model = &sim_model_tropic01;
+static bool _cs;
+static bool _gpo;
+
+void (*sim_gpo_rising)(void) = NULL;
+u32 sim_spi_sck = 0;
+volatile u32 sim_wd_feeds = 0;
+
+const sim_model_t *sim_model_find(const char *name)
+{
+    u32 i;
+
+    for (i = 0; _models[i] != NULL; i++)
+    {
+        if (strcmp(_models[i]->name, name) == 0)
+            return (_models[i]);
+    }
+    return (NULL);
+}
+
+const sim_model_t *sim_model_get(u32 index)
+{
+    if (index >= (sizeof(_models) / sizeof(_models[0])))
+        return (NULL);
+    return (_models[index]);
+}
+
+void sim_model_set(const sim_model_t *model)
+{
+    _model = model;
+    _gpo = model->gpo();
+}
+
+static void _gpo_update(void)
+{   // response ready edge, EXTI on the board
+    bool gpo = _model->gpo();
+
+    if (gpo && (! _gpo) && (sim_gpo_rising != NULL))
+        sim_gpo_rising();
+    _gpo = gpo;
+}
+
+bool sim_gpo(void)
+{
+    return (_model->gpo());
+}
+
+void spi1_cs(bool state)
+{
+    _cs = state;
+    _model->cs(state);
+    _gpo_update();
+}
+
+bool spi1_cs_state(void)
+{
+    return (_cs);
+}
+
+bool spi1_data_transfer(u8 *rx, u8 *tx, size_t len)
+{
+    timer_time_t end;
+
+    STATS_INC(STATS_SPI_JOBS);
+    STATS_ADD(STATS_SPI_BYTES, len);
+    if (sim_spi_sck != 0)
+    {   // busy wait, SPI1 is blocking on the board as well
+        end = timer_get_time() + ((u64)len*8*1000000UL + sim_spi_sck - 1) / sim_spi_sck;
+        while (timer_get_time() < end)
+            ;
+    }
+    _model->transfer(rx, tx, len);
+    _gpo_update();
+    return (true);
+}
+
+u8 spi1_trace_source(u8 source)
+{   // no trace on host
+    return (source);
+}
+
+timer_time_t timer_get_time(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((timer_time_t)ts.tv_sec*1000000UL + ts.tv_nsec/1000);
+}
+
+void time_delay_ms(u32 delay)
+{
+    time_delay_us(delay*1000);
+}
+
+void time_delay_us(u32 tm)
+{   // whole delay also when a signal (fw_sim watchdog) interrupts it
+    struct timespec ts = { tm / 1000000UL, (tm % 1000000UL) * 1000 };
+
+    while ((nanosleep(&ts, &ts) != 0) && (errno == EINTR))
+        ;
+}
+
+void wd_feed(void)
+{
+    STATS_INC(STATS_WD_FEEDS);
+    sim_wd_feeds++;
+}
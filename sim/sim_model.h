@@ -0,0 +1,33 @@
+#ifndef SIM_MODEL_H
+#define SIM_MODEL_H
+
+// Target on SPI1 of host builds: sim_hw.c routes CS, transfers and GPO to
+// the selected model, default is the TROPIC01 model (tropic01_model.h).
+// Further targets only need an entry in the table of sim_hw.c.
+
+#include "type.h"
+#include <stddef.h>
+
+typedef struct {
+    const char *name;
+    void (*cs)(bool active);
+    void (*transfer)(u8 *miso, const u8 *mosi, size_t len);
+    bool (*gpo)(void);
+} sim_model_t;
+
+extern const sim_model_t sim_model_tropic01;
+extern const sim_model_t sim_model_loopback;   // MISO returns MOSI, GPO low
+
+// NULL when unknown, index walks the table until NULL
+const sim_model_t *sim_model_find(const char *name);
+const sim_model_t *sim_model_get(u32 index);
+void sim_model_set(const sim_model_t *model);
+
+// called on GPO rising edge after CS change or transfer, may be NULL
+extern void (*sim_gpo_rising)(void);
+// bus time of transfers is waited out at this SCK [Hz], 0 == no wait
+extern u32 sim_spi_sck;
+// wd_feed() calls, watched by the fw_sim watchdog
+extern volatile u32 sim_wd_feeds;
+
+#endif // ! SIM_MODEL_H
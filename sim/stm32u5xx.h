@@ -0,0 +1,43 @@
+#ifndef STM32U5XX_H
+#define STM32U5XX_H
+
+// Host build: CMSIS core and the registers the application touches. IRQ
+// handlers of fw_sim run in the main thread from sim_wfi() or SPI1
+// transfers, so masking has nothing to do. AES stays undefined, which keeps
+// the STM32 CRYP port of user_settings.h out.
+
+#include <stdint.h>
+
+typedef enum {
+    EXTI0_IRQn = 11,
+} IRQn_Type;
+
+typedef struct {
+    volatile uint32_t IDR;
+    volatile uint32_t ODR;
+    volatile uint32_t BSRR;
+    volatile uint32_t BRR;
+} GPIO_TypeDef;
+
+typedef struct {
+    volatile uint32_t BKP0R;
+    volatile uint32_t BKP1R;
+    volatile uint32_t BKP2R;
+} TAMP_TypeDef;     // kept over reset of fw_sim
+
+extern GPIO_TypeDef sim_gpioa;
+extern TAMP_TypeDef sim_tamp;
+
+#define GPIOA   (&sim_gpioa)
+#define TAMP    (&sim_tamp)
+
+static inline uint32_t __get_PRIMASK(void) { return (0); }
+static inline void __set_PRIMASK(uint32_t primask) { (void)primask; }
+static inline void __disable_irq(void) {}
+static inline void __enable_irq(void) {}
+
+// waits for pty data or timer_wake_at() deadline
+void sim_wfi(void);
+#define __WFI()     sim_wfi()
+
+#endif // ! STM32U5XX_H
@@ -0,0 +1,24 @@
+#ifndef STM32U5XX_HAL_H
+#define STM32U5XX_HAL_H
+
+// Host build: RNG part of the HAL used by main.c, random numbers come from
+// getrandom()
+
+#include "stm32u5xx.h"
+
+typedef enum {
+    HAL_OK = 0,
+    HAL_ERROR,
+} HAL_StatusTypeDef;
+
+typedef struct {
+    void *Instance;
+} RNG_HandleTypeDef;
+
+#define RNG     ((void *)0)
+
+HAL_StatusTypeDef HAL_RNG_Init(RNG_HandleTypeDef *hrng);
+HAL_StatusTypeDef HAL_RNG_DeInit(RNG_HandleTypeDef *hrng);
+HAL_StatusTypeDef HAL_RNG_GenerateRandomNumber(RNG_HandleTypeDef *hrng, uint32_t *random32bit);
+
+#endif // ! STM32U5XX_HAL_H
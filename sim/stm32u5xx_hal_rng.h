@@ -0,0 +1,8 @@
+#ifndef STM32U5XX_HAL_RNG_H
+#define STM32U5XX_HAL_RNG_H
+
+// Host build: RNG declarations are in stm32u5xx_hal.h
+
+#include "stm32u5xx_hal.h"
+
+#endif // ! STM32U5XX_HAL_RNG_H
@@ -0,0 +1,18 @@
+#ifndef STM32U5XX_LL_EXTI_H
+#define STM32U5XX_LL_EXTI_H
+
+// Host build: GPO edge line, sim_fw.c sets the rising flag on GPO edges of
+// the model and calls the handler when the line is enabled
+
+#include "type.h"
+
+extern volatile u32 sim_exti_rising;
+extern u32 sim_exti_enabled;
+
+#define LL_EXTI_SetEXTISource(port, line)           ((void)(port), (void)(line))
+#define LL_EXTI_EnableRisingTrig_0_31(lines)        ((void)(lines))
+#define LL_EXTI_EnableIT_0_31(lines)                (sim_exti_enabled |= (lines))
+#define LL_EXTI_IsActiveRisingFlag_0_31(lines)      ((sim_exti_rising & (lines)) ? 1 : 0)
+#define LL_EXTI_ClearRisingFlag_0_31(lines)         (sim_exti_rising &= ~(lines))
+
+#endif // ! STM32U5XX_LL_EXTI_H
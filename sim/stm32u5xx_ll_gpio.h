@@ -0,0 +1,15 @@
+#ifndef STM32U5XX_LL_GPIO_H
+#define STM32U5XX_LL_GPIO_H
+
+// Host build: modes for sdk/drv_u5/gpio.h, pins are not configured
+
+#include "stm32u5xx.h"
+
+#define LL_GPIO_MODE_INPUT      (0)
+#define LL_GPIO_MODE_OUTPUT     (1)
+#define LL_GPIO_MODE_ALTERNATE  (2)
+
+#define LL_GPIO_PULL_UP         (1)
+#define LL_GPIO_PULL_DOWN       (2)
+
+#endif // ! STM32U5XX_LL_GPIO_H
@@ -0,0 +1,6 @@
+#ifndef STM32U5XX_LL_RCC_H
+#define STM32U5XX_LL_RCC_H
+
+// Host build: clocks are not simulated, sys_get_hclk() only reports them
+
+#endif // ! STM32U5XX_LL_RCC_H
@@ -0,0 +1,25 @@
+#ifndef _TIME_H_INCLUDED
+#define _TIME_H_INCLUDED
+
+// Host build: monotonic clock instead of TIM2, timer_wake_at() deadline
+// ends the __WFI() wait of fw_sim
+
+#include "type.h"
+
+#define TIMER_MS	1000UL
+#define TIMER_US	1UL
+
+typedef u64 timer_time_t;
+
+void timer_init(void);
+timer_time_t timer_get_time(void);
+timer_time_t timer_get_time_irq(void);
+static inline u32 timer_get_time32(void) { return ((u32)timer_get_time()); }
+void timer_wake_at(timer_time_t time);
+
+void timer_clock_update(u32 clk);
+
+void time_delay_ms(u32 delay);
+void time_delay_us(u32 tm);
+
+#endif/*_TIME_H_INCLUDED*/
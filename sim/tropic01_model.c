@@ -0,0 +1,464 @@
+/* tropic01_model.c
+ * Software TROPIC01 for host builds, see tropic01_model.h.
+ *
+ * Written from the chip side and on purpose sharing no code with
+ * app/l2.c and app/l3.c, so that the firmware engines are checked against
+ * an independent implementation of the protocol.
+ */
+
+#include "tropic01_model.h"
+
+#include <string.h>
+
+#include <wolfssl/wolfcrypt/settings.h>
+#include <wolfssl/wolfcrypt/aes.h>
+#include <wolfssl/wolfcrypt/curve25519.h>
+#include <wolfssl/wolfcrypt/hmac.h>
+#include <wolfssl/wolfcrypt/random.h>
+#include <wolfssl/wolfcrypt/sha256.h>
+
+#define CHIP_READY          0x01
+
+#define REQ_GET_RESP        0xAA
+#define REQ_HANDSHAKE       0x02
+#define REQ_ENC_CMD         0x04
+#define REQ_SESSION_ABT     0x08
+#define REQ_RESEND          0x10
+
+#define STATUS_REQ_OK       0x01
+#define STATUS_RES_OK       0x02
+#define STATUS_REQ_CONT     0x03
+#define STATUS_RES_CONT     0x04
+#define STATUS_HSK_ERR      0x79
+#define STATUS_NO_SESSION   0x7A
+#define STATUS_TAG_ERR      0x7B
+#define STATUS_CRC_ERR      0x7D
+#define STATUS_UNKNOWN      0x7E
+#define STATUS_NO_RESP      0xFF
+
+#define L3_CMD_PING         0x01
+#define L3_CMD_RANDOM_GET   0x50
+#define L3_RESULT_OK        0xC3
+#define L3_RESULT_INVALID   0x02
+
+#define FRAME_DATA_MAX      255
+#define FRAME_MAX           (2 + FRAME_DATA_MAX + 2)
+#define CHUNK_MAX           252
+#define TAG_SIZE            16
+#define PACKET_MAX          (2 + 4096 + TAG_SIZE)
+#define QUEUE_SIZE          24
+
+static const uint8_t protocol_name[32] = "Noise_KK1_25519_AESGCM_SHA256\0\0\0";
+
+model_stats_t model_stats;
+
+static struct {
+    WC_RNG rng;
+    curve25519_key st;
+    uint8_t st_pub[MODEL_KEY_SIZE];
+    uint8_t sh_pub[MODEL_PKEY_SLOTS][MODEL_KEY_SIZE];
+    bool sh_valid[MODEL_PKEY_SLOTS];
+
+    /* L3 session */
+    bool session;
+    uint32_t nonce;
+    uint8_t kcmd[MODEL_KEY_SIZE];
+    uint8_t kres[MODEL_KEY_SIZE];
+    uint8_t packet[PACKET_MAX];
+    size_t packet_len;
+
+    /* SPI transaction */
+    bool cs;
+    size_t pos;
+    uint8_t req[FRAME_MAX + 1];
+
+    /* response frames waiting for GET_RESP */
+    uint8_t queue[QUEUE_SIZE][FRAME_MAX];
+    int head, count;
+    uint8_t last[FRAME_MAX];
+    bool read_started;
+    uint32_t busy, busy_left;
+    uint32_t corrupt;
+} m;
+
+static uint16_t crc16(const uint8_t *data, size_t len)
+{
+    uint16_t crc = 0;
+    int i;
+
+    while (len--) {
+        crc ^= (uint16_t)(*data++) << 8;
+        for (i = 0; i < 8; i++)
+            crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x8005) : (uint16_t)(crc << 1);
+    }
+    return crc;
+}
+
+static size_t frame_len(const uint8_t *frame)
+{
+    return 2 + frame[1] + 2;
+}
+
+static void push(uint8_t status, const uint8_t *data, size_t len)
+{
+    uint8_t *frame;
+    uint16_t crc;
+
+    if (m.count == QUEUE_SIZE)
+        return;
+    frame = m.queue[(m.head + m.count++) % QUEUE_SIZE];
+    frame[0] = status;
+    frame[1] = (uint8_t)len;
+    if (len > 0)
+        memcpy(&frame[2], data, len);
+    crc = crc16(frame, 2 + len);
+    frame[2 + len] = crc & 0xFF;
+    frame[3 + len] = crc >> 8;
+}
+
+static void iv_init(uint8_t *iv, uint32_t nonce)
+{
+    memset(iv, 0, 12);
+    iv[0] = nonce & 0xFF;
+    iv[1] = (nonce >> 8) & 0xFF;
+    iv[2] = (nonce >> 16) & 0xFF;
+    iv[3] = nonce >> 24;
+}
+
+static int gcm(bool encrypt, const uint8_t *key, uint32_t nonce, const uint8_t *aad,
+               size_t aad_len, const uint8_t *in, uint8_t *out, size_t len, uint8_t *tag)
+{
+    Aes aes;
+    uint8_t iv[12];
+    int ret;
+
+    iv_init(iv, nonce);
+    if (wc_AesInit(&aes, NULL, INVALID_DEVID) != 0)
+        return -1;
+    ret = wc_AesGcmSetKey(&aes, key, MODEL_KEY_SIZE);
+    if (ret == 0 && encrypt)
+        ret = wc_AesGcmEncrypt(&aes, out, in, len, iv, sizeof(iv), tag, TAG_SIZE, aad, aad_len);
+    else if (ret == 0)
+        ret = wc_AesGcmDecrypt(&aes, out, in, len, iv, sizeof(iv), tag, TAG_SIZE, aad, aad_len);
+    wc_AesFree(&aes);
+    return ret;
+}
+
+static int mix_hash(uint8_t *h, const uint8_t *data, size_t len)
+{
+    uint8_t buf[32 + MODEL_KEY_SIZE];
+
+    memcpy(buf, h, 32);
+    memcpy(&buf[32], data, len);
+    return wc_Sha256Hash(buf, 32 + len, h);
+}
+
+static int mix_key(uint8_t *ck, curve25519_key *priv, const uint8_t *pub, uint8_t *k2)
+{   /* ck (, k2) = HKDF(ck, X25519(priv, pub)) or HKDF(ck, "") without priv */
+    curve25519_key peer;
+    uint8_t dh[MODEL_KEY_SIZE], okm[64];
+    word32 len = sizeof(dh);
+    int ret = 0;
+
+    if (priv != NULL) {
+        wc_curve25519_init(&peer);
+        ret = wc_curve25519_import_public_ex(pub, MODEL_KEY_SIZE, &peer, EC25519_LITTLE_ENDIAN);
+        if (ret == 0)
+            ret = wc_curve25519_shared_secret_ex(priv, &peer, dh, &len, EC25519_LITTLE_ENDIAN);
+        wc_curve25519_free(&peer);
+    } else {
+        len = 0;
+    }
+    if (ret == 0)
+        ret = wc_HKDF(WC_SHA256, dh, len, ck, MODEL_KEY_SIZE, NULL, 0, okm, sizeof(okm));
+    if (ret == 0) {
+        memcpy(ck, okm, MODEL_KEY_SIZE);
+        if (k2 != NULL)
+            memcpy(k2, &okm[MODEL_KEY_SIZE], MODEL_KEY_SIZE);
+    }
+    return ret;
+}
+
+static void handshake(const uint8_t *data, size_t len)
+{
+    curve25519_key et;
+    uint8_t eh_pub[MODEL_KEY_SIZE], et_pub[MODEL_KEY_SIZE], rsp[MODEL_KEY_SIZE + TAG_SIZE];
+    uint8_t h[32], ck[32], kauth[32];
+    word32 l = MODEL_KEY_SIZE;
+    int slot, ret;
+
+    m.session = false;
+    slot = (len == MODEL_KEY_SIZE + 1) ? data[MODEL_KEY_SIZE] : -1;
+    if (slot < 0 || slot >= MODEL_PKEY_SLOTS || !m.sh_valid[slot]) {
+        push(STATUS_HSK_ERR, NULL, 0);
+        return;
+    }
+    memcpy(eh_pub, data, MODEL_KEY_SIZE);
+
+    wc_curve25519_init(&et);
+    ret = wc_curve25519_make_key(&m.rng, MODEL_KEY_SIZE, &et);
+    if (ret == 0)
+        ret = wc_curve25519_export_public_ex(&et, et_pub, &l, EC25519_LITTLE_ENDIAN);
+
+    if (ret == 0)
+        ret = wc_Sha256Hash(protocol_name, sizeof(protocol_name), h);
+    if (ret == 0)
+        ret = mix_hash(h, m.sh_pub[slot], MODEL_KEY_SIZE);
+    if (ret == 0)
+        ret = mix_hash(h, m.st_pub, MODEL_KEY_SIZE);
+    if (ret == 0)
+        ret = mix_hash(h, eh_pub, MODEL_KEY_SIZE);
+    if (ret == 0)
+        ret = mix_hash(h, &data[MODEL_KEY_SIZE], 1);
+    if (ret == 0)
+        ret = mix_hash(h, et_pub, MODEL_KEY_SIZE);
+
+    /* responder side of the same DH terms */
+    memcpy(ck, protocol_name, sizeof(ck));
+    if (ret == 0)
+        ret = mix_key(ck, &et, eh_pub, NULL);
+    if (ret == 0)
+        ret = mix_key(ck, &et, m.sh_pub[slot], NULL);
+    if (ret == 0)
+        ret = mix_key(ck, &m.st, eh_pub, kauth);
+    if (ret == 0)
+        ret = mix_key(ck, NULL, NULL, m.kres);
+    if (ret == 0) {
+        memcpy(m.kcmd, ck, MODEL_KEY_SIZE);
+        ret = gcm(true, kauth, 0, h, sizeof(h), NULL, NULL, 0, &rsp[MODEL_KEY_SIZE]);
+    }
+    wc_curve25519_free(&et);
+
+    if (ret != 0) {
+        push(STATUS_HSK_ERR, NULL, 0);
+        return;
+    }
+    memcpy(rsp, et_pub, MODEL_KEY_SIZE);
+    m.session = true;
+    m.nonce = 0;
+    m.packet_len = 0;
+    model_stats.handshakes++;
+    push(STATUS_REQ_OK, rsp, sizeof(rsp));
+}
+
+static size_t l3_execute(const uint8_t *cmd, size_t len, uint8_t *res)
+{   /* RESULT, DATA */
+    size_t n;
+
+    switch (cmd[0]) {
+    case L3_CMD_PING:
+        res[0] = L3_RESULT_OK;
+        memcpy(&res[1], &cmd[1], len - 1);
+        return len;
+    case L3_CMD_RANDOM_GET:
+        if (len != 2)
+            break;
+        n = cmd[1];
+        res[0] = L3_RESULT_OK;
+        memset(&res[1], 0, 3); /* padding */
+        wc_RNG_GenerateBlock(&m.rng, &res[4], (word32)n);
+        return 4 + n;
+    default:
+        break;
+    }
+    res[0] = L3_RESULT_INVALID;
+    return 1;
+}
+
+static void encrypted_cmd(const uint8_t *data, size_t len)
+{
+    static uint8_t plain[PACKET_MAX], res[PACKET_MAX], packet[PACKET_MAX];
+    size_t size, res_len, pos, l;
+
+    if (!m.session) {
+        push(STATUS_NO_SESSION, NULL, 0);
+        return;
+    }
+    if (m.packet_len + len > sizeof(m.packet)) {
+        m.packet_len = 0;
+        push(STATUS_TAG_ERR, NULL, 0);
+        return;
+    }
+    memcpy(&m.packet[m.packet_len], data, len);
+    m.packet_len += len;
+
+    size = (m.packet_len >= 2) ? (m.packet[0] | (m.packet[1] << 8)) : 0;
+    if (m.packet_len < 2 || m.packet_len < 2 + size + TAG_SIZE) {
+        push(STATUS_REQ_CONT, NULL, 0);
+        return;
+    }
+    m.packet_len = 0;
+
+    if (size == 0 || gcm(false, m.kcmd, m.nonce, NULL, 0, &m.packet[2], plain, size,
+                         &m.packet[2 + size]) != 0) {
+        /* chip drops the session on a bad tag */
+        m.session = false;
+        push(STATUS_TAG_ERR, NULL, 0);
+        return;
+    }
+    model_stats.commands++;
+
+    res_len = l3_execute(plain, size, res);
+    packet[0] = res_len & 0xFF;
+    packet[1] = res_len >> 8;
+    gcm(true, m.kres, m.nonce, NULL, 0, res, &packet[2], res_len, &packet[2 + res_len]);
+    m.nonce++;
+
+    push(STATUS_REQ_OK, NULL, 0);
+    res_len += 2 + TAG_SIZE;
+    for (pos = 0; pos < res_len; pos += l) {
+        l = (res_len - pos > CHUNK_MAX) ? CHUNK_MAX : res_len - pos;
+        push((pos + l < res_len) ? STATUS_RES_CONT : STATUS_RES_OK, &packet[pos], l);
+    }
+}
+
+static void request(const uint8_t *frame, size_t len)
+{
+    uint16_t crc;
+
+    if (len < 4 || len < frame_len(frame)) {
+        push(STATUS_CRC_ERR, NULL, 0);
+        return;
+    }
+    crc = frame[2 + frame[1]] | (frame[3 + frame[1]] << 8);
+    if (crc != crc16(frame, 2 + frame[1])) {
+        model_stats.crc_errors++;
+        m.count = 0;
+        push(STATUS_CRC_ERR, NULL, 0);
+        return;
+    }
+    model_stats.requests++;
+
+    if (frame[0] == REQ_RESEND) {
+        m.head = 0;
+        memcpy(m.queue[0], m.last, sizeof(m.last));
+        m.count = 1;
+        return;
+    }
+
+    /* new request, old responses are gone */
+    m.count = 0;
+    m.head = 0;
+    m.busy_left = m.busy;
+    switch (frame[0]) {
+    case REQ_HANDSHAKE:
+        handshake(&frame[2], frame[1]);
+        break;
+    case REQ_ENC_CMD:
+        encrypted_cmd(&frame[2], frame[1]);
+        break;
+    case REQ_SESSION_ABT:
+        m.session = false;
+        memset(m.kcmd, 0, sizeof(m.kcmd));
+        memset(m.kres, 0, sizeof(m.kres));
+        push(STATUS_REQ_OK, NULL, 0);
+        break;
+    default:
+        push(STATUS_UNKNOWN, NULL, 0);
+        break;
+    }
+}
+
+int tropic01_model_init(const uint8_t *st_priv)
+{
+    memset(&m, 0, sizeof(m));
+    memset(&model_stats, 0, sizeof(model_stats));
+    if (wc_InitRng(&m.rng) != 0)
+        return -1;
+    wc_curve25519_init(&m.st);
+    if (wc_curve25519_make_pub(MODEL_KEY_SIZE, m.st_pub, MODEL_KEY_SIZE, st_priv) != 0)
+        return -1;
+    if (wc_curve25519_import_private_raw_ex(st_priv, MODEL_KEY_SIZE, m.st_pub, MODEL_KEY_SIZE,
+                                            &m.st, EC25519_LITTLE_ENDIAN) != 0)
+        return -1;
+    return 0;
+}
+
+void tropic01_model_st_pub(uint8_t *pub)
+{
+    memcpy(pub, m.st_pub, MODEL_KEY_SIZE);
+}
+
+void tropic01_model_pair(int slot, const uint8_t *sh_pub)
+{
+    if (slot < 0 || slot >= MODEL_PKEY_SLOTS)
+        return;
+    m.sh_valid[slot] = (sh_pub != NULL);
+    if (sh_pub != NULL)
+        memcpy(m.sh_pub[slot], sh_pub, MODEL_KEY_SIZE);
+}
+
+void tropic01_model_busy(uint32_t polls)
+{
+    m.busy = polls;
+}
+
+void tropic01_model_corrupt(uint32_t responses)
+{
+    m.corrupt = responses;
+}
+
+void tropic01_model_cs(bool active)
+{
+    if (active && !m.cs) {
+        m.pos = 0;
+        m.read_started = false;
+    } else if (!active && m.cs && m.pos > 0) {
+        if (m.req[0] == REQ_GET_RESP) {
+            /* response was read, next GET_RESP gets the next one */
+            if (m.read_started) {
+                memcpy(m.last, m.queue[m.head], sizeof(m.last));
+                m.head = (m.head + 1) % QUEUE_SIZE;
+                m.count--;
+            }
+        } else {
+            request(m.req, m.pos);
+        }
+    }
+    m.cs = active;
+}
+
+bool tropic01_model_gpo(void)
+{
+    return m.count > 0 && m.busy_left == 0;
+}
+
+void tropic01_model_transfer(uint8_t *miso, const uint8_t *mosi, size_t len)
+{
+    static uint8_t out[FRAME_MAX];
+    size_t i;
+
+    for (i = 0; i < len; i++, m.pos++) {
+        if (m.pos < sizeof(m.req))
+            m.req[m.pos] = mosi[i];
+
+        if (m.pos == 0) {
+            miso[i] = CHIP_READY;
+            continue;
+        }
+        if (m.req[0] != REQ_GET_RESP) {
+            miso[i] = 0;
+            continue;
+        }
+
+        if (m.pos == 1) {
+            model_stats.get_resp++;
+            if (m.count == 0 || m.busy_left > 0) {
+                if (m.busy_left > 0)
+                    m.busy_left--;
+                m.read_started = false;
+            } else {
+                memcpy(out, m.queue[m.head], sizeof(out));
+                if (m.corrupt > 0) {
+                    m.corrupt--;
+                    out[frame_len(out) - 1] ^= 0x5A;
+                }
+                m.read_started = true;
+            }
+        }
+        if (!m.read_started)
+            miso[i] = STATUS_NO_RESP;
+        else
+            miso[i] = (m.pos - 1 < sizeof(out)) ? out[m.pos - 1] : 0;
+    }
+}
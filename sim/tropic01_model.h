@@ -0,0 +1,45 @@
+/* tropic01_model.h
+ * Software model of TROPIC01 on the SPI bus for host builds: L1 chip
+ * status, L2 frames with CRC, GET_RESP and RESEND, L3 secure session
+ * handshake (Noise KK1) and encrypted commands Ping and Random_Value_Get.
+ *
+ * Only what the device side L2/L3 engines need, not a full chip.
+ */
+
+#ifndef TROPIC01_MODEL_H
+#define TROPIC01_MODEL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define MODEL_KEY_SIZE      32
+#define MODEL_PKEY_SLOTS    4
+
+typedef struct {
+    uint32_t requests;     /* L2 requests with valid CRC */
+    uint32_t crc_errors;   /* L2 requests with wrong CRC */
+    uint32_t get_resp;     /* GET_RESP reads */
+    uint32_t handshakes;   /* successful session starts */
+    uint32_t commands;     /* L3 commands decrypted */
+} model_stats_t;
+
+extern model_stats_t model_stats;
+
+/* st_priv: chip X25519 private key. Returns 0 or -1 */
+int tropic01_model_init(const uint8_t *st_priv);
+void tropic01_model_st_pub(uint8_t *pub);
+/* host pairing public key to slot 0..3, NULL clears the slot */
+void tropic01_model_pair(int slot, const uint8_t *sh_pub);
+
+/* fault injection: GET_RESP answers "no response" this many times after
+ * each request, next responses are sent with damaged CRC */
+void tropic01_model_busy(uint32_t polls);
+void tropic01_model_corrupt(uint32_t responses);
+
+/* SPI side */
+void tropic01_model_cs(bool active);
+void tropic01_model_transfer(uint8_t *miso, const uint8_t *mosi, size_t len);
+bool tropic01_model_gpo(void);
+
+#endif /* TROPIC01_MODEL_H */
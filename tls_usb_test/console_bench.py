@@ -0,0 +1,85 @@
+import sys
+import time
+import serial
+
+# --- Configuration ---
+DEFAULT_USB_PORT = '/dev/ttyACM0'
+DEFAULT_ROUNDS = 200
+DEFAULT_RX_BYTES = 256 * 1024
+
+# Measures console round-trip latency ("ID" -> "OK") and sustained RX
+# throughput. RX data are sent as remark lines ("# ...") which the firmware
+# parses and quietly skips, followed by one "ID" to find out when all of them
+# were consumed. Run it before and after a firmware change and compare.
+
+
+def wait_ok(ser, timeout=2.0):
+    buf = b''
+    deadline = time.monotonic() + timeout
+    while time.monotonic() < deadline:
+        data = ser.read(256)
+        if data:
+            buf += data
+            if b'OK\r\n' in buf or b'ERROR' in buf:
+                return True
+    return False
+
+
+def percentile(values, p):
+    values = sorted(values)
+    idx = min(len(values) - 1, int(round(p / 100.0 * (len(values) - 1))))
+    return values[idx]
+
+
+def bench_latency(ser, rounds):
+    samples = []
+    for _ in range(rounds):
+        t0 = time.perf_counter()
+        ser.write(b'ID\n')
+        if not wait_ok(ser):
+            print("[-] timeout waiting for OK")
+            return
+        samples.append((time.perf_counter() - t0) * 1e6)
+
+    print(f"[*] round trip ({rounds} x ID): "
+          f"min {min(samples):.0f} us, "
+          f"p50 {percentile(samples, 50):.0f} us, "
+          f"p90 {percentile(samples, 90):.0f} us, "
+          f"p99 {percentile(samples, 99):.0f} us, "
+          f"max {max(samples):.0f} us")
+
+
+def bench_rx(ser, total):
+    line = b'#' + b'x' * 125 + b'\n'  # 127 bytes per line, well below TTY_BUF_SIZE
+    count = max(1, total // len(line))
+
+    t0 = time.perf_counter()
+    for _ in range(count):
+        ser.write(line)
+    ser.write(b'ID\n')
+    if not wait_ok(ser, timeout=30.0):
+        print("[-] timeout waiting for OK")
+        return
+    dt = time.perf_counter() - t0
+
+    nbytes = count * len(line)
+    print(f"[*] RX {nbytes} bytes in {dt * 1000:.1f} ms = {nbytes / dt / 1024:.1f} KiB/s")
+
+
+def main():
+    usb_port = sys.argv[1] if len(sys.argv) > 1 else DEFAULT_USB_PORT
+    rounds = int(sys.argv[2]) if len(sys.argv) > 2 else DEFAULT_ROUNDS
+    rx_bytes = int(sys.argv[3]) if len(sys.argv) > 3 else DEFAULT_RX_BYTES
+
+    ser = serial.Serial(usb_port, 115200, timeout=0.01)
+    ser.reset_input_buffer()
+    print(f"[+] Opened serial port {usb_port}")
+
+    bench_latency(ser, rounds)
+    bench_rx(ser, rx_bytes)
+
+    ser.close()
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,78 @@
+/* mux_term.c
+ * Minimal terminal for the devkit MUX mode: stdin lines go to the console
+ * channel, console and log frames are printed, other channels are dumped
+ * in hex with the channel number.
+ *
+ * Usage: ./mux_term [/dev/ttyACM0]
+ */
+
+#include "usb_mux.h"
+
+#include <poll.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+static void frame_cb(void *ctx, uint8_t ch, const uint8_t *data, size_t len)
+{
+    size_t i;
+    (void)ctx;
+
+    switch (ch) {
+    case MUX_CH_CONSOLE:
+        fwrite(data, 1, len, stdout);
+        break;
+    case MUX_CH_LOG:
+        printf("[log] %.*s\n", (int)len, (const char *)data);
+        break;
+    default:
+        printf("[ch%u] ", ch);
+        for (i = 0; i < len; i++)
+            printf("%02X", data[i]);
+        printf("\n");
+        break;
+    }
+    fflush(stdout);
+}
+
+int main(int argc, char **argv)
+{
+    const char *dev = (argc > 1) ? argv[1] : "/dev/ttyACM0";
+    static mux_parser_t parser;
+    struct pollfd pfd[2];
+    char line[1024];
+    int fd;
+
+    fd = mux_open(dev);
+    if (fd < 0) {
+        perror(dev);
+        return 1;
+    }
+    printf("[+] %s in MUX mode, Ctrl-D to quit\n", dev);
+
+    mux_parser_init(&parser);
+    pfd[0].fd = STDIN_FILENO;
+    pfd[0].events = POLLIN;
+    pfd[1].fd = fd;
+    pfd[1].events = POLLIN;
+
+    while (1) {
+        if (poll(pfd, 2, -1) < 0)
+            break;
+        if (pfd[0].revents & POLLIN) {
+            if (fgets(line, sizeof(line), stdin) == NULL)
+                break;
+            if (mux_send(fd, MUX_CH_CONSOLE, line, strlen(line)) < 0)
+                break;
+        }
+        if (pfd[1].revents & (POLLIN | POLLHUP | POLLERR)) {
+            if (mux_poll(fd, &parser, 0, frame_cb, NULL) < 0)
+                break;
+        }
+    }
+
+    if (parser.errors)
+        printf("[!] %u frames dropped\n", parser.errors);
+    mux_close(fd);
+    return 0;
+}
@@ -0,0 +1,74 @@
+import struct
+import sys
+
+# --- Configuration ---
+PAIRING_ADDR = 0x0807E000   # PAIRING region of STM32U535xx.ld, last flash page
+PAIRING_MAGIC = 0x52494150  # "PAIR"
+SLOTS = 4                   # L3_PKEY_INDEX_MAX + 1
+KEY_SIZE = 32
+SLOT_SIZE = 4 + 2 * KEY_SIZE + 4  # pairing_slot_t
+
+# Writes TROPIC01 pairing keys (host private key and chip public key of
+# each slot) as Intel HEX for the pairing flash page, see app/pairing.h.
+# The keys go to the device once over SWD and never over USB, L3SESSION
+# then refers to them by slot:
+#
+#   python3 pairing_hex.py 0,<SH0 priv>,<ST pub> [1,<SH1 priv>,<ST pub> ...] > pairing.hex
+#   st-flash --format ihex write pairing.hex      (or make -C ../app pairing)
+#
+# Slots not listed stay erased (not provisioned). Write protect the page and
+# set RDP level 1 afterwards, e.g. with STM32CubeProgrammer:
+#   STM32_Programmer_CLI -c port=SWD -ob WRP2A_PSTRT=31 WRP2A_PEND=31 RDP=0xBB
+
+
+def crc16(data, crc=0):
+    for b in data:
+        crc ^= b << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x8005) & 0xFFFF if crc & 0x8000 else (crc << 1) & 0xFFFF
+    return crc
+
+
+def slot_image(sh_priv, st_pub):
+    return (struct.pack('<I', PAIRING_MAGIC) + sh_priv + st_pub +
+            struct.pack('<HH', crc16(sh_priv + st_pub), 0xFFFF))
+
+
+def ihex_record(kind, addr, data):
+    rec = bytes([len(data), (addr >> 8) & 0xFF, addr & 0xFF, kind]) + data
+    return ':' + rec.hex().upper() + f"{(-sum(rec)) & 0xFF:02X}"
+
+
+def ihex(image, base):
+    lines = [ihex_record(4, 0, struct.pack('>H', base >> 16))]
+    for i in range(0, len(image), 16):
+        lines.append(ihex_record(0, (base + i) & 0xFFFF, image[i:i + 16]))
+    lines.append(ihex_record(1, 0, b''))
+    return '\n'.join(lines)
+
+
+def main():
+    if len(sys.argv) < 2:
+        print("usage: pairing_hex.py <slot>,<SH priv hex>,<ST pub hex> ...", file=sys.stderr)
+        return 1
+    image = bytearray(b'\xff' * (SLOTS * SLOT_SIZE))
+    for arg in sys.argv[1:]:
+        try:
+            slot, sh_priv, st_pub = arg.split(',')
+            slot = int(slot)
+            sh_priv = bytes.fromhex(sh_priv)
+            st_pub = bytes.fromhex(st_pub)
+        except ValueError:
+            print(f"[-] {arg[:8]}...: expected <slot>,<SH priv hex>,<ST pub hex>", file=sys.stderr)
+            return 1
+        if not 0 <= slot < SLOTS or len(sh_priv) != KEY_SIZE or len(st_pub) != KEY_SIZE:
+            print(f"[-] slot {slot}: slot 0 .. {SLOTS - 1} and 32 byte keys", file=sys.stderr)
+            return 1
+        image[slot * SLOT_SIZE:(slot + 1) * SLOT_SIZE] = slot_image(sh_priv, st_pub)
+        print(f"[+] slot {slot} provisioned", file=sys.stderr)
+    print(ihex(bytes(image), PAIRING_ADDR))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,171 @@
+import struct
+import sys
+
+# --- Configuration ---
+DEFAULT_SERVER_PORT = 11111
+BYTES_PER_LINE = 12
+
+# Extracts the server flight (ServerHello .. server Finished) of the first
+# TLS connection in a capture and writes app/replay_flight.h for the REPLAY
+# command. The device must have made the handshake with a fixed RNG seed
+# (SEED=<seed> before TLS), otherwise the flight does not decrypt on replay
+# and REPLAY stops after ServerHello.
+#
+#   sudo tcpdump -i lo -w seed.pcap port 11111     (then SEED=1, TLS)
+#   python3 replay_flight.py seed.pcap 1 [server port] > ../app/replay_flight.h
+
+LINK_NULL, LINK_ETHERNET, LINK_RAW, LINK_SLL, LINK_SLL2 = 0, 1, 101, 113, 276
+TCP_SYN = 0x02
+
+
+def pcap_packets(path):
+    """Yields (timestamp, link type, frame) of a classic pcap file."""
+    with open(path, 'rb') as f:
+        data = f.read()
+    magic = data[:4]
+    if magic in (b'\xd4\xc3\xb2\xa1', b'\x4d\x3c\xb2\xa1'):
+        endian = '<'
+    elif magic in (b'\xa1\xb2\xc3\xd4', b'\xa1\xb2\x3c\x4d'):
+        endian = '>'
+    else:
+        raise ValueError(f"{path}: not a pcap file (pcapng is not supported)")
+    nano = magic in (b'\x4d\x3c\xb2\xa1', b'\xa1\xb2\x3c\x4d')
+    link = struct.unpack(endian + 'I', data[20:24])[0]
+    pos = 24
+    while pos + 16 <= len(data):
+        sec, frac, incl, _ = struct.unpack(endian + 'IIII', data[pos:pos + 16])
+        pos += 16
+        yield sec + frac / (1e9 if nano else 1e6), link, data[pos:pos + incl]
+        pos += incl
+
+
+def ip_payload(link, frame):
+    """Returns (protocol, payload) of an IPv4/IPv6 packet, None otherwise."""
+    if link == LINK_NULL:
+        frame = frame[4:]
+    elif link == LINK_ETHERNET:
+        ethertype = struct.unpack('>H', frame[12:14])[0]
+        frame = frame[14:]
+        if ethertype == 0x8100:  # VLAN tag
+            frame = frame[4:]
+    elif link == LINK_SLL:
+        frame = frame[16:]
+    elif link == LINK_SLL2:
+        frame = frame[20:]
+    elif link != LINK_RAW:
+        raise ValueError(f"link type {link} is not supported")
+    if not frame:
+        return None
+    version = frame[0] >> 4
+    if version == 4:
+        ihl = (frame[0] & 0x0F) * 4
+        total = struct.unpack('>H', frame[2:4])[0]
+        return frame[9], frame[ihl:total]
+    if version == 6:
+        length = struct.unpack('>H', frame[4:6])[0]
+        return frame[6], frame[40:40 + length]
+    return None
+
+
+def tcp_segments(path):
+    """Yields (timestamp, src port, dst port, seq, flags, payload)."""
+    for ts, link, frame in pcap_packets(path):
+        ip = ip_payload(link, frame)
+        if ip is None or ip[0] != 6:
+            continue
+        tcp = ip[1]
+        sport, dport, seq = struct.unpack('>HHI', tcp[:8])
+        offset = (tcp[12] >> 4) * 4
+        yield ts, sport, dport, seq, tcp[13], tcp[offset:]
+
+
+def server_flight(path, server_port):
+    """Server bytes sent before the client's second flight, whole records."""
+    client_port = None
+    server_isn = None
+    server_data = {}
+    server_started = False
+    for ts, sport, dport, seq, flags, payload in tcp_segments(path):
+        if client_port is None:
+            if dport == server_port and flags & TCP_SYN:
+                client_port = sport
+            continue
+        if sport == server_port and dport == client_port:
+            if flags & TCP_SYN:
+                server_isn = seq + 1
+            elif payload and server_isn is not None:
+                server_data.setdefault((seq - server_isn) & 0xFFFFFFFF, payload)
+                server_started = True
+        elif sport == client_port and dport == server_port:
+            if payload and server_started:
+                break  # client Certificate .. Finished, server flight is done
+    if client_port is None:
+        raise ValueError(f"no connection to port {server_port}")
+
+    flight = b''
+    for offset in sorted(server_data):
+        if offset > len(flight):
+            raise ValueError(f"server data missing at offset {len(flight)}")
+        flight += server_data[offset][len(flight) - offset:]
+
+    # whole TLS records only
+    pos = 0
+    while pos + 5 <= len(flight):
+        length = struct.unpack('>H', flight[pos + 3:pos + 5])[0]
+        if pos + 5 + length > len(flight):
+            break
+        pos += 5 + length
+    if pos == 0:
+        raise ValueError("no complete TLS record from the server")
+    return flight[:pos]
+
+
+def write_header(flight, seed, source):
+    print("#ifndef REPLAY_FLIGHT_H")
+    print("#define REPLAY_FLIGHT_H")
+    print()
+    print("/* Server flight of one recorded TLS handshake for REPLAY")
+    print(" *")
+    print(" * ServerHello up to server Finished of a handshake the device made with")
+    print(" * SEED=<REPLAY_FLIGHT_SEED>, compiled into the firmware.")
+    print(" * Generated automatically by tls_usb_test/replay_flight.py")
+    print(" * DO NOT EDIT MANUALLY - regenerate using the script instead.")
+    print(" *")
+    print(f" * Source: {source}")
+    print(" */")
+    print()
+    print(f"#define REPLAY_FLIGHT_SEED  ({seed})")
+    print(f"#define REPLAY_FLIGHT_SIZE  ({len(flight)})")
+    print()
+    print("static const unsigned char replay_flight[] = {")
+    for i in range(0, len(flight), BYTES_PER_LINE):
+        chunk = flight[i:i + BYTES_PER_LINE]
+        end = ',' if i + BYTES_PER_LINE < len(flight) else ''
+        print("  " + ", ".join(f"0x{b:02x}" for b in chunk) + end)
+    print("};")
+    print()
+    print("#endif /* REPLAY_FLIGHT_H */")
+
+
+def main():
+    if len(sys.argv) < 3:
+        print("usage: replay_flight.py <capture.pcap> <seed> [server port]", file=sys.stderr)
+        return 1
+    path = sys.argv[1]
+    seed = int(sys.argv[2], 0)
+    port = int(sys.argv[3]) if len(sys.argv) > 3 else DEFAULT_SERVER_PORT
+    if seed == 0:
+        print("[-] seed 0 means RNG peripheral, record with SEED=<non zero>", file=sys.stderr)
+        return 1
+    try:
+        flight = server_flight(path, port)
+    except (ValueError, OSError) as e:
+        print(f"[-] {e}", file=sys.stderr)
+        return 1
+    write_header(flight, seed, path.split('/')[-1])
+    print(f"[+] {len(flight)} bytes of server flight, seed {seed}", file=sys.stderr)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
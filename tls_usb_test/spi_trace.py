@@ -0,0 +1,127 @@
+import sys
+import time
+
+# --- Configuration ---
+DEFAULT_USB_PORT = '/dev/ttyACM0'
+TOP_GAPS = 10
+BAR_WIDTH = 40
+
+# Turns the SPITRACE dump of the firmware into latency histograms: duration
+# of transfers per source (RAW, AUTO, CMD, L2) and idle gaps between
+# consecutive transfers, the longest gaps are listed with their neighbours
+# so stalls can be found without a logic analyzer.
+#
+#   python3 spi_trace.py [port]          start trace, wait for Enter, dump
+#   python3 spi_trace.py --file dump.txt parse saved SPITRACE output
+
+
+def read_dump(ser, timeout=5.0):
+    ser.reset_input_buffer()
+    ser.write(b'SPITRACE\n')
+    buf = b''
+    deadline = time.monotonic() + timeout
+    while time.monotonic() < deadline:
+        data = ser.read(4096)
+        if data:
+            buf += data
+            if b'OK\r\n' in buf or b'ERROR' in buf:
+                break
+    return buf.decode(errors='replace').splitlines()
+
+
+def parse(lines):
+    entries = []
+    lost = 0
+    for line in lines:
+        line = line.strip()
+        if line.startswith('SPITRACE:'):
+            lost = int(line.split(',')[1])
+            continue
+        fields = [f.strip() for f in line.split(',')]
+        if len(fields) != 8:
+            continue
+        try:
+            entries.append({
+                'start': int(fields[0]),
+                'us': int(fields[1]),
+                'source': fields[2],
+                'flags': int(fields[3], 16),
+                'len': int(fields[4]),
+                'prescaler': int(fields[5]),
+                'mosi': fields[6],
+                'miso': fields[7],
+            })
+        except ValueError:
+            pass
+    return entries, lost
+
+
+def histogram(title, values):
+    # power of 2 buckets in us
+    if not values:
+        return
+    buckets = {}
+    for v in values:
+        b = 0
+        while (1 << b) <= v:
+            b += 1
+        buckets[b] = buckets.get(b, 0) + 1
+    top = max(buckets.values())
+    values = sorted(values)
+    print(f"[*] {title}: {len(values)} x, min {values[0]} us, "
+          f"p50 {values[len(values) // 2]} us, max {values[-1]} us")
+    for b in range(min(buckets), max(buckets) + 1):
+        n = buckets.get(b, 0)
+        low = 0 if b == 0 else 1 << (b - 1)
+        print(f"    {low:>8} .. {(1 << b) - 1:>8} us {n:>6} "
+              f"{'#' * ((n * BAR_WIDTH + top - 1) // top)}")
+
+
+def describe(e):
+    return (f"{e['source']:<4} {e['len']:>5} B, /{e['prescaler']}, "
+            f"MOSI {e['mosi']}, MISO {e['miso']}"
+            f"{' ERROR' if e['flags'] & 0x04 else ''}")
+
+
+def report(entries, lost):
+    if not entries:
+        print("[-] trace is empty, start it with SPITRACE=1")
+        return
+    print(f"[*] {len(entries)} transfers, {lost} older ones overwritten")
+
+    for source in sorted(set(e['source'] for e in entries)):
+        histogram(f"{source} transfer time",
+                  [e['us'] for e in entries if e['source'] == source])
+
+    # start times are 32 bit us, differences wrap every 71 minutes
+    gaps = []
+    for prev, cur in zip(entries, entries[1:]):
+        gap = (cur['start'] - (prev['start'] + prev['us'])) & 0xFFFFFFFF
+        gaps.append((gap, prev, cur))
+    histogram("gap between transfers", [g[0] for g in gaps])
+
+    print(f"[*] longest {TOP_GAPS} gaps:")
+    for gap, prev, cur in sorted(gaps, key=lambda g: g[0], reverse=True)[:TOP_GAPS]:
+        print(f"    {gap:>8} us after  {describe(prev)}")
+        print(f"    {'':>8}    before {describe(cur)}")
+
+
+def main():
+    if len(sys.argv) > 2 and sys.argv[1] == '--file':
+        with open(sys.argv[2]) as f:
+            entries, lost = parse(f.read().splitlines())
+        report(entries, lost)
+        return
+
+    import serial  # only needed for live capture
+
+    port = sys.argv[1] if len(sys.argv) > 1 else DEFAULT_USB_PORT
+    with serial.Serial(port, timeout=0.1) as ser:
+        ser.write(b'SPITRACE=1\n')
+        input("[*] trace is running, press Enter to dump it ...")
+        entries, lost = parse(read_dump(ser))
+    report(entries, lost)
+
+
+if __name__ == '__main__':
+    main()
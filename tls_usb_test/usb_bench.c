@@ -0,0 +1,345 @@
+/* usb_bench.c
+ * Host side of the USBBENCH command: transport throughput and round-trip
+ * latency of the devkit CDC data port, without any crypto involved.
+ *
+ * Console port (plain text mode) carries the command and the device
+ * counters, data port carries the benchmark data. Pattern byte at stream
+ * offset n is (n & 0xFF), same as in firmware.
+ *
+ * Usage: ./usb_bench [-c console] [-d data] [-n bytes] [-s echo_block]
+ *                    [-r echo_rounds] [source|sink|echo|all]
+ */
+
+#include "usb_mux.h" /* mux_crc16(), same CRC16 as firmware */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+#define DATA_CHUNK      4096
+#define IO_TIMEOUT_MS   2000
+
+static const char *console_dev = "/dev/ttyACM0";
+static const char *data_dev = "/dev/ttyACM1";
+static size_t total = 1024 * 1024;
+static size_t echo_block = 64;
+static int echo_rounds = 1000;
+
+static double now_us(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static int open_raw(const char *dev)
+{
+    struct termios tio;
+    int fd;
+
+    fd = open(dev, O_RDWR | O_NOCTTY);
+    if (fd < 0)
+        return -1;
+
+    if (tcgetattr(fd, &tio) == 0) {
+        cfmakeraw(&tio);
+        tio.c_cc[VMIN] = 0;
+        tio.c_cc[VTIME] = 0;
+        tcsetattr(fd, TCSANOW, &tio);
+    }
+    tcflush(fd, TCIOFLUSH);
+    return fd;
+}
+
+static int write_all(int fd, const uint8_t *data, size_t len)
+{
+    ssize_t n;
+
+    while (len > 0) {
+        n = write(fd, data, len);
+        if (n < 0) {
+            if (errno == EINTR || errno == EAGAIN)
+                continue;
+            return -1;
+        }
+        data += n;
+        len -= n;
+    }
+    return 0;
+}
+
+/* Reads up to len bytes, waits at most timeout_ms for the first of them.
+ * Returns number of bytes, 0 on timeout, -1 on error. */
+static ssize_t read_timeout(int fd, uint8_t *buf, size_t len, int timeout_ms)
+{
+    struct pollfd pfd = { .fd = fd, .events = POLLIN };
+    ssize_t n;
+    int ret;
+
+    ret = poll(&pfd, 1, timeout_ms);
+    if (ret <= 0)
+        return (ret < 0 && errno != EINTR) ? -1 : 0;
+
+    n = read(fd, buf, len);
+    if (n < 0)
+        return (errno == EAGAIN || errno == EINTR) ? 0 : -1;
+    return n;
+}
+
+/* Collects console output until it contains needle or "ERROR".
+ * Returns 0 when needle was found. */
+static int console_wait(int fd, const char *needle, char *out, size_t size)
+{
+    size_t pos = 0;
+    ssize_t n;
+
+    out[0] = '\0';
+    while (pos < size - 1) {
+        n = read_timeout(fd, (uint8_t *)&out[pos], size - 1 - pos, IO_TIMEOUT_MS);
+        if (n <= 0)
+            break;
+        pos += n;
+        out[pos] = '\0';
+        if (strstr(out, needle) != NULL)
+            return 0;
+        if (strstr(out, "ERROR") != NULL)
+            break;
+    }
+    fprintf(stderr, "[-] no \"%s\" from device: %s\n", needle, out);
+    return -1;
+}
+
+/* Sends the command, for sink/echo waits until the device listens */
+static int bench_start(int con, int mode, size_t len)
+{
+    char line[256];
+
+    snprintf(line, sizeof(line), "USBBENCH=%d,%zu\r\n", mode, len);
+    if (write_all(con, (const uint8_t *)line, strlen(line)) < 0)
+        return -1;
+    if (mode == 0)
+        return 0;
+    return console_wait(con, "READY", line, sizeof(line));
+}
+
+/* Prints the device result line "USBBENCH: <bytes>, <us>, ..." */
+static int bench_result(int con, unsigned *crc)
+{
+    char out[512];
+    char *p, *eol;
+
+    if (console_wait(con, "OK", out, sizeof(out)) < 0)
+        return -1;
+
+    p = strstr(out, "USBBENCH: ");
+    while (p != NULL && strncmp(p, "USBBENCH: READY", 15) == 0)
+        p = strstr(p + 1, "USBBENCH: ");
+    if (p == NULL)
+        return -1;
+    eol = strpbrk(p, "\r\n");
+    if (eol != NULL)
+        *eol = '\0';
+    printf("    device: %s\n", p + 10);
+    printf("            (bytes, us, KB/s, retries, rx calls, drops, crc)\n");
+
+    if (crc != NULL) {
+        p = strrchr(p, ',');
+        if (p == NULL)
+            return -1;
+        *crc = (unsigned)strtoul(p + 1, NULL, 16);
+    }
+    return 0;
+}
+
+static void print_rate(const char *name, size_t bytes, double us)
+{
+    printf("[*] %-6s %zu bytes in %.1f ms = %.3f MB/s\n",
+           name, bytes, us / 1000.0, (us > 0) ? bytes / us : 0.0);
+}
+
+static int bench_source(int con, int dat)
+{
+    static uint8_t buf[DATA_CHUNK];
+    size_t received = 0, errors = 0, i;
+    double t0 = 0, t1 = 0;
+    ssize_t n;
+
+    if (bench_start(con, 0, total) < 0)
+        return -1;
+
+    while (received < total) {
+        n = read_timeout(dat, buf, sizeof(buf), IO_TIMEOUT_MS);
+        if (n <= 0)
+            break;
+        if (received == 0)
+            t0 = now_us();
+        t1 = now_us();
+        for (i = 0; i < (size_t)n; i++)
+            if (buf[i] != (uint8_t)(received + i))
+                errors++;
+        received += n;
+    }
+
+    print_rate("source", received, t1 - t0);
+    if (errors)
+        printf("[!] %zu pattern errors\n", errors);
+    return (bench_result(con, NULL) < 0 || received != total) ? -1 : 0;
+}
+
+static int bench_sink(int con, int dat)
+{
+    static uint8_t buf[DATA_CHUNK];
+    size_t sent = 0, l, i;
+    uint16_t crc = 0;
+    unsigned dev_crc;
+    double t0;
+
+    for (i = 0; i < sizeof(buf); i++)
+        buf[i] = (uint8_t)i;
+
+    if (bench_start(con, 1, total) < 0)
+        return -1;
+
+    t0 = now_us();
+    while (sent < total) {
+        l = (total - sent > sizeof(buf)) ? sizeof(buf) : total - sent;
+        if (write_all(dat, buf, l) < 0)
+            break;
+        crc = mux_crc16(crc, buf, l);
+        sent += l;
+    }
+    tcdrain(dat);
+    print_rate("sink", sent, now_us() - t0);
+
+    if (bench_result(con, &dev_crc) < 0)
+        return -1;
+    if (dev_crc != crc) {
+        printf("[!] CRC mismatch, host %04X device %04X\n", crc, dev_crc);
+        return -1;
+    }
+    return 0;
+}
+
+static int cmp_double(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static double percentile(const double *sorted, int count, int p)
+{
+    int idx = (int)((p / 100.0) * (count - 1) + 0.5);
+    return sorted[idx];
+}
+
+static int bench_echo(int con, int dat)
+{
+    static uint8_t tx[DATA_CHUNK], rx[DATA_CHUNK];
+    double *samples, t0;
+    size_t got, i;
+    ssize_t n;
+    int round, done = 0;
+
+    if (echo_block > sizeof(tx))
+        echo_block = sizeof(tx);
+    samples = calloc(echo_rounds, sizeof(double));
+    if (samples == NULL)
+        return -1;
+
+    if (bench_start(con, 2, echo_block * echo_rounds) < 0) {
+        free(samples);
+        return -1;
+    }
+
+    for (round = 0; round < echo_rounds; round++) {
+        for (i = 0; i < echo_block; i++)
+            tx[i] = (uint8_t)(round * echo_block + i);
+
+        t0 = now_us();
+        if (write_all(dat, tx, echo_block) < 0)
+            break;
+        for (got = 0; got < echo_block; got += n) {
+            n = read_timeout(dat, &rx[got], echo_block - got, IO_TIMEOUT_MS);
+            if (n <= 0)
+                break;
+        }
+        if (got != echo_block || memcmp(tx, rx, echo_block) != 0) {
+            printf("[!] echo mismatch in round %d\n", round);
+            break;
+        }
+        samples[done++] = now_us() - t0;
+    }
+
+    if (done > 0) {
+        qsort(samples, done, sizeof(double), cmp_double);
+        printf("[*] echo   %d x %zu bytes round trip: min %.0f us, p50 %.0f us, "
+               "p90 %.0f us, p99 %.0f us, max %.0f us\n",
+               done, echo_block, samples[0], percentile(samples, done, 50),
+               percentile(samples, done, 90), percentile(samples, done, 99),
+               samples[done - 1]);
+    }
+    free(samples);
+    return (bench_result(con, NULL) < 0 || done != echo_rounds) ? -1 : 0;
+}
+
+static void usage(const char *name)
+{
+    fprintf(stderr, "Usage: %s [-c console] [-d data] [-n bytes] [-s echo_block] "
+            "[-r echo_rounds] [source|sink|echo|all]\n", name);
+}
+
+int main(int argc, char **argv)
+{
+    const char *mode = "all";
+    int con, dat, opt, ret = 0;
+
+    while ((opt = getopt(argc, argv, "c:d:n:s:r:h")) != -1) {
+        switch (opt) {
+        case 'c': console_dev = optarg; break;
+        case 'd': data_dev = optarg; break;
+        case 'n': total = strtoul(optarg, NULL, 0); break;
+        case 's': echo_block = strtoul(optarg, NULL, 0); break;
+        case 'r': echo_rounds = atoi(optarg); break;
+        default:
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (optind < argc)
+        mode = argv[optind];
+    if (total == 0 || echo_block == 0 || echo_rounds <= 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    con = open_raw(console_dev);
+    if (con < 0) {
+        perror(console_dev);
+        return 1;
+    }
+    dat = open_raw(data_dev);
+    if (dat < 0) {
+        perror(data_dev);
+        close(con);
+        return 1;
+    }
+    printf("[+] console %s, data %s\n", console_dev, data_dev);
+
+    if (!strcmp(mode, "source") || !strcmp(mode, "all"))
+        ret |= bench_source(con, dat);
+    if (!strcmp(mode, "sink") || !strcmp(mode, "all"))
+        ret |= bench_sink(con, dat);
+    if (!strcmp(mode, "echo") || !strcmp(mode, "all"))
+        ret |= bench_echo(con, dat);
+
+    close(dat);
+    close(con);
+    return ret ? 1 : 0;
+}
@@ -0,0 +1,221 @@
+/* usb_mux.c
+ * Host side of the devkit binary framed (MUX) mode.
+ */
+
+#define _GNU_SOURCE /* memmem */
+#include "usb_mux.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+
+enum {
+    RX_SYNC = 0,
+    RX_CHANNEL,
+    RX_LEN_LSB,
+    RX_LEN_MSB,
+    RX_DATA,
+    RX_CRC_LSB,
+    RX_CRC_MSB,
+};
+
+uint16_t mux_crc16(uint16_t crc, const uint8_t *data, size_t len)
+{
+    int i;
+
+    while (len--) {
+        crc ^= (uint16_t)(*data++) << 8;
+        for (i = 0; i < 8; i++)
+            crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x8005) : (uint16_t)(crc << 1);
+    }
+    return crc;
+}
+
+void mux_parser_init(mux_parser_t *p)
+{
+    memset(p, 0, sizeof(*p));
+}
+
+void mux_parser_feed(mux_parser_t *p, const uint8_t *buf, size_t len,
+                     mux_frame_cb cb, void *ctx)
+{
+    size_t l;
+
+    while (len > 0) {
+        switch (p->state) {
+        case RX_SYNC:
+            if (*buf == MUX_SYNC)
+                p->state = RX_CHANNEL;
+            break;
+        case RX_CHANNEL:
+            p->hdr[0] = *buf;
+            p->state = RX_LEN_LSB;
+            break;
+        case RX_LEN_LSB:
+            p->hdr[1] = *buf;
+            p->state = RX_LEN_MSB;
+            break;
+        case RX_LEN_MSB:
+            p->hdr[2] = *buf;
+            p->len = p->hdr[1] | (p->hdr[2] << 8);
+            p->pos = 0;
+            if (p->len > MUX_FRAME_MAX) {
+                p->errors++;
+                p->state = RX_SYNC;
+            } else {
+                p->state = (p->len > 0) ? RX_DATA : RX_CRC_LSB;
+            }
+            break;
+        case RX_DATA:
+            l = p->len - p->pos;
+            if (l > len)
+                l = len;
+            memcpy(&p->data[p->pos], buf, l);
+            p->pos += l;
+            buf += l;
+            len -= l;
+            if (p->pos == p->len)
+                p->state = RX_CRC_LSB;
+            continue;
+        case RX_CRC_LSB:
+            p->crc = *buf;
+            p->state = RX_CRC_MSB;
+            break;
+        case RX_CRC_MSB:
+            p->crc |= *buf << 8;
+            p->state = RX_SYNC;
+            if (mux_crc16(mux_crc16(0, p->hdr, 3), p->data, p->len) != p->crc) {
+                p->errors++;
+                break;
+            }
+            if (cb != NULL)
+                cb(ctx, p->hdr[0], p->data, p->len);
+            break;
+        }
+        buf++;
+        len--;
+    }
+}
+
+static int write_all(int fd, const uint8_t *data, size_t len)
+{
+    ssize_t n;
+
+    while (len > 0) {
+        n = write(fd, data, len);
+        if (n < 0) {
+            if (errno == EINTR || errno == EAGAIN)
+                continue;
+            return -1;
+        }
+        data += n;
+        len -= n;
+    }
+    return 0;
+}
+
+int mux_send(int fd, uint8_t ch, const void *data, size_t len)
+{
+    static uint8_t frame[4 + MUX_FRAME_MAX + 2];
+    const uint8_t *src = data;
+    size_t l;
+    uint16_t crc;
+
+    do {
+        l = (len > MUX_FRAME_MAX) ? MUX_FRAME_MAX : len;
+        frame[0] = MUX_SYNC;
+        frame[1] = ch;
+        frame[2] = l & 0xFF;
+        frame[3] = l >> 8;
+        memcpy(&frame[4], src, l);
+        crc = mux_crc16(0, &frame[1], 3 + l);
+        frame[4 + l] = crc & 0xFF;
+        frame[5 + l] = crc >> 8;
+        if (write_all(fd, frame, 6 + l) < 0)
+            return -1;
+        src += l;
+        len -= l;
+    } while (len > 0);
+
+    return 0;
+}
+
+int mux_poll(int fd, mux_parser_t *p, int timeout_ms, mux_frame_cb cb, void *ctx)
+{
+    uint8_t buf[4096];
+    struct pollfd pfd = { .fd = fd, .events = POLLIN };
+    ssize_t n;
+    int ret;
+
+    ret = poll(&pfd, 1, timeout_ms);
+    if (ret <= 0)
+        return (ret < 0 && errno != EINTR) ? -1 : 0;
+
+    n = read(fd, buf, sizeof(buf));
+    if (n < 0)
+        return (errno == EAGAIN || errno == EINTR) ? 0 : -1;
+
+    mux_parser_feed(p, buf, n, cb, ctx);
+    return (int)n;
+}
+
+static void open_cb(void *ctx, uint8_t ch, const uint8_t *data, size_t len)
+{
+    if (ch == MUX_CH_CONSOLE && len >= 2 && memmem(data, len, "OK", 2) != NULL)
+        *(int *)ctx = 1;
+}
+
+int mux_open(const char *dev)
+{
+    static const char cmd[] = "MUX=1\r\n";
+    static mux_parser_t parser;
+    struct termios tio;
+    int fd, attempt, ms, ok = 0;
+
+    fd = open(dev, O_RDWR | O_NOCTTY);
+    if (fd < 0)
+        return -1;
+
+    if (tcgetattr(fd, &tio) == 0) {
+        cfmakeraw(&tio);
+        tio.c_cc[VMIN] = 0;
+        tio.c_cc[VTIME] = 0;
+        tcsetattr(fd, TCSANOW, &tio);
+    }
+
+    /* Text mode firmware answers "OK" and switches, framed firmware drops
+     * bytes outside of frames. Then ask once more framed, this time the
+     * "OK" must come back in a console frame either way. */
+    write_all(fd, (const uint8_t *)"\r\n" "MUX=1\r\n", 9);
+    usleep(50000);
+    tcflush(fd, TCIFLUSH);
+
+    mux_parser_init(&parser);
+    for (attempt = 0; attempt < 3 && !ok; attempt++) {
+        if (mux_send(fd, MUX_CH_CONSOLE, cmd, sizeof(cmd) - 1) < 0)
+            break;
+        for (ms = 0; ms < 500 && !ok; ms += 10) {
+            if (mux_poll(fd, &parser, 10, open_cb, &ok) < 0)
+                break;
+        }
+    }
+
+    if (!ok) {
+        close(fd);
+        errno = ETIMEDOUT;
+        return -1;
+    }
+    return fd;
+}
+
+void mux_close(int fd)
+{
+    static const char cmd[] = "MUX=0\r\n";
+
+    mux_send(fd, MUX_CH_CONSOLE, cmd, sizeof(cmd) - 1);
+    tcdrain(fd);
+    close(fd);
+}
@@ -0,0 +1,60 @@
+/* usb_mux.h
+ * Host side of the devkit binary framed (MUX) mode, see API.md.
+ *
+ * Frame: SYNC (0xA5), channel, length (LSB first), payload, CRC16 (LSB first).
+ * CRC16 (poly 0x8005, init 0, same as TROPIC01 L2) covers channel, length
+ * and payload.
+ */
+
+#ifndef USB_MUX_H
+#define USB_MUX_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define MUX_SYNC       0xA5
+#define MUX_FRAME_MAX  2048  /* maximum payload, same as TTY_FRAME_MAX in firmware */
+
+enum {
+    MUX_CH_CONSOLE   = 0,
+    MUX_CH_TLS       = 1,
+    MUX_CH_SPI       = 2,
+    MUX_CH_LOG       = 3,
+    MUX_CH_TELEMETRY = 4,
+};
+
+/* Called for every frame with valid CRC */
+typedef void (*mux_frame_cb)(void *ctx, uint8_t ch, const uint8_t *data, size_t len);
+
+typedef struct {
+    int state;
+    uint8_t hdr[3];
+    uint16_t len;
+    uint16_t pos;
+    uint16_t crc;
+    uint32_t errors;   /* CRC errors and invalid lengths */
+    uint8_t data[MUX_FRAME_MAX];
+} mux_parser_t;
+
+uint16_t mux_crc16(uint16_t crc, const uint8_t *data, size_t len);
+
+void mux_parser_init(mux_parser_t *p);
+void mux_parser_feed(mux_parser_t *p, const uint8_t *buf, size_t len,
+                     mux_frame_cb cb, void *ctx);
+
+/* Opens the CDC device in raw mode and switches the firmware to MUX mode.
+ * Returns file descriptor or -1. */
+int mux_open(const char *dev);
+
+/* Switches the firmware back to text mode and closes the device. */
+void mux_close(int fd);
+
+/* Sends data on a channel, split to frames of MUX_FRAME_MAX.
+ * Returns 0 or -1 on write error. */
+int mux_send(int fd, uint8_t ch, const void *data, size_t len);
+
+/* Waits up to timeout_ms for data and feeds them to the parser.
+ * Returns number of bytes read, 0 on timeout, -1 on error. */
+int mux_poll(int fd, mux_parser_t *p, int timeout_ms, mux_frame_cb cb, void *ctx);
+
+#endif /* USB_MUX_H */
@@ -3,16 +3,229 @@ import socket
 import serial
 import select
 import os
+import time
+import tty
 
 # --- Configuration ---
-DEFAULT_USB_PORT = '/dev/ttyACM0' 
+DEFAULT_USB_PORT = '/dev/ttyACM0'   # console interface
+DEFAULT_DATA_PORT = '/dev/ttyACM1'  # TLS data interface
 DEFAULT_HOST = '127.0.0.1'
 DEFAULT_TCP_PORT = 11111
 
+# --- MUX mode (see API.md), same framing as usb_mux.c ---
+MUX_SYNC = 0xA5
+MUX_FRAME_MAX = 2048
+MUX_CH_CONSOLE, MUX_CH_TLS, MUX_CH_SPI, MUX_CH_LOG, MUX_CH_TELEMETRY = range(5)
+
+
+def crc16(data, crc=0):
+    for b in data:
+        crc ^= b << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x8005) & 0xFFFF if crc & 0x8000 else (crc << 1) & 0xFFFF
+    return crc
+
+
+def mux_frame(ch, data):
+    out = b''
+    for i in range(0, max(len(data), 1), MUX_FRAME_MAX):
+        chunk = data[i:i + MUX_FRAME_MAX]
+        hdr = bytes([ch, len(chunk) & 0xFF, len(chunk) >> 8])
+        crc = crc16(hdr + chunk)
+        out += bytes([MUX_SYNC]) + hdr + chunk + bytes([crc & 0xFF, crc >> 8])
+    return out
+
+
+class MuxParser:
+    def __init__(self):
+        self.buf = b''
+        self.errors = 0
+
+    def feed(self, data):
+        """Returns list of (channel, payload) of complete frames with valid CRC."""
+        self.buf += data
+        frames = []
+        while True:
+            start = self.buf.find(bytes([MUX_SYNC]))
+            if start < 0:
+                self.buf = b''
+                break
+            self.buf = self.buf[start:]
+            if len(self.buf) < 4:
+                break
+            length = self.buf[2] | (self.buf[3] << 8)
+            if length > MUX_FRAME_MAX:
+                self.errors += 1
+                self.buf = self.buf[1:]
+                continue
+            if len(self.buf) < 6 + length:
+                break
+            body = self.buf[1:4 + length]
+            crc = self.buf[4 + length] | (self.buf[5 + length] << 8)
+            if crc16(body) != crc:
+                self.errors += 1
+                self.buf = self.buf[1:]
+                continue
+            frames.append((body[0], body[3:]))
+            self.buf = self.buf[6 + length:]
+        return frames
+
+
+class StatsPoller:
+    """Sends STATS=1 every period seconds, prints the reply as one
+    '[stats] name=value ...' line for log collectors. The firmware names
+    every field, new counters show up without changes here."""
+    def __init__(self, period):
+        self.period = period
+        self.next = time.monotonic() + period
+        self.buf = ''
+
+    def due(self):
+        if self.period <= 0 or time.monotonic() < self.next:
+            return False
+        self.next = time.monotonic() + self.period
+        return True
+
+    def feed(self, text):
+        self.buf += text
+        *lines, self.buf = self.buf.split('\n')
+        for line in lines:
+            if not line.startswith('STATS: RESET='):
+                continue  # human readable STATS, not ours
+            pairs = [f.strip() for f in line[len('STATS: '):].split(',')]
+            print(f"[stats] {' '.join(pairs)}")
+
+
+def mux_enable(ser):
+    # text mode firmware replies "OK" and switches, framed firmware drops the line
+    ser.write(b'\r\nMUX=1\r\n')
+    time.sleep(0.05)
+    ser.reset_input_buffer()
+    parser = MuxParser()
+    for _ in range(3):
+        ser.write(mux_frame(MUX_CH_CONSOLE, b'MUX=1\r\n'))
+        deadline = time.monotonic() + 0.5
+        while time.monotonic() < deadline:
+            for ch, payload in parser.feed(ser.read(4096)):
+                if ch == MUX_CH_CONSOLE and b'OK' in payload:
+                    return True
+    return False
+
+
+def run_mux(ser, sock, stats):
+    """Frames are routed by channel, TLS records never mix with text."""
+    parser = MuxParser()
+    inputs = [ser, sock, sys.stdin]
+    while True:
+        if stats.due():
+            ser.write(mux_frame(MUX_CH_CONSOLE, b'STATS=1\r\n'))
+        readable, _, exceptional = select.select(inputs, [], inputs, 0.1)
+        for s in readable:
+            if s is sys.stdin:
+                line = sys.stdin.readline()
+                if line:
+                    ser.write(mux_frame(MUX_CH_CONSOLE, line.encode('utf-8')))
+            elif s is ser:
+                for ch, payload in parser.feed(ser.read(4096)):
+                    if ch == MUX_CH_TLS:
+                        sock.sendall(payload)
+                    elif ch == MUX_CH_CONSOLE:
+                        text = payload.decode('utf-8', errors='replace')
+                        sys.stdout.write(text)
+                        sys.stdout.flush()
+                        stats.feed(text)
+                    elif ch == MUX_CH_LOG:
+                        print(f"[log] {payload.decode('utf-8', errors='replace')}")
+                    else:
+                        print(f"[ch{ch}] {payload.hex().upper()}")
+            elif s is sock:
+                data = sock.recv(4096)
+                if not data:
+                    print("\n[-] TLS Server closed connection")
+                    return
+                ser.write(mux_frame(MUX_CH_TLS, data))
+        if exceptional:
+            print("\n[-] Exception in connection")
+            return
+
+
+def open_data_port(path):
+    fd = os.open(path, os.O_RDWR | os.O_NOCTTY)
+    tty.setraw(fd)
+    return fd
+
+
+def splice_forward(src, dst, pipe, use_splice):
+    """Moves what is readable on src to dst. With splice() the data go through
+    a kernel pipe only and never get copied into the bridge process.
+    Returns number of bytes moved (0 == EOF) and whether splice still works."""
+    if use_splice:
+        try:
+            n = os.splice(src, pipe[1], 65536)
+            left = n
+            while left > 0:
+                left -= os.splice(pipe[0], dst, left)
+            return n, True
+        except OSError:
+            # kernel without splice support for this tty, read/write from now
+            pass
+    data = os.read(src, 65536)
+    view = memoryview(data)
+    while view:
+        view = view[os.write(dst, view):]
+    return len(data), False
+
+
+def run_data(ser, data_fd, sock, stats):
+    """Console on the first CDC interface, TLS records on the second one."""
+    pipe = os.pipe()
+    use_splice = hasattr(os, 'splice')
+    sock_fd = sock.fileno()
+    inputs = [ser, data_fd, sock_fd, sys.stdin]
+    while True:
+        if stats.due():
+            ser.write(b'STATS=1\r\n')
+        readable, _, exceptional = select.select(inputs, [], inputs, 0.1)
+        for s in readable:
+            if s is sys.stdin:
+                line = sys.stdin.readline()
+                if line:
+                    ser.write(line.encode('utf-8'))
+            elif s is ser:
+                data = ser.read(4096)
+                if data:
+                    text = data.decode('utf-8', errors='replace')
+                    sys.stdout.write(text)
+                    sys.stdout.flush()
+                    stats.feed(text)
+            elif s == data_fd:
+                n, use_splice = splice_forward(data_fd, sock_fd, pipe, use_splice)
+                if n == 0:
+                    print("\n[-] TLS data port closed")
+                    return
+            elif s == sock_fd:
+                n, use_splice = splice_forward(sock_fd, data_fd, pipe, use_splice)
+                if n == 0:
+                    print("\n[-] TLS Server closed connection")
+                    return
+        if exceptional:
+            print("\n[-] Exception in connection")
+            return
+
+
 def main():
-    usb_port = sys.argv[1] if len(sys.argv) > 1 else DEFAULT_USB_PORT
-    host = sys.argv[2] if len(sys.argv) > 2 else DEFAULT_HOST
-    port = int(sys.argv[3]) if len(sys.argv) > 3 else DEFAULT_TCP_PORT
+    mux = '--mux' in sys.argv
+    # --stats=<seconds> polls STATS=1 for fleet monitoring
+    period = 0.0
+    for a in sys.argv[1:]:
+        if a.startswith('--stats='):
+            period = float(a[len('--stats='):])
+    stats = StatsPoller(period)
+    args = [a for a in sys.argv[1:] if not a.startswith('--')]
+    usb_port = args[0] if len(args) > 0 else DEFAULT_USB_PORT
+    host = args[1] if len(args) > 1 else DEFAULT_HOST
+    port = int(args[2]) if len(args) > 2 else DEFAULT_TCP_PORT
+    data_port = args[3] if len(args) > 3 else DEFAULT_DATA_PORT
 
     try:
         # 1. Open Serial Port
@@ -23,7 +236,6 @@ def main():
         # 2. Connect to TLS Server
         sock = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
         sock.connect((host, port))
-        sock.setblocking(False)
         print(f"[+] Connected to TLS Server at {host}:{port}")
 
     except Exception as e:
@@ -35,81 +247,33 @@ def main():
     print(f"[*] ALL USB output will be printed to this screen.")
     print("="*60)
 
-    inputs = [ser, sock, sys.stdin]
-    tls_active = False
-    
-    try:
-        while True:
-            readable, _, exceptional = select.select(inputs, [], inputs, 0.1)
-
-            for s in readable:
-                # -----------------------------------------------------------
-                # 1. Keyboard Input -> USB Device
-                # -----------------------------------------------------------
-                if s is sys.stdin:
-                    line = sys.stdin.readline()
-                    if line:
-                        # Send exactly what was typed
-                        ser.write(line.encode('utf-8'))
-                        # print(f"    >>> Sent: {line.strip()}") 
-
-                # -----------------------------------------------------------
-                # 2. USB Device -> TCP Server (AND Screen)
-                # -----------------------------------------------------------
-                elif s is ser:
-                    try:
-                        data = ser.read(4096)
-                        if data:
-                            # A. ALWAYS print to screen (Safe decoding)
-                            # We use 'replace' so binary bytes become '?' instead of crashing
-                            text_view = data.decode('utf-8', errors='replace')
-                            sys.stdout.flush()
-                            if "DEBUG:" in data.decode("utf-8", "ignore"):
-                                print(data)
-                                print("works")
-                                continue
-
-                            # B. Forwarding Logic
-                            if tls_active:
-                                # Forward everything once TLS has started
-                                sock.sendall(data)
-                            else:
-                                # Check for TLS ClientHello (0x16) to engage bridge
-                                if b'\x16' in data:
-                                    print(f"\n[+] TLS Handshake detected! Forwarding to Server...")
-                                    tls_active = True
-                                    
-                                    # Forward only the binary part (skip echoed text)
-                                    start_index = data.find(b'\x16')
-                                    sock.sendall(data[start_index:])
-                    except Exception as e:
-                        print(f"\n[!] Error reading Serial: {e}")
-                        return
-
-                # -----------------------------------------------------------
-                # 3. TCP Server -> USB Device
-                # -----------------------------------------------------------
-                elif s is sock:
-                    try:
-                        data = sock.recv(4096)
-                        if not data:
-                            print("\n[-] TLS Server closed connection")
-                            return
-                        
-                        # Forward to USB
-                        ser.write(data)
-                        print(f"[< TCP Data: {len(data)} bytes forwarded to USB >]")
-                    except Exception as e:
-                        print(f"\n[!] Error reading Socket: {e}")
-                        return
-
-            if exceptional:
-                print("\n[-] Exception in connection")
-                break
+    if mux:
+        if not mux_enable(ser):
+            print("[-] Device did not switch to MUX mode")
+            return
+        print("[+] MUX mode, TLS channel forwarded to server")
+        try:
+            run_mux(ser, sock, stats)
+        except KeyboardInterrupt:
+            print("\n[*] Stopping bridge...")
+        finally:
+            ser.write(mux_frame(MUX_CH_CONSOLE, b'MUX=0\r\n'))
+            ser.close()
+            sock.close()
+        return
 
+    data_fd = None
+    try:
+        data_fd = open_data_port(data_port)
+        print(f"[+] Opened TLS data port {data_port}")
+        run_data(ser, data_fd, sock, stats)
     except KeyboardInterrupt:
         print("\n[*] Stopping bridge...")
+    except OSError as e:
+        print(f"\n[-] {e}")
     finally:
+        if data_fd is not None:
+            os.close(data_fd)
         ser.close()
         sock.close()
 
@@ -0,0 +1,182 @@
+/**
+  ******************************************************************************
+  * @file    usb_bench.c
+  * @author  Tropicsquare
+  * @brief   USB CDC data interface throughput and latency benchmark
+  *
+  * Runs on the second CDC-ACM interface, console stays free for the command
+  * and its result. Pattern byte at stream offset n is (n & 0xFF).
+  *   source: device writes pattern as fast as the stack accepts it
+  *   sink:   device reads data, CRC16 of them is reported
+  *   echo:   every received block is written back, for round-trip time
+  * Host tool: tls_usb_test/usb_bench.c
+  ******************************************************************************
+  */
+
+#include "usb_bench.h"
+#include "usb_device.h"
+
+#include "arena.h"
+#include "common.h"
+#include "crc16.h"
+#include "time.h"
+#include "wd.h"
+
+#define USB_BENCH_CHUNK       (4096)               // bytes per write, multiple of max packet size
+#define USB_BENCH_TIMEOUT     (OS_TIMER_SECOND)    // no progress, host not reading or writing
+
+#define _MIN(a, b)            (((a) < (b)) ? (a) : (b))
+
+static u8 *_tx_buffer;      // USB_BENCH_CHUNK each, RAM arena during benchmark
+static u8 *_rx_buffer;
+static u32 _rx_len;
+static u64 _rx_start;
+static usb_bench_result_t *_result;
+static usb_cdc_rx_pfunc_t _saved_rx_handler;
+
+static void _bench_rx_handler(u8 *data, u32 len)
+{   // called from usb_device_task() inside of the benchmark loop
+    u32 l;
+
+    if (_result == NULL)
+        return;
+
+    _result->rx_calls++;
+    if (_result->rx_calls == 1)
+        _rx_start = os_timer_get_time();
+
+    if (_rx_len == (u32)-1)
+    {   // sink, data are not stored
+        _result->crc = crc16_update(_result->crc, data, len);
+        _result->bytes += len;
+        return;
+    }
+
+    l = _MIN(len, USB_BENCH_CHUNK - _rx_len);
+    memcpy(&_rx_buffer[_rx_len], data, l);
+    _rx_len += l;
+    _result->drops += len - l;
+}
+
+static bool _bench_source(u32 len, usb_bench_result_t *result)
+{
+    u64 start, last;
+    u64 now;
+    u32 l;
+    u32 i;
+
+    for (i = 0; i < USB_BENCH_CHUNK; i++)
+        _tx_buffer[i] = (u8)i;
+
+    start = os_timer_get_time();
+    last = start;
+    while (result->bytes < len)
+    {
+        l = _MIN(len - result->bytes, USB_BENCH_CHUNK);
+
+        usb_device_task();
+        now = os_timer_get_time();
+        if (usb_cdc_data_tx(_tx_buffer, (u16)l) == USB_RESULT_OK)
+        {
+            result->bytes += l;
+            last = now;
+        }
+        else
+        {
+            result->retries++;
+            if ((now - last) > USB_BENCH_TIMEOUT)
+                break;
+        }
+        wd_feed();
+    }
+    result->time_us = (u32)(os_timer_get_time() - start);
+
+    return (result->bytes == len);
+}
+
+static bool _bench_sink_echo(usb_bench_mode_e mode, u32 len, usb_bench_result_t *result)
+{
+    u64 last;
+    u64 now;
+    u32 received;
+    u32 tx_len = 0;
+
+    _rx_len = (mode == USB_BENCH_SINK) ? (u32)-1 : 0;
+    _result = result;
+
+    last = os_timer_get_time();
+    while (result->bytes < len)
+    {
+        received = result->rx_calls;
+        usb_device_task();
+        now = os_timer_get_time();
+        if (result->rx_calls != received)
+            last = now;
+
+        if (mode == USB_BENCH_ECHO)
+        {
+            if ((tx_len == 0) && (_rx_len > 0))
+            {   // RX buffer keeps filling while this block is being sent
+                memcpy(_tx_buffer, _rx_buffer, _rx_len);
+                tx_len = _rx_len;
+                _rx_len = 0;
+            }
+            if (tx_len > 0)
+            {
+                if (usb_cdc_data_tx(_tx_buffer, (u16)tx_len) == USB_RESULT_OK)
+                {
+                    result->bytes += tx_len;
+                    tx_len = 0;
+                    last = now;
+                }
+                else
+                {
+                    result->retries++;
+                }
+            }
+        }
+
+        if ((now - last) > USB_BENCH_TIMEOUT)
+            break;
+        wd_feed();
+    }
+    _result = NULL;
+
+    if (result->rx_calls > 0)
+        result->time_us = (u32)(os_timer_get_time() - _rx_start);
+
+    return (result->bytes >= len);
+}
+
+bool usb_bench_start(usb_bench_mode_e mode)
+{
+    if ((mode >= USB_BENCH_MODES) || (! usb_cdc_data_connected()))
+        return (false);
+    if (! arena_enter(ARENA_USB_BENCH))
+        return (false);
+    _tx_buffer = arena_alloc(ARENA_USB_BENCH, USB_BENCH_CHUNK);
+    _rx_buffer = arena_alloc(ARENA_USB_BENCH, USB_BENCH_CHUNK);
+
+    // data arriving from now on belong to the benchmark, not to TLS
+    _result = NULL;
+    _saved_rx_handler = usb_cdc_data_rx_handler();
+    usb_cdc_data_rx_init(_bench_rx_handler);
+    return (true);
+}
+
+bool usb_bench_run(usb_bench_mode_e mode, u32 len, usb_bench_result_t *result)
+{
+    bool ok;
+
+    memset(result, 0, sizeof(*result));
+    result->crc = CRC16_INIT;
+
+    if (mode == USB_BENCH_SOURCE)
+        ok = _bench_source(len, result);
+    else
+        ok = _bench_sink_echo(mode, len, result);
+
+    usb_cdc_data_rx_init(_saved_rx_handler);
+    arena_leave(ARENA_USB_BENCH);
+    return (ok);
+}
@@ -0,0 +1,44 @@
+/**
+  ******************************************************************************
+  * @file    usb_bench.h
+  * @author  Tropicsquare
+  * @brief   USB CDC data interface throughput and latency benchmark
+  ******************************************************************************
+  */
+
+#ifndef USB_BENCH_H
+#define USB_BENCH_H
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+#include "type.h"
+
+typedef enum {
+    USB_BENCH_SOURCE = 0, // device streams pattern to host
+    USB_BENCH_SINK   = 1, // device receives and checksums data from host
+    USB_BENCH_ECHO   = 2, // device returns received data
+    USB_BENCH_MODES
+} usb_bench_mode_e;
+
+typedef struct {
+    u32 bytes;   // source: accepted by USB stack, sink: received, echo: returned
+    u32 time_us; // first to last transferred byte
+    u32 retries; // TX attempts returned busy, host not taking IN packets yet
+    u32 rx_calls;// RX callbacks, i.e. transfers completed on OUT endpoint
+    u32 drops;   // echo: bytes lost because host sent faster than it read
+    u16 crc;     // sink: CRC16 of received data
+} usb_bench_result_t;
+
+// takes over data port RX from TLS and RAM arena for the buffers, true when
+// host has the port open and no other mode owns the arena
+bool usb_bench_start(usb_bench_mode_e mode);
+// runs until len bytes are done or 1 s without progress, gives RX back
+bool usb_bench_run(usb_bench_mode_e mode, u32 len, usb_bench_result_t *result);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ! USB_BENCH_H
@@ -12,6 +12,9 @@
 #include "sys.h"
 #include "log.h"
 #include "irq.h"
+#include "event.h"
+#include "prof.h"
+#include "stats.h"
 
 #include "ux_api.h"
 #include "ux_dcd_stm32.h"
@@ -23,15 +26,51 @@ LOG_DEF("USB");
 
 PCD_HandleTypeDef hpcd_usb_drd_fs;
 
-#define USB_MEM_POOL_SIZE      (8*1024)
+#define USB_MEM_POOL_SIZE      (12*1024) // two CDC ACM instances
 
 static u32 usb_mem_pool_buffer[USB_MEM_POOL_SIZE/sizeof(u32)];
 
-static ULONG cdc_acm_interface_number;
-static ULONG cdc_acm_configuration_number;
-static UX_SLAVE_CLASS_CDC_ACM_PARAMETER cdc_acm_parameter;
+static UX_SLAVE_CLASS_CDC_ACM_PARAMETER cdc_acm_parameter[USB_CDC_PORTS];
+
+#define USB_PMA_SIZE           (2048) // USB DRD FS packet memory
+#define USB_PMA_EP_COUNT       (7)    // EP0..EP6
+#define USB_PMA_BTABLE_SIZE    (8*USB_PMA_EP_COUNT) // buffer descriptor table at PMA start
+
+typedef struct {
+    u8 ep_addr;
+    u8 kind;   // PCD_SNG_BUF or PCD_DBL_BUF
+    u16 size;  // max packet size
+} usb_pma_ep_t;
+
+// bulk data endpoints are double buffered: host fills (or drains) one buffer
+// while firmware works with the other one, so it is not NAKed in between.
+// Double buffering takes both buffer descriptors of the EPnR for one
+// direction, so every double buffered endpoint has its own number.
+static const usb_pma_ep_t _USB_PMA_LAYOUT[] = {
+    {0x00,                          PCD_SNG_BUF, USBD_MAX_EP0_SIZE},
+    {0x80,                          PCD_SNG_BUF, USBD_MAX_EP0_SIZE},
+    {USBD_CDCACM_EPOUT_ADDR,        PCD_DBL_BUF, USBD_CDCACM_EPOUT_FS_MPS},   // console data
+    {USBD_CDCACM_EPIN_ADDR,         PCD_DBL_BUF, USBD_CDCACM_EPIN_FS_MPS},
+    {USBD_CDCACM_EPINCMD_ADDR,      PCD_SNG_BUF, USBD_CDCACM_EPINCMD_FS_MPS}, // console notification
+    {USBD_CDCACM_DATA_EPOUT_ADDR,   PCD_DBL_BUF, USBD_CDCACM_EPOUT_FS_MPS},   // TLS data
+    {USBD_CDCACM_DATA_EPIN_ADDR,    PCD_DBL_BUF, USBD_CDCACM_EPIN_FS_MPS},
+    {USBD_CDCACM_DATA_EPINCMD_ADDR, PCD_SNG_BUF, USBD_CDCACM_EPINCMD_FS_MPS}, // TLS notification
+};
+
 static UINT usbd_change_function(ULONG Device_State);
 
+static usb_result_e _usb_tx_result(bool ok, u16 len)
+{   // counted for STATS, BUSY means the caller tries again
+    if (! ok)
+    {
+        STATS_INC(STATS_USB_TX_BUSY);
+        return (USB_RESULT_BUSY);
+    }
+    STATS_INC(STATS_USB_TX_PACKETS);
+    STATS_ADD(STATS_USB_TX_BYTES, len);
+    return (USB_RESULT_OK);
+}
+
 void HAL_PCD_MspInit(PCD_HandleTypeDef* hpcd)
 {
     if (hpcd->Instance == USB_DRD_FS)
@@ -52,7 +91,7 @@ static void _usb_drd_fs_pcd_init(void)
     hpcd_usb_drd_fs.Init.lpm_enable = DISABLE;
     hpcd_usb_drd_fs.Init.battery_charging_enable = DISABLE;
     hpcd_usb_drd_fs.Init.vbus_sensing_enable = DISABLE;
-    hpcd_usb_drd_fs.Init.bulk_doublebuffer_enable = DISABLE;
+    hpcd_usb_drd_fs.Init.bulk_doublebuffer_enable = ENABLE;
     hpcd_usb_drd_fs.Init.iso_singlebuffer_enable = DISABLE;
 
     if (HAL_PCD_Init(&hpcd_usb_drd_fs) != HAL_OK)
@@ -61,6 +100,62 @@ static void _usb_drd_fs_pcd_init(void)
     }
 }
 
+static bool _usb_pma_init(void)
+{   // place buffers of all endpoints one after another behind the descriptor table
+    u32 addr = USB_PMA_BTABLE_SIZE;
+    u32 size;
+    u32 i;
+
+    for (i = 0; i < (sizeof(_USB_PMA_LAYOUT)/sizeof(_USB_PMA_LAYOUT[0])); i++)
+    {
+        const usb_pma_ep_t *ep = &_USB_PMA_LAYOUT[i];
+
+        size = (ep->size + 3) & ~3; // PMA is accessed by 32-bit words
+        if ((addr + ((ep->kind == PCD_DBL_BUF) ? 2*size : size)) > USB_PMA_SIZE)
+            return (false);
+
+        if (ep->kind == PCD_DBL_BUF)
+        {   // buffer 0 address in lower, buffer 1 address in upper half-word
+            HAL_PCDEx_PMAConfig(&hpcd_usb_drd_fs, ep->ep_addr, PCD_DBL_BUF, addr | ((addr + size) << 16));
+            addr += 2*size;
+        }
+        else
+        {
+            HAL_PCDEx_PMAConfig(&hpcd_usb_drd_fs, ep->ep_addr, PCD_SNG_BUF, addr);
+            addr += size;
+        }
+    }
+    return (true);
+}
+
+static bool _usb_cdc_register(usb_cdc_port_e port, VOID (*activate)(VOID *))
+{
+    ULONG interface_number;
+    ULONG configuration_number;
+
+    // Initialize the cdc acm class parameters for the device
+    cdc_acm_parameter[port].ux_slave_class_cdc_acm_instance_activate   = activate;
+    cdc_acm_parameter[port].ux_slave_class_cdc_acm_instance_deactivate = ux_device_cdc_acm_deactivate;
+    cdc_acm_parameter[port].ux_slave_class_cdc_acm_parameter_change    = ux_device_cdc_acm_parameterchange;
+
+    // Get cdc acm configuration number
+    configuration_number = USBD_Get_Configuration_Number(CLASS_TYPE_CDC_ACM, port);
+
+    // Find cdc acm interface number, InterfaceType is the CDC port
+    interface_number = USBD_Get_Interface_Number(CLASS_TYPE_CDC_ACM, port);
+
+    // Initialize the device cdc acm class
+    if (ux_device_stack_class_register(_ux_system_slave_class_cdc_acm_name,
+                                     ux_device_class_cdc_acm_entry,
+                                     configuration_number,
+                                     interface_number,
+                                     &cdc_acm_parameter[port]) != UX_SUCCESS)
+    {
+        return false;
+    }
+    return true;
+}
+
 static bool _usb_cdc_init(void)
 {
     u8 *device_framework_high_speed;
@@ -104,28 +199,11 @@ static bool _usb_cdc_init(void)
         return false;
     }
 
-    // Initialize the cdc acm class parameters for the device
-    cdc_acm_parameter.ux_slave_class_cdc_acm_instance_activate   = ux_device_cdc_acm_activate;
-    cdc_acm_parameter.ux_slave_class_cdc_acm_instance_deactivate = ux_device_cdc_acm_deactivate;
-    cdc_acm_parameter.ux_slave_class_cdc_acm_parameter_change    = ux_device_cdc_acm_parameterchange;
-
-    // Get cdc acm configuration number
-    cdc_acm_configuration_number = USBD_Get_Configuration_Number(CLASS_TYPE_CDC_ACM, 0);
-
-    // Find cdc acm interface number 
-    cdc_acm_interface_number = USBD_Get_Interface_Number(CLASS_TYPE_CDC_ACM, 0);
-
-    // Initialize the device cdc acm class
-    if (ux_device_stack_class_register(_ux_system_slave_class_cdc_acm_name,
-                                     ux_device_class_cdc_acm_entry,
-                                     cdc_acm_configuration_number,
-                                     cdc_acm_interface_number,
-                                     &cdc_acm_parameter) != UX_SUCCESS)
-    {
+    // console interface keeps first /dev/ttyACM, TLS data interface is the second one
+    if (! _usb_cdc_register(USB_CDC_CONSOLE, ux_device_cdc_acm_activate))
         return false;
-    }
 
-    return true;
+    return (_usb_cdc_register(USB_CDC_DATA, ux_device_cdc_acm_data_activate));
 }
 
 
@@ -137,11 +215,10 @@ void usb_device_init(void)
     {
         LOG_ERROR("CDC init failed");
     }
-    HAL_PCDEx_PMAConfig(&hpcd_usb_drd_fs, 0x00, PCD_SNG_BUF, 0x14);  // 0x00 = EP0 OUT
-    HAL_PCDEx_PMAConfig(&hpcd_usb_drd_fs, 0x80, PCD_SNG_BUF, 0x54);  // 0x80 = EP0 IN
-    HAL_PCDEx_PMAConfig(&hpcd_usb_drd_fs, 0x81, PCD_SNG_BUF, 0x94);  // 0x81 = EP1 IN
-    HAL_PCDEx_PMAConfig(&hpcd_usb_drd_fs, 0x01, PCD_SNG_BUF, 0xD4);  // 0x01 = EP1 OUT
-    HAL_PCDEx_PMAConfig(&hpcd_usb_drd_fs, 0x82, PCD_SNG_BUF, 0x114); // 0x82 = EP2 IN
+    if (! _usb_pma_init())
+    {
+        LOG_ERROR("PMA layout too big");
+    }
 
     // Initialize and link controller HAL driver
     if (ux_dcd_stm32_initialize((ULONG)USB_DRD_FS, (ULONG)&hpcd_usb_drd_fs) != UX_SUCCESS)
@@ -153,7 +230,26 @@ void usb_device_init(void)
 }
 
 void usb_device_task(void)
-{
+{   // drain all data already received, next packet will raise EVENT_USB again
+#define USB_TASK_DRAIN_LIMIT (64)
+
+    int limit = USB_TASK_DRAIN_LIMIT;
+
+    PROF_BEGIN(PROF_USB_TASK);
+    do
+    {
+        ux_device_stack_tasks_run();
+        if (! ux_device_cdc_acm_task())
+            break;
+    } while (--limit > 0);
+    if (limit == 0)
+        event_set(EVENT_USB); // data still pending, SOF IRQ is off so no IRQ would come for it
+    PROF_END(PROF_USB_TASK);
+}
+
+void usb_device_poll(void)
+{   // single pass, at most one read (USB_DEVICE_POLL_MAX bytes) per port
+    // delivered, for callers which receive into a bounded buffer
     ux_device_stack_tasks_run();
     ux_device_cdc_acm_task();
 }
@@ -161,21 +257,39 @@ void usb_device_task(void)
 
 bool usb_cdc_rx_init(usb_cdc_rx_pfunc_t rx_handler)
 {
-	ux_device_cdc_acm_rx_init(rx_handler);
+	ux_device_cdc_acm_rx_init(USB_CDC_CONSOLE, rx_handler);
 	return (true);
 }
 
 bool usb_device_connected(void)
 {
-    return (ux_device_cdc_acm_connected());
+    return (ux_device_cdc_acm_connected(USB_CDC_CONSOLE));
 }
 
 usb_result_e usb_cdc_tx(u8* data, u16 len)
 {
-      if (ux_device_cdc_acm_tx(data, len))
-            return (USB_RESULT_OK);
-    
-      return (USB_RESULT_BUSY);
+      return (_usb_tx_result(ux_device_cdc_acm_tx(USB_CDC_CONSOLE, data, len), len));
+}
+
+bool usb_cdc_data_rx_init(usb_cdc_rx_pfunc_t rx_handler)
+{
+	ux_device_cdc_acm_rx_init(USB_CDC_DATA, rx_handler);
+	return (true);
+}
+
+usb_cdc_rx_pfunc_t usb_cdc_data_rx_handler(void)
+{
+	return (ux_device_cdc_acm_rx_handler(USB_CDC_DATA));
+}
+
+bool usb_cdc_data_connected(void)
+{
+    return (ux_device_cdc_acm_connected(USB_CDC_DATA));
+}
+
+usb_result_e usb_cdc_data_tx(u8* data, u16 len)
+{
+      return (_usb_tx_result(ux_device_cdc_acm_tx(USB_CDC_DATA, data, len), len));
 }
 
 bool usb_cdc_tx_busy(void)
@@ -240,6 +354,7 @@ void USB_IRQHandler(void)
 {
     // printf("I\n");
     HAL_PCD_IRQHandler(&hpcd_usb_drd_fs);
+    event_set(EVENT_USB);
 }
 
 
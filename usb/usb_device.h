@@ -15,6 +15,8 @@
 
 #include "type.h"
 
+#define USB_DEVICE_POLL_MAX (512) // most data one usb_device_poll() delivers to a port
+
 typedef void (*usb_cdc_rx_pfunc_t)(uint8_t* pbuf, u32 len);
 
 typedef enum {
@@ -22,14 +24,26 @@ typedef enum {
     USB_RESULT_BUSY = 0xFF,
 } usb_result_e;
 
+typedef enum {
+    USB_CDC_CONSOLE = 0, // commands and log, first /dev/ttyACM
+    USB_CDC_DATA    = 1, // TLS records only, second /dev/ttyACM
+    USB_CDC_PORTS
+} usb_cdc_port_e;
+
 void usb_device_init(void);
 void usb_device_task(void);
+void usb_device_poll(void);
 bool usb_device_connected(void);
 
 bool         usb_cdc_rx_init(usb_cdc_rx_pfunc_t rx_handler);
 usb_result_e usb_cdc_tx(u8 *data, u16 len);
 bool         usb_cdc_tx_busy(void);
 
+bool         usb_cdc_data_connected(void);
+bool         usb_cdc_data_rx_init(usb_cdc_rx_pfunc_t rx_handler);
+usb_cdc_rx_pfunc_t usb_cdc_data_rx_handler(void);
+usb_result_e usb_cdc_data_tx(u8 *data, u16 len);
+
 #ifdef __cplusplus
 }
 #endif
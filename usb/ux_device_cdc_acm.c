@@ -10,35 +10,40 @@
 #include "usb_device.h"
 #include "ux_device_cdc_acm.h"
 #include "log.h"
+#include "stats.h"
 
 LOG_DEF("CDC");
 
-UX_SLAVE_CLASS_CDC_ACM  *cdc_acm;
-
 #define USB_HS_READ_LENGTH (512)
 #define ACM_RX_BUFFER_SIZE USB_HS_READ_LENGTH
-static u8 acm_rx_buffer[ACM_RX_BUFFER_SIZE];
+
+typedef struct {
+    UX_SLAVE_CLASS_CDC_ACM *instance;
+    usb_cdc_rx_pfunc_t rx_handler;
+    u8 rx_buffer[ACM_RX_BUFFER_SIZE];
+} cdc_port_t;
+
+static cdc_port_t _port[USB_CDC_PORTS] SRAM4_BSS; // RX buffers apart from CPU data
 
 UX_SLAVE_CLASS_CDC_ACM_LINE_CODING_PARAMETER CDC_VCP_LineCoding;
 
-static usb_cdc_rx_pfunc_t _rx_handler = NULL;
+void ux_device_cdc_acm_rx_init(usb_cdc_port_e port, usb_cdc_rx_pfunc_t rx_handler)
+{
+	_port[port].rx_handler = rx_handler;
+}
 
-void ux_device_cdc_acm_rx_init(usb_cdc_rx_pfunc_t rx_handler)
+usb_cdc_rx_pfunc_t ux_device_cdc_acm_rx_handler(usb_cdc_port_e port)
 {
-	_rx_handler = rx_handler;
+	return (_port[port].rx_handler);
 }
 
-/**
-  * @brief  ux_device_cdc_acm_activate
-  *         This function is called when insertion of a CDC ACM device.
-  * @param  cdc_acm_instance: Pointer to the cdc acm class instance.
-  * @retval none
-  */
-void ux_device_cdc_acm_activate(void *cdc_acm_instance)
+static void _activate(usb_cdc_port_e port, void *cdc_acm_instance)
 {
-    cdc_acm = (UX_SLAVE_CLASS_CDC_ACM*)cdc_acm_instance;
+    UX_SLAVE_CLASS_CDC_ACM *cdc_acm = (UX_SLAVE_CLASS_CDC_ACM*)cdc_acm_instance;
+
+    _port[port].instance = cdc_acm;
     
-    LOG_DEBUG("ux_device_cdc_acm_activate()");
+    LOG_DEBUG("ux_device_cdc_acm_activate(%u)", port);
     
     CDC_VCP_LineCoding.ux_slave_class_cdc_acm_parameter_baudrate = 115200;
     CDC_VCP_LineCoding.ux_slave_class_cdc_acm_parameter_data_bit = 8;
@@ -52,6 +57,28 @@ void ux_device_cdc_acm_activate(void *cdc_acm_instance)
     }
 }
 
+/**
+  * @brief  ux_device_cdc_acm_activate
+  *         This function is called when insertion of a CDC ACM device.
+  * @param  cdc_acm_instance: Pointer to the cdc acm class instance.
+  * @retval none
+  */
+void ux_device_cdc_acm_activate(void *cdc_acm_instance)
+{
+    _activate(USB_CDC_CONSOLE, cdc_acm_instance);
+}
+
+/**
+  * @brief  ux_device_cdc_acm_data_activate
+  *         Same as ux_device_cdc_acm_activate() for the data (TLS) interface.
+  * @param  cdc_acm_instance: Pointer to the cdc acm class instance.
+  * @retval none
+  */
+void ux_device_cdc_acm_data_activate(void *cdc_acm_instance)
+{
+    _activate(USB_CDC_DATA, cdc_acm_instance);
+}
+
 /**
   * @brief  ux_device_cdc_acm_deactivate
   *         This function is called when extraction of a CDC ACM device.
@@ -60,8 +87,13 @@ void ux_device_cdc_acm_activate(void *cdc_acm_instance)
   */
 void ux_device_cdc_acm_deactivate(void *cdc_acm_instance)
 {
-    UX_PARAMETER_NOT_USED(cdc_acm_instance);
-    cdc_acm = UX_NULL;
+    int i;
+
+    for (i = 0; i < USB_CDC_PORTS; i++)
+    {
+        if (_port[i].instance == cdc_acm_instance)
+            _port[i].instance = UX_NULL;
+    }
 }
 
 /**
@@ -75,9 +107,9 @@ void ux_device_cdc_acm_parameterchange(void *cdc_acm_instance)
     UX_PARAMETER_NOT_USED(cdc_acm_instance);
 }
 
-bool ux_device_cdc_acm_connected(void)
+bool ux_device_cdc_acm_connected(usb_cdc_port_e port)
 {
-    if (cdc_acm == UX_NULL)
+    if (_port[port].instance == UX_NULL)
         return (false);
 
    if (_ux_system_slave->ux_system_slave_device.ux_slave_device_state == UX_DEVICE_CONFIGURED)
@@ -88,9 +120,9 @@ bool ux_device_cdc_acm_connected(void)
 
 void tty_debug (const ascii *buf, size_t count);
 
-bool ux_device_cdc_acm_tx(u8* data, u16 len)
+bool ux_device_cdc_acm_tx(usb_cdc_port_e port, u8* data, u16 len)
 {
-    UX_SLAVE_CLASS_CDC_ACM *ctx = cdc_acm;
+    UX_SLAVE_CLASS_CDC_ACM *ctx = _port[port].instance;
     ULONG actual_length;
 
     if (ctx == UX_NULL)
@@ -105,38 +137,55 @@ bool ux_device_cdc_acm_tx(u8* data, u16 len)
     return (true);
 }
 
-void ux_device_cdc_acm_task(void)
+static bool _port_task(cdc_port_t *port, ULONG read_length)
 {
     ULONG actual_length;
-    UX_SLAVE_DEVICE *device;
-    ULONG read_length;
-    UX_SLAVE_CLASS_CDC_ACM *ctx = cdc_acm;
-
-    device = &_ux_system_slave->ux_system_slave_device;
+    UX_SLAVE_CLASS_CDC_ACM *ctx = port->instance;
 
     if (ctx == UX_NULL)
-        return;
-
-    if (device->ux_slave_device_state != UX_DEVICE_CONFIGURED)
-        return;
-
-    read_length = (_ux_system_slave->ux_system_slave_speed == UX_HIGH_SPEED_DEVICE) ? USB_HS_READ_LENGTH : 64;
+        return (false);
 
-    UINT status = ux_device_class_cdc_acm_read_run(ctx, (UCHAR *)acm_rx_buffer, read_length, &actual_length);
+    UINT status = ux_device_class_cdc_acm_read_run(ctx, (UCHAR *)port->rx_buffer, read_length, &actual_length);
         
     if (status <= UX_STATE_ERROR)
-        return;
+        return (false);
     
     if (status == UX_STATE_NEXT)
     {
         if (actual_length != 0)
         {
-          	if (_rx_handler != NULL)
+            STATS_INC(STATS_USB_RX_PACKETS);
+            STATS_ADD(STATS_USB_RX_BYTES, actual_length);
+          	if (port->rx_handler != NULL)
 	        {
-		        _rx_handler(acm_rx_buffer, actual_length);
+		        port->rx_handler(port->rx_buffer, actual_length);
 	        }
+            return (true);
         }
     }
+    return (false);
+}
+
+bool ux_device_cdc_acm_task(void)
+{   // returns true when data were delivered (more may be waiting)
+    UX_SLAVE_DEVICE *device;
+    ULONG read_length;
+    bool delivered = false;
+    int i;
+
+    device = &_ux_system_slave->ux_system_slave_device;
+
+    if (device->ux_slave_device_state != UX_DEVICE_CONFIGURED)
+        return (false);
+
+    read_length = (_ux_system_slave->ux_system_slave_speed == UX_HIGH_SPEED_DEVICE) ? USB_HS_READ_LENGTH : 64;
+
+    for (i = 0; i < USB_CDC_PORTS; i++)
+    {
+        if (_port_task(&_port[i], read_length))
+            delivered = true;
+    }
+    return (delivered);
 }
 
 
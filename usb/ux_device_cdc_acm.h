@@ -16,14 +16,16 @@ extern "C" {
 #include "ux_api.h"
 #include "ux_device_class_cdc_acm.h"
 
-void ux_device_cdc_acm_rx_init(usb_cdc_rx_pfunc_t rx_handler);
+void ux_device_cdc_acm_rx_init(usb_cdc_port_e port, usb_cdc_rx_pfunc_t rx_handler);
+usb_cdc_rx_pfunc_t ux_device_cdc_acm_rx_handler(usb_cdc_port_e port);
 void ux_device_cdc_acm_activate(void *cdc_acm_instance);
+void ux_device_cdc_acm_data_activate(void *cdc_acm_instance);
 void ux_device_cdc_acm_deactivate(void *cdc_acm_instance);
 void ux_device_cdc_acm_parameterchange(void *cdc_acm_instance);
-bool ux_device_cdc_acm_connected(void);
-bool ux_device_cdc_acm_tx(u8* data, u16 len);
+bool ux_device_cdc_acm_connected(usb_cdc_port_e port);
+bool ux_device_cdc_acm_tx(usb_cdc_port_e port, u8* data, u16 len);
 
-void ux_device_cdc_acm_task(void);
+bool ux_device_cdc_acm_task(void);
 
 #ifdef __cplusplus
 }
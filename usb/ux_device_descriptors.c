@@ -46,7 +46,8 @@
 USBD_DevClassHandleTypeDef  USBD_Device_FS, USBD_Device_HS;
 
 uint8_t UserClassInstance[USBD_MAX_CLASS_INTERFACES] = {
-  CLASS_TYPE_CDC_ACM,
+  CLASS_TYPE_CDC_ACM, /* console */
+  CLASS_TYPE_CDC_ACM, /* TLS data */
 };
 
 /* The generic device descriptor buffer that will be filled by builder
@@ -516,7 +517,9 @@ uint8_t  USBD_FrameWork_AddToConfDesc(USBD_DevClassHandleTypeDef *pdev, uint8_t
   uint8_t interface = 0U;
 
   /* USER CODE BEGIN FrameWork_AddToConfDesc_0 */
-
+  uint8_t ep_out = USBD_CDCACM_EPOUT_ADDR;
+  uint8_t ep_in = USBD_CDCACM_EPIN_ADDR;
+  uint8_t ep_cmd = USBD_CDCACM_EPINCMD_ADDR;
   /* USER CODE END FrameWork_AddToConfDesc_0 */
 
   /* The USB drivers do not set the speed value, so set it here before starting */
@@ -542,6 +545,23 @@ uint8_t  USBD_FrameWork_AddToConfDesc(USBD_DevClassHandleTypeDef *pdev, uint8_t
       pdev->tclasslist[pdev->classId].Ifs[0] = interface;
       pdev->tclasslist[pdev->classId].Ifs[1] = (uint8_t)(interface + 1U);
 
+      /* USER CODE BEGIN CDC_ACM_Instance */
+      /* InterfaceType tells CDC instances apart (usb_cdc_port_e), each has own endpoints */
+      for (uint32_t i = 0U; i < pdev->classId; i++)
+      {
+        if (pdev->tclasslist[i].ClassType == CLASS_TYPE_CDC_ACM)
+        {
+          pdev->tclasslist[pdev->classId].InterfaceType++;
+        }
+      }
+      if (pdev->tclasslist[pdev->classId].InterfaceType != 0U)
+      {
+        ep_out = USBD_CDCACM_DATA_EPOUT_ADDR;
+        ep_in = USBD_CDCACM_DATA_EPIN_ADDR;
+        ep_cmd = USBD_CDCACM_DATA_EPINCMD_ADDR;
+      }
+      /* USER CODE END CDC_ACM_Instance */
+
       /* Assign endpoint numbers */
       pdev->tclasslist[pdev->classId].NumEps = 3U;  /* EP_IN, EP_OUT, CMD_EP */
 
@@ -549,29 +569,29 @@ uint8_t  USBD_FrameWork_AddToConfDesc(USBD_DevClassHandleTypeDef *pdev, uint8_t
       if (Speed == USBD_HIGH_SPEED)
       {
         /* Assign OUT Endpoint */
-        USBD_FrameWork_AssignEp(pdev, USBD_CDCACM_EPOUT_ADDR,
+        USBD_FrameWork_AssignEp(pdev, ep_out,
                                 USBD_EP_TYPE_BULK, USBD_CDCACM_EPOUT_HS_MPS);
 
         /* Assign IN Endpoint */
-        USBD_FrameWork_AssignEp(pdev, USBD_CDCACM_EPIN_ADDR,
+        USBD_FrameWork_AssignEp(pdev, ep_in,
                                 USBD_EP_TYPE_BULK, USBD_CDCACM_EPIN_HS_MPS);
 
         /* Assign CMD Endpoint */
-        USBD_FrameWork_AssignEp(pdev, USBD_CDCACM_EPINCMD_ADDR,
+        USBD_FrameWork_AssignEp(pdev, ep_cmd,
                                 USBD_EP_TYPE_INTR, USBD_CDCACM_EPINCMD_HS_MPS);
       }
       else
       {
         /* Assign OUT Endpoint */
-        USBD_FrameWork_AssignEp(pdev, USBD_CDCACM_EPOUT_ADDR,
+        USBD_FrameWork_AssignEp(pdev, ep_out,
                                 USBD_EP_TYPE_BULK, USBD_CDCACM_EPOUT_FS_MPS);
 
         /* Assign IN Endpoint */
-        USBD_FrameWork_AssignEp(pdev, USBD_CDCACM_EPIN_ADDR,
+        USBD_FrameWork_AssignEp(pdev, ep_in,
                                 USBD_EP_TYPE_BULK, USBD_CDCACM_EPIN_FS_MPS);
 
         /* Assign CMD Endpoint */
-        USBD_FrameWork_AssignEp(pdev, USBD_CDCACM_EPINCMD_ADDR,
+        USBD_FrameWork_AssignEp(pdev, ep_cmd,
                                 USBD_EP_TYPE_INTR, USBD_CDCACM_EPINCMD_FS_MPS);
       }
 
@@ -293,10 +293,12 @@ uint16_t USBD_Get_Configuration_Number(uint8_t class_type, uint8_t interface_typ
 #define USBD_STRING_FRAMEWORK_MAX_LENGTH              256U
 
 /* Device CDC-ACM Class */
-#define USBD_CDCACM_EPINCMD_ADDR                      0x82U
+/* Bulk endpoints are double buffered (usb_device.c), a double buffered EPnR
+   is one direction only: bulk IN and OUT get own endpoint numbers */
+#define USBD_CDCACM_EPINCMD_ADDR                      0x83U
 #define USBD_CDCACM_EPINCMD_FS_MPS                    8U
 #define USBD_CDCACM_EPINCMD_HS_MPS                    8U
-#define USBD_CDCACM_EPIN_ADDR                         0x81U
+#define USBD_CDCACM_EPIN_ADDR                         0x82U
 #define USBD_CDCACM_EPOUT_ADDR                        0x01U
 #define USBD_CDCACM_EPIN_FS_MPS                       64U
 #define USBD_CDCACM_EPIN_HS_MPS                       512U
@@ -305,6 +307,11 @@ uint16_t USBD_Get_Configuration_Number(uint8_t class_type, uint8_t interface_typ
 #define USBD_CDCACM_EPINCMD_FS_BINTERVAL              5U
 #define USBD_CDCACM_EPINCMD_HS_BINTERVAL              5U
 
+/* Second CDC-ACM instance (TLS data interface), same sizes as above */
+#define USBD_CDCACM_DATA_EPINCMD_ADDR                 0x86U
+#define USBD_CDCACM_DATA_EPIN_ADDR                    0x85U
+#define USBD_CDCACM_DATA_EPOUT_ADDR                   0x04U
+
 #ifndef USBD_CONFIG_STR_DESC_IDX
 #define USBD_CONFIG_STR_DESC_IDX                      0U
 #endif /* USBD_CONFIG_STR_DESC_IDX */